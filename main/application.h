@@ -59,8 +59,8 @@ public:
     void SetAecMode(AecMode mode);
     AecMode GetAecMode() const { return aec_mode_; }
     
-    // 新增：接收外部音频数据（如音乐播放）
-    void AddAudioData(AudioStreamPacket&& packet);
+    // 新增：接收外部音频数据（如音乐播放），pcm为单声道或交错的双声道数据
+    void AddAudioData(std::vector<int16_t>&& pcm, int sample_rate, int channels = 1);
     void PlaySound(const std::string_view& sound);
     AudioService& GetAudioService() { return audio_service_; }
 
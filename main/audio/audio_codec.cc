@@ -3,7 +3,9 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <cstring>
+#include <algorithm>
 #include <driver/i2s_common.h>
 
 #define TAG "AudioCodec"
@@ -16,6 +18,40 @@ AudioCodec::~AudioCodec() {
 
 void AudioCodec::OutputData(std::vector<int16_t>& data) {
     Write(data.data(), data.size());
+
+    // Write() returns once the data is copied into the DMA buffers, which then drain at the output
+    // sample rate. Remember how much is queued so the clock can age it out between writes.
+    uint32_t frames = data.size() / output_channels_;
+    std::lock_guard<std::mutex> lock(output_clock_mutex_);
+    int64_t now_us = esp_timer_get_time();
+    output_frames_queued_ = std::min<uint32_t>(EstimateFramesQueued(now_us) + frames,
+        AUDIO_CODEC_DMA_DESC_NUM * AUDIO_CODEC_DMA_FRAME_NUM);
+    output_write_time_us_ = now_us;
+    output_frames_written_ += frames;
+}
+
+uint32_t AudioCodec::EstimateFramesQueued(int64_t now_us) const {
+    if (output_sample_rate_ <= 0) {
+        return 0;
+    }
+    int64_t drained = (now_us - output_write_time_us_) * output_sample_rate_ / 1000000;
+    return drained >= output_frames_queued_ ? 0 : output_frames_queued_ - (uint32_t)drained;
+}
+
+uint64_t AudioCodec::GetOutputFramesWritten() {
+    std::lock_guard<std::mutex> lock(output_clock_mutex_);
+    return output_frames_written_;
+}
+
+uint32_t AudioCodec::GetOutputFramesQueued() {
+    std::lock_guard<std::mutex> lock(output_clock_mutex_);
+    return EstimateFramesQueued(esp_timer_get_time());
+}
+
+uint64_t AudioCodec::GetOutputFramesPlayed() {
+    std::lock_guard<std::mutex> lock(output_clock_mutex_);
+    uint32_t queued = EstimateFramesQueued(esp_timer_get_time());
+    return output_frames_written_ > queued ? output_frames_written_ - queued : 0;
 }
 
 bool AudioCodec::InputData(std::vector<int16_t>& data) {
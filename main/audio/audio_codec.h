@@ -8,6 +8,7 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <mutex>
 
 #include "board.h"
 
@@ -26,6 +27,11 @@ public:
     virtual bool SetOutputSampleRate(int sample_rate);
 
     virtual void OutputData(std::vector<int16_t>& data);
+    // Playback clock: sample frames handed to the I2S driver since boot (monotonic), and the frames
+    // among them that already left the DMA buffers, i.e. were heard
+    uint64_t GetOutputFramesWritten();
+    uint64_t GetOutputFramesPlayed();
+    uint32_t GetOutputFramesQueued();
     virtual bool InputData(std::vector<int16_t>& data);
     virtual void Start();
 
@@ -55,6 +61,14 @@ protected:
     int output_channels_ = 1;
     int output_volume_ = 70;
 
+    // Written-sample accounting for the playback clock, see GetOutputFramesPlayed()
+    std::mutex output_clock_mutex_;
+    uint64_t output_frames_written_ = 0;
+    uint32_t output_frames_queued_ = 0;     // frames in the DMA buffers when the last write returned
+    int64_t output_write_time_us_ = 0;
+
+    uint32_t EstimateFramesQueued(int64_t now_us) const;
+
     virtual int Read(int16_t* dest, int samples) = 0;
     virtual int Write(const int16_t* data, int samples) = 0;
 };
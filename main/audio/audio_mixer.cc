@@ -0,0 +1,220 @@
+#include "audio_mixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+void AudioMixer::SetSampleRate(int sample_rate) {
+    sample_rate_ = sample_rate;
+    for (auto& channel : channels_) {
+        channel.max_queued_samples = (size_t)channel.max_queued_ms * sample_rate_ / 1000;
+    }
+    UpdateFadeStep();
+}
+
+void AudioMixer::SetOutputChannels(int channels) {
+    output_channels_ = channels == 2 ? 2 : 1;
+}
+
+void AudioMixer::SetFadeDuration(int fade_ms) {
+    fade_ms_ = fade_ms;
+    UpdateFadeStep();
+}
+
+void AudioMixer::UpdateFadeStep() {
+    int fade_samples = fade_ms_ * sample_rate_ / 1000;
+    fade_step_ = fade_samples > 0 ? std::max<int32_t>(1, AUDIO_MIXER_UNITY_GAIN / fade_samples) : AUDIO_MIXER_UNITY_GAIN;
+}
+
+void AudioMixer::ConfigureChannel(AudioMixerChannel channel, int priority, int max_queued_ms, int duck_gain_percent) {
+    auto& ch = channels_[channel];
+    ch.priority = priority;
+    ch.max_queued_ms = max_queued_ms;
+    ch.max_queued_samples = (size_t)max_queued_ms * sample_rate_ / 1000;
+    ch.duck_gain = duck_gain_percent * AUDIO_MIXER_UNITY_GAIN / 100;
+}
+
+void AudioMixer::SetGain(AudioMixerChannel channel, int gain_percent) {
+    gain_percent = std::max(0, std::min(100, gain_percent));
+    channels_[channel].gain = gain_percent * AUDIO_MIXER_UNITY_GAIN / 100;
+}
+
+void AudioMixer::SetPaused(AudioMixerChannel channel, bool paused) {
+    auto& ch = channels_[channel];
+    if (!ch.paused && paused) {
+        RenderFadeOut(ch);
+    } else if (ch.paused && !paused) {
+        ch.current_gain = 0;
+    }
+    ch.paused = paused;
+}
+
+bool AudioMixer::IsFull(AudioMixerChannel channel) const {
+    return channels_[channel].queued_samples >= channels_[channel].max_queued_samples;
+}
+
+bool AudioMixer::IsEmpty() const {
+    for (const auto& channel : channels_) {
+        if ((channel.queued_samples > 0 && !channel.paused) || channel.tail_offset < channel.tail.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AudioMixer::Push(AudioMixerChannel channel, AudioMixerFrame&& frame) {
+    if (frame.pcm.empty()) {
+        return;
+    }
+    auto& ch = channels_[channel];
+    if (ch.queued_samples == 0) {
+        // Fade in from silence whenever a channel (re)starts
+        ch.current_gain = 0;
+    }
+    frame.channels = frame.channels == 2 ? 2 : 1;
+    size_t samples = frame.pcm.size() / frame.channels;
+    ch.queued_samples += samples;
+    ch.pushed_samples += samples;
+    ch.frames.push_back(std::move(frame));
+}
+
+void AudioMixer::Flush(AudioMixerChannel channel) {
+    auto& ch = channels_[channel];
+    RenderFadeOut(ch);
+    ch.frames.clear();
+    ch.front_offset = 0;
+    ch.queued_samples = 0;
+    ch.current_gain = 0;
+}
+
+// Renders the channel from its current gain down to silence into its tail, consuming the rendered
+// frames from the queue. The ramp takes at most fade_ms_, shorter when the channel is already ducked.
+void AudioMixer::RenderFadeOut(Channel& channel) {
+    if (channel.queued_samples == 0 || channel.paused || channel.current_gain == 0) {
+        return;
+    }
+    size_t frames = std::min<size_t>(channel.queued_samples, (channel.current_gain + fade_step_ - 1) / fade_step_);
+
+    // A previous tail may still be playing (e.g. flushed twice in a row), the new one is added to it
+    channel.tail.erase(channel.tail.begin(), channel.tail.begin() + channel.tail_offset);
+    channel.tail_offset = 0;
+    channel.tail.resize(std::max(channel.tail.size(), frames * output_channels_), 0);
+    MixChannel(channel, 0, frames, channel.tail.data(), nullptr);
+}
+
+size_t AudioMixer::Mix(int16_t* output, size_t max_frames, std::vector<uint32_t>* timestamps) {
+    // Mix as many frames as the fullest channel can provide, a starving channel contributes silence.
+    // Fade-out tails are played out but do not duck other channels.
+    size_t frames = 0;
+    int top_priority = -1;
+    for (const auto& channel : channels_) {
+        if (channel.queued_samples > 0 && !channel.paused) {
+            frames = std::max(frames, std::min(channel.queued_samples, max_frames));
+            top_priority = std::max(top_priority, channel.priority);
+        }
+        size_t tail_frames = (channel.tail.size() - channel.tail_offset) / output_channels_;
+        frames = std::max(frames, std::min(tail_frames, max_frames));
+    }
+    if (frames == 0) {
+        return 0;
+    }
+
+    size_t samples = frames * output_channels_;
+    if (accumulator_.size() < samples) {
+        accumulator_.resize(samples);
+    }
+    std::fill(accumulator_.begin(), accumulator_.begin() + samples, 0);
+
+    for (auto& channel : channels_) {
+        if (channel.tail_offset < channel.tail.size()) {
+            size_t count = std::min(samples, channel.tail.size() - channel.tail_offset);
+            const int32_t* tail = channel.tail.data() + channel.tail_offset;
+            for (size_t i = 0; i < count; i++) {
+                accumulator_[i] += tail[i];
+            }
+            channel.tail_offset += count;
+            if (channel.tail_offset >= channel.tail.size()) {
+                channel.tail.clear();
+                channel.tail_offset = 0;
+            }
+        }
+
+        if (channel.queued_samples == 0 || channel.paused) {
+            continue;
+        }
+        int32_t target_gain = channel.gain;
+        if (channel.priority < top_priority) {
+            target_gain = (int32_t)(((int64_t)target_gain * channel.duck_gain) >> 15);
+        }
+        MixChannel(channel, target_gain, std::min(frames, channel.queued_samples), accumulator_.data(), timestamps);
+    }
+
+    for (size_t i = 0; i < samples; i++) {
+        int32_t value = accumulator_[i];
+        output[i] = (int16_t)std::max<int32_t>(INT16_MIN, std::min<int32_t>(INT16_MAX, value));
+    }
+    return frames;
+}
+
+// Adds count frames of src to dst, ramping the gain linearly towards target_gain.
+// Mono frames are copied to both channels of a stereo output, stereo frames are averaged for a mono output.
+template <int kInputChannels, int kOutputChannels>
+static int32_t MixFrames(const int16_t* src, int32_t* dst, size_t count, int32_t gain, int32_t target_gain,
+                         int32_t fade_step) {
+    for (size_t i = 0; i < count; i++) {
+        if (gain < target_gain) {
+            gain = std::min(target_gain, gain + fade_step);
+        } else if (gain > target_gain) {
+            gain = std::max(target_gain, gain - fade_step);
+        }
+        if constexpr (kInputChannels == kOutputChannels) {
+            for (int c = 0; c < kOutputChannels; c++) {
+                dst[i * kOutputChannels + c] += (src[i * kInputChannels + c] * gain) >> 15;
+            }
+        } else if constexpr (kInputChannels == 1) {
+            int32_t value = (src[i] * gain) >> 15;
+            dst[i * 2] += value;
+            dst[i * 2 + 1] += value;
+        } else {
+            dst[i] += ((src[i * 2] + src[i * 2 + 1]) * gain) >> 16;
+        }
+    }
+    return gain;
+}
+
+void AudioMixer::MixChannel(Channel& channel, int32_t target_gain, size_t frames, int32_t* output,
+                            std::vector<uint32_t>* timestamps) {
+    int32_t gain = channel.current_gain;
+    size_t mixed = 0;
+    while (mixed < frames) {
+        auto& frame = channel.frames.front();
+        if (channel.front_offset == 0 && frame.timestamp > 0 && timestamps != nullptr) {
+            timestamps->push_back(frame.timestamp);
+        }
+
+        size_t frame_length = frame.pcm.size() / frame.channels;
+        size_t count = std::min(frames - mixed, frame_length - channel.front_offset);
+        const int16_t* src = frame.pcm.data() + channel.front_offset * frame.channels;
+        int32_t* dst = output + mixed * output_channels_;
+        if (frame.channels == output_channels_ && gain == target_gain && gain == AUDIO_MIXER_UNITY_GAIN) {
+            for (size_t i = 0; i < count * output_channels_; i++) {
+                dst[i] += src[i];
+            }
+        } else if (frame.channels == output_channels_) {
+            gain = output_channels_ == 2 ? MixFrames<2, 2>(src, dst, count, gain, target_gain, fade_step_)
+                                         : MixFrames<1, 1>(src, dst, count, gain, target_gain, fade_step_);
+        } else if (frame.channels == 1) {
+            gain = MixFrames<1, 2>(src, dst, count, gain, target_gain, fade_step_);
+        } else {
+            gain = MixFrames<2, 1>(src, dst, count, gain, target_gain, fade_step_);
+        }
+
+        mixed += count;
+        channel.front_offset += count;
+        channel.queued_samples -= count;
+        if (channel.front_offset >= frame_length) {
+            channel.frames.pop_front();
+            channel.front_offset = 0;
+        }
+    }
+    channel.current_gain = gain;
+}
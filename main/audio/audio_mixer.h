@@ -0,0 +1,103 @@
+#ifndef AUDIO_MIXER_H
+#define AUDIO_MIXER_H
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Mixes several prioritized PCM streams into one output stream at the codec sample rate and
+ * channel count. Frames may be mono or interleaved stereo: mono frames are copied to both output
+ * channels while mixing, stereo frames are averaged when the output is mono.
+ *
+ * Every channel has its own bounded queue, gain and linear fade. When a channel with a higher
+ * priority is playing, lower priority channels fade to their duck gain (the default of 100%
+ * leaves them untouched) and fade back once it stops.
+ *
+ * Nothing is ever cut mid-waveform: a channel fades in whenever it (re)starts, and Flush() or
+ * pausing renders the next fade duration of the channel, ramping down to silence, into a tail
+ * that keeps playing after the queue is gone. A stop therefore completes after the fade instead
+ * of after draining the queue, and a new stream pushed right after a flush crossfades with it.
+ *
+ * Queue sizes and Mix() counts are in sample frames (one sample per channel).
+ *
+ * The mixer is not thread safe, the owner (AudioService) guards it with its queue mutex.
+ */
+
+enum AudioMixerChannel {
+    kAudioMixerChannelVoice,
+    kAudioMixerChannelNotification,
+    kAudioMixerChannelMusic,
+    kAudioMixerChannelCount,
+};
+
+#define AUDIO_MIXER_UNITY_GAIN 32768
+
+struct AudioMixerFrame {
+    std::vector<int16_t> pcm;   // interleaved when channels is 2
+    int channels = 1;
+    uint32_t timestamp = 0;
+};
+
+class AudioMixer {
+public:
+    void SetSampleRate(int sample_rate);
+    void SetOutputChannels(int channels);
+    int output_channels() const { return output_channels_; }
+    void SetFadeDuration(int fade_ms);
+    void ConfigureChannel(AudioMixerChannel channel, int priority, int max_queued_ms, int duck_gain_percent = 100);
+    void SetGain(AudioMixerChannel channel, int gain_percent);
+    // A paused channel fades out, then keeps its queue but is neither mixed nor consumed, and fades
+    // in again on resume
+    void SetPaused(AudioMixerChannel channel, bool paused);
+
+    bool IsFull(AudioMixerChannel channel) const;
+    bool IsEmpty(AudioMixerChannel channel) const { return channels_[channel].queued_samples == 0; }
+    // True when no channel has anything to play, fade-out tails included (paused channels count as empty)
+    bool IsEmpty() const;
+    size_t QueuedSamples(AudioMixerChannel channel) const { return channels_[channel].queued_samples; }
+    // Frames ever pushed to the channel, flushed ones included; minus QueuedSamples() gives the frames
+    // mixed or dropped so far
+    uint64_t PushedSamples(AudioMixerChannel channel) const { return channels_[channel].pushed_samples; }
+
+    void Push(AudioMixerChannel channel, AudioMixerFrame&& frame);
+    // Drops the queue of the channel after rendering its fade-out tail
+    void Flush(AudioMixerChannel channel);
+
+    // Mix up to max_frames sample frames into output (output_channels() interleaved samples each),
+    // returns the number of frames written.
+    // Timestamps of voice frames that started playing are appended to timestamps (for server AEC).
+    size_t Mix(int16_t* output, size_t max_frames, std::vector<uint32_t>* timestamps = nullptr);
+
+private:
+    struct Channel {
+        std::deque<AudioMixerFrame> frames;
+        size_t front_offset = 0;        // in frames
+        size_t queued_samples = 0;      // in frames
+        uint64_t pushed_samples = 0;    // in frames
+        size_t max_queued_samples = 0;
+        int max_queued_ms = 0;
+        int priority = 0;
+        int32_t gain = AUDIO_MIXER_UNITY_GAIN;
+        int32_t duck_gain = AUDIO_MIXER_UNITY_GAIN;
+        int32_t current_gain = 0;
+        bool paused = false;
+        std::vector<int32_t> tail;      // faded-out samples still to be played, output_channels_ interleaved
+        size_t tail_offset = 0;         // in samples
+    };
+
+    Channel channels_[kAudioMixerChannelCount];
+    std::vector<int32_t> accumulator_;
+    int sample_rate_ = 16000;
+    int output_channels_ = 1;
+    int fade_ms_ = 20;
+    int32_t fade_step_ = 1;
+
+    void UpdateFadeStep();
+    void RenderFadeOut(Channel& channel);
+    void MixChannel(Channel& channel, int32_t target_gain, size_t frames, int32_t* output,
+                    std::vector<uint32_t>* timestamps);
+};
+
+#endif // AUDIO_MIXER_H
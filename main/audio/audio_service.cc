@@ -1,5 +1,8 @@
 #include "audio_service.h"
+#include "pcm_channels.h"
+#include "settings.h"
 #include <esp_log.h>
+#include <esp_cpu.h>
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -38,6 +41,22 @@ void AudioService::Initialize(AudioCodec* codec) {
     opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
     opus_encoder_->SetComplexity(0);
 
+    /* Setup the mixer, music is paused outside idle so it is never ducked */
+    audio_mixer_.SetSampleRate(codec->output_sample_rate());
+    audio_mixer_.SetOutputChannels(codec->output_channels());
+    audio_mixer_.SetFadeDuration(MIXER_FADE_DURATION_MS);
+    audio_mixer_.ConfigureChannel(kAudioMixerChannelVoice, 2, MAX_PLAYBACK_TASKS_IN_QUEUE * OPUS_FRAME_DURATION_MS);
+    audio_mixer_.ConfigureChannel(kAudioMixerChannelNotification, 1, MAX_PLAYBACK_TASKS_IN_QUEUE * OPUS_FRAME_DURATION_MS);
+    audio_mixer_.ConfigureChannel(kAudioMixerChannelMusic, 0, MAX_MUSIC_QUEUE_DURATION_MS);
+
+    /* Music EQ preset and loudness normalization chosen by the user */
+    {
+        Settings settings("audio", false);
+        int preset = settings.GetInt("music_eq", kMusicEqFlat);
+        music_eq_preset_ = (preset >= 0 && preset < kMusicEqPresetCount) ? (MusicEqPreset)preset : kMusicEqFlat;
+        music_normalization_ = settings.GetInt("music_norm", 1) != 0;
+    }
+
     if (codec->input_sample_rate() != 16000) {
         input_resampler_.Configure(codec->input_sample_rate(), 16000);
         reference_resampler_.Configure(codec->input_sample_rate(), 16000);
@@ -145,8 +164,11 @@ void AudioService::Stop() {
     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
     audio_encode_queue_.clear();
     audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
+    audio_sound_queue_.clear();
     audio_testing_queue_.clear();
+    for (int i = 0; i < kAudioMixerChannelCount; i++) {
+        audio_mixer_.Flush((AudioMixerChannel)i);
+    }
     audio_queue_cv_.notify_all();
 }
 
@@ -274,23 +296,33 @@ void AudioService::AudioInputTask() {
 }
 
 void AudioService::AudioOutputTask() {
+    /* Mix at most one opus frame per write, buffers live on the heap to keep the task stack small */
+    const size_t max_frames = OPUS_FRAME_DURATION_MS * codec_->output_sample_rate() / 1000;
+    const int channels = audio_mixer_.output_channels();
+    std::vector<int16_t> pcm;
+    std::vector<uint32_t> timestamps;
     while (true) {
         std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
+        audio_queue_cv_.wait(lock, [this]() { return !audio_mixer_.IsEmpty() || service_stopped_; });
         if (service_stopped_) {
             break;
         }
 
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
+        pcm.resize(max_frames * channels);
+        timestamps.clear();
+        size_t frames = audio_mixer_.Mix(pcm.data(), max_frames, &timestamps);
+        uint64_t music_frames = audio_mixer_.PushedSamples(kAudioMixerChannelMusic) -
+            audio_mixer_.QueuedSamples(kAudioMixerChannelMusic);
         audio_queue_cv_.notify_all();
         lock.unlock();
+        pcm.resize(frames * channels);
 
         if (!codec_->output_enabled()) {
             codec_->EnableOutput(true);
             esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
         }
-        codec_->OutputData(task->pcm);
+        codec_->OutputData(pcm);
+        music_output_frames_ = music_frames;
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
@@ -298,9 +330,9 @@ void AudioService::AudioOutputTask() {
 
 #if CONFIG_USE_SERVER_AEC
         /* Record the timestamp for server AEC */
-        if (task->timestamp > 0) {
+        if (!timestamps.empty()) {
             lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
+            timestamp_queue_.insert(timestamp_queue_.end(), timestamps.begin(), timestamps.end());
         }
 #endif
     }
@@ -314,35 +346,43 @@ void AudioService::OpusCodecTask() {
         audio_queue_cv_.wait(lock, [this]() {
             return service_stopped_ ||
                 (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
+                (!audio_decode_queue_.empty() && !audio_mixer_.IsFull(kAudioMixerChannelVoice)) ||
+                (!audio_sound_queue_.empty() && !audio_mixer_.IsFull(kAudioMixerChannelNotification));
         });
         if (service_stopped_) {
             break;
         }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
+        /* Decode the audio from sound queue or decode queue */
+        std::unique_ptr<AudioStreamPacket> packet;
+        AudioMixerChannel channel = kAudioMixerChannelVoice;
+        if (!audio_sound_queue_.empty() && !audio_mixer_.IsFull(kAudioMixerChannelNotification)) {
+            packet = std::move(audio_sound_queue_.front());
+            audio_sound_queue_.pop_front();
+            channel = kAudioMixerChannelNotification;
+        } else if (!audio_decode_queue_.empty() && !audio_mixer_.IsFull(kAudioMixerChannelVoice)) {
+            packet = std::move(audio_decode_queue_.front());
             audio_decode_queue_.pop_front();
+        }
+        if (packet) {
             audio_queue_cv_.notify_all();
             lock.unlock();
 
-            auto task = std::make_unique<AudioTask>();
-            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
+            AudioMixerFrame frame;
+            frame.timestamp = packet->timestamp;
 
             SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
+            if (opus_decoder_->Decode(std::move(packet->payload), frame.pcm)) {
                 // Resample if the sample rate is different
                 if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
-                    int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
+                    int target_size = output_resampler_.GetOutputSamples(frame.pcm.size());
                     std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
+                    output_resampler_.Process(frame.pcm.data(), frame.pcm.size(), resampled.data());
+                    frame.pcm = std::move(resampled);
                 }
 
                 lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
+                audio_mixer_.Push(channel, std::move(frame));
                 audio_queue_cv_.notify_all();
             } else {
                 ESP_LOGE(TAG, "Failed to decode audio");
@@ -551,25 +591,185 @@ void AudioService::PlaySound(const std::string_view& sound) {
         memcpy(packet->payload.data(), p3->payload, payload_size);
         p += payload_size;
 
-        PushPacketToDecodeQueue(std::move(packet), true);
+        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+        audio_queue_cv_.wait(lock, [this]() { return audio_sound_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE || service_stopped_; });
+        audio_sound_queue_.push_back(std::move(packet));
+        audio_queue_cv_.notify_all();
     }
 }
 
 bool AudioService::IsIdle() {
     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_sound_queue_.empty() &&
+        audio_testing_queue_.empty() && audio_mixer_.IsEmpty();
 }
 
 void AudioService::ResetDecoder() {
+    /* Music is owned by the music player and is not affected */
     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
     opus_decoder_->ResetState();
     timestamp_queue_.clear();
     audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
+    audio_sound_queue_.clear();
     audio_testing_queue_.clear();
+    audio_mixer_.Flush(kAudioMixerChannelVoice);
+    audio_mixer_.Flush(kAudioMixerChannelNotification);
+    audio_queue_cv_.notify_all();
+}
+
+bool AudioService::PushMusicData(std::vector<int16_t>&& pcm, int sample_rate, int channels) {
+    if (codec_ == nullptr || pcm.empty() || channels < 1 || channels > 2) {
+        return false;
+    }
+
+    /* Stereo music is only folded to mono for mono codecs, before resampling to halve its work */
+    if (channels == 2 && audio_mixer_.output_channels() == 1) {
+        DownmixStereoToMono(pcm.data(), pcm.size() / 2, pcm.data());
+        pcm.resize(pcm.size() / 2);
+        channels = 1;
+    }
+
+    /* A flush starts a new stream, drop the filter history of the previous one */
+    uint32_t flush_count = music_flush_count_.load();
+    if (flush_count != music_resampler_flush_count_) {
+        music_resampler_flush_count_ = flush_count;
+        music_resampler_.Reset();
+        music_dsp_.Reset();
+    }
+
+    AudioMixerFrame frame;
+    frame.channels = channels;
+    if (sample_rate != codec_->output_sample_rate()) {
+        if (!ResampleMusic(pcm, sample_rate, channels, frame.pcm)) {
+            return false;
+        }
+    } else {
+        frame.pcm = std::move(pcm);
+    }
+    ProcessMusicDsp(frame.pcm, channels);
+
+    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+    audio_queue_cv_.wait(lock, [this, flush_count]() {
+        return service_stopped_ || flush_count != music_flush_count_ || !audio_mixer_.IsFull(kAudioMixerChannelMusic);
+    });
+    if (service_stopped_ || flush_count != music_flush_count_) {
+        return false;
+    }
+    audio_mixer_.Push(kAudioMixerChannelMusic, std::move(frame));
+    audio_queue_cv_.notify_all();
+    return true;
+}
+
+void AudioService::FlushMusic() {
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    music_flush_count_++;
+    audio_mixer_.Flush(kAudioMixerChannelMusic);
+    audio_queue_cv_.notify_all();
+}
+
+void AudioService::PauseMusic(bool paused) {
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    audio_mixer_.SetPaused(kAudioMixerChannelMusic, paused);
     audio_queue_cv_.notify_all();
 }
 
+int64_t AudioService::GetMusicEndClockMs() {
+    if (codec_ == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    return audio_mixer_.PushedSamples(kAudioMixerChannelMusic) * 1000 / codec_->output_sample_rate();
+}
+
+int64_t AudioService::GetMusicPlaybackClockMs() {
+    if (codec_ == nullptr) {
+        return 0;
+    }
+    /* Frames still in the I2S DMA buffers have been mixed but not heard yet */
+    uint64_t frames = music_output_frames_.load();
+    uint32_t queued = codec_->GetOutputFramesQueued();
+    frames = frames > queued ? frames - queued : 0;
+    return frames * 1000 / codec_->output_sample_rate();
+}
+
+void AudioService::ProcessMusicDsp(std::vector<int16_t>& pcm, int channels) {
+    music_dsp_.Configure(codec_->output_sample_rate(), channels);
+    music_dsp_.SetEqPreset(music_eq_preset_);
+    music_dsp_.SetNormalization(music_normalization_, CONFIG_MUSIC_LOUDNESS_TARGET_LUFS);
+    if (!music_dsp_.active()) {
+        return;
+    }
+
+    size_t frames = pcm.size() / channels;
+    int core = xPortGetCoreID();
+    uint32_t start = esp_cpu_get_cycle_count();
+    music_dsp_.Process(pcm.data(), frames);
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    /* Cycle counters are per core, skip frames during which the task migrated */
+    if (xPortGetCoreID() != core) {
+        return;
+    }
+    music_dsp_frames_.fetch_add(1, std::memory_order_relaxed);
+    music_dsp_cycles_.fetch_add(cycles, std::memory_order_relaxed);
+    music_dsp_samples_.fetch_add(frames, std::memory_order_relaxed);
+    if (cycles > music_dsp_max_cycles_.load(std::memory_order_relaxed)) {
+        music_dsp_max_cycles_.store(cycles, std::memory_order_relaxed);
+    }
+}
+
+void AudioService::SetMusicEqPreset(MusicEqPreset preset) {
+    if (preset < 0 || preset >= kMusicEqPresetCount) {
+        return;
+    }
+    music_eq_preset_ = preset;
+    Settings settings("audio", true);
+    settings.SetInt("music_eq", preset);
+    ESP_LOGI(TAG, "Music EQ preset: %s", MusicDsp::PresetName(preset));
+}
+
+void AudioService::SetMusicNormalization(bool enabled) {
+    music_normalization_ = enabled;
+    Settings settings("audio", true);
+    settings.SetInt("music_norm", enabled ? 1 : 0);
+    ESP_LOGI(TAG, "Music loudness normalization %s", enabled ? "enabled" : "disabled");
+}
+
+MusicDspStats AudioService::GetMusicDspStats() const {
+    MusicDspStats stats;
+    stats.eq_preset = music_eq_preset_;
+    stats.normalization = music_normalization_;
+    stats.loudness_lufs = music_dsp_.loudness_lufs();
+    stats.gain_db = music_dsp_.gain_db();
+    stats.limited_samples = music_dsp_.limited_samples();
+    stats.frames = music_dsp_frames_.load();
+    uint64_t cycles = music_dsp_cycles_.load();
+    stats.avg_cycles = stats.frames > 0 ? (uint32_t)(cycles / stats.frames) : 0;
+    stats.max_cycles = music_dsp_max_cycles_.load();
+    uint64_t samples = music_dsp_samples_.load();
+    if (samples > 0 && codec_ != nullptr) {
+        /* cycles / (samples / rate * MHz * 1e6) */
+        double audio_cycles = (double)samples / codec_->output_sample_rate() * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1e6;
+        stats.cpu_percent = (float)(cycles * 100.0 / audio_cycles);
+    }
+    return stats;
+}
+
+bool AudioService::ResampleMusic(const std::vector<int16_t>& input, int input_rate, int channels, std::vector<int16_t>& output) {
+    if (input_rate != music_resampler_.input_sample_rate() || channels != music_resampler_.channels()) {
+        if (!music_resampler_.Configure(input_rate, codec_->output_sample_rate(), channels)) {
+            ESP_LOGE(TAG, "Unsupported music resampling from %d to %d", input_rate, codec_->output_sample_rate());
+            return false;
+        }
+        ESP_LOGI(TAG, "Resampling music from %d to %d, %d channels, %d phases x %d taps", input_rate,
+            codec_->output_sample_rate(), channels, music_resampler_.phases(), music_resampler_.taps());
+    }
+
+    output.resize(music_resampler_.GetOutputSamples(input.size()));
+    int samples = music_resampler_.Process(input.data(), input.size(), output.data());
+    output.resize(samples);
+    return true;
+}
+
 void AudioService::CheckAndUpdateAudioPowerState() {
     auto now = std::chrono::steady_clock::now();
     auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
@@ -587,4 +787,4 @@ void AudioService::CheckAndUpdateAudioPowerState() {
 
 void AudioService::UpdateOutputTimestamp() {
     last_output_time_ = std::chrono::steady_clock::now();
-}
\ No newline at end of file
+}
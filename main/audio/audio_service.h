@@ -6,6 +6,7 @@
 #include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -17,6 +18,9 @@
 #include <opus_resampler.h>
 
 #include "audio_codec.h"
+#include "audio_mixer.h"
+#include "polyphase_resampler.h"
+#include "music_dsp.h"
 #include "audio_processor.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
@@ -26,9 +30,15 @@
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> [Mixer: Voice] ----\
+ *    (Sounds) -> {Sound Queue}  -> [Opus Decoder] -> [Mixer: Notification] -> [Mixer] -> (Speaker)
+ *    (Music)  -> [Downmix*] -> [Polyphase Resampler] -> [Mixer: Music] ---/
  *
  * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * The mixer runs in the output task, so the codec always plays one stream at its own sample rate
+ * and channel count. Voice and sounds are mono and are copied to both channels on stereo codecs;
+ * stereo music stays stereo through the resampler and mixer, and is only downmixed (*) when the
+ * codec output is mono.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
  * 
@@ -37,6 +47,8 @@
 #define OPUS_FRAME_DURATION_MS 60
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
+#define MAX_MUSIC_QUEUE_DURATION_MS 300
+#define MIXER_FADE_DURATION_MS CONFIG_AUDIO_FADE_DURATION_MS
 #define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
@@ -62,7 +74,6 @@ struct AudioServiceCallbacks {
 enum AudioTaskType {
     kAudioTaskTypeEncodeToSendQueue,
     kAudioTaskTypeEncodeToTestingQueue,
-    kAudioTaskTypeDecodeToPlaybackQueue,
 };
 
 struct AudioTask {
@@ -78,6 +89,19 @@ struct DebugStatistics {
     uint32_t playback_count = 0;
 };
 
+struct MusicDspStats {
+    MusicEqPreset eq_preset = kMusicEqFlat;
+    bool normalization = false;
+    float loudness_lufs = -70.0f;
+    float gain_db = 0.0f;
+    uint32_t limited_samples = 0;
+    // CPU cycles per pushed music frame, and the share of one core they take at the playback rate
+    uint32_t frames = 0;
+    uint32_t avg_cycles = 0;
+    uint32_t max_cycles = 0;
+    float cpu_percent = 0.0f;
+};
+
 class AudioService {
 public:
     AudioService();
@@ -106,6 +130,22 @@ public:
     void PlaySound(const std::string_view& sound);
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
+
+    // Music PCM (mono or interleaved stereo) is resampled to the output sample rate and mixed with voice / sounds.
+    // Blocks while the music queue is full, returns false if the music was flushed meanwhile.
+    bool PushMusicData(std::vector<int16_t>&& pcm, int sample_rate, int channels = 1);
+    void FlushMusic();
+    // Paused music stays queued in the mixer and continues where it stopped on resume
+    void PauseMusic(bool paused);
+    // Music playback clock in ms, monotonic across tracks and flushes. GetMusicEndClockMs() is the clock
+    // value at which the next pushed music sample will be heard, GetMusicPlaybackClockMs() the value
+    // coming out of the speaker now. Players map their stream position onto the clock when pushing PCM.
+    int64_t GetMusicEndClockMs();
+    int64_t GetMusicPlaybackClockMs();
+    // Music equalizer and loudness normalization, saved to settings and applied from the next pushed frame
+    void SetMusicEqPreset(MusicEqPreset preset);
+    void SetMusicNormalization(bool enabled);
+    MusicDspStats GetMusicDspStats() const;
     
     void UpdateOutputTimestamp();
 
@@ -131,10 +171,11 @@ private:
     std::mutex audio_queue_mutex_;
     std::condition_variable audio_queue_cv_;
     std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
+    std::deque<std::unique_ptr<AudioStreamPacket>> audio_sound_queue_;
     std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
     std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
     std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
+    AudioMixer audio_mixer_;
     // For server AEC
     std::deque<uint32_t> timestamp_queue_;
 
@@ -144,6 +185,22 @@ private:
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
 
+    // Music resampler, only touched by the music thread
+    PolyphaseResampler music_resampler_;
+    uint32_t music_resampler_flush_count_ = 0;
+    // Increased by FlushMusic() to abort a blocked PushMusicData() and restart the resampler
+    std::atomic<uint32_t> music_flush_count_{0};
+    // Music frames mixed (or flushed) and already written to the codec, for the playback clock
+    std::atomic<uint64_t> music_output_frames_{0};
+    // Music EQ / loudness stage, only touched by the music thread like the resampler
+    MusicDsp music_dsp_;
+    std::atomic<MusicEqPreset> music_eq_preset_{kMusicEqFlat};
+    std::atomic<bool> music_normalization_{true};
+    std::atomic<uint32_t> music_dsp_frames_{0};
+    std::atomic<uint64_t> music_dsp_cycles_{0};
+    std::atomic<uint32_t> music_dsp_max_cycles_{0};
+    std::atomic<uint64_t> music_dsp_samples_{0};   // sample frames processed, for the CPU load
+
     esp_timer_handle_t audio_power_timer_ = nullptr;
     std::chrono::steady_clock::time_point last_input_time_;
     std::chrono::steady_clock::time_point last_output_time_;
@@ -153,6 +210,8 @@ private:
     void OpusCodecTask();
     void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    bool ResampleMusic(const std::vector<int16_t>& input, int input_rate, int channels, std::vector<int16_t>& output);
+    void ProcessMusicDsp(std::vector<int16_t>& pcm, int channels);
     void CheckAndUpdateAudioPowerState();
 };
 
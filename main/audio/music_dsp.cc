@@ -0,0 +1,302 @@
+#include "music_dsp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/* Limiter knee (-3 dBFS) and the gain slew rates of the loudness normalization */
+#define MUSIC_DSP_LIMITER_THRESHOLD 23197
+#define MUSIC_DSP_GAIN_DOWN_DB_PER_SECOND 10.0f
+#define MUSIC_DSP_GAIN_UP_DB_PER_SECOND 3.0f
+/* Below this short-term loudness (intros, pauses between songs) the gain is held */
+#define MUSIC_DSP_SILENCE_LUFS -50.0f
+/* Blocks measured before the gain starts to follow the loudness */
+#define MUSIC_DSP_MIN_LOUDNESS_BLOCKS 4
+/* K-weighted samples are squared at 16-bit scale times 4 */
+#define MUSIC_DSP_ENERGY_SHIFT (MUSIC_DSP_SAMPLE_SHIFT - 2)
+
+enum EqBandType {
+    kEqLowShelf,
+    kEqPeaking,
+    kEqHighShelf,
+};
+
+struct EqBand {
+    EqBandType type;
+    double frequency;
+    double q;
+    double gain_db;
+};
+
+struct EqPreset {
+    const char* name;
+    int band_count;
+    EqBand bands[MUSIC_DSP_MAX_EQ_BANDS];
+};
+
+static const EqPreset kEqPresets[kMusicEqPresetCount] = {
+    {"flat", 0, {}},
+    {"bass", 2, {{kEqLowShelf, 120, 0.707, 6.0}, {kEqPeaking, 400, 1.0, -1.5}}},
+    {"vocal", 2, {{kEqLowShelf, 150, 0.707, -2.0}, {kEqPeaking, 2500, 1.0, 3.0}}},
+    {"treble", 1, {{kEqHighShelf, 5000, 0.707, 5.0}}},
+    {"speaker", 3, {{kEqLowShelf, 180, 0.707, 5.0}, {kEqPeaking, 500, 1.2, -2.0}, {kEqPeaking, 3000, 1.0, 2.0}}},
+};
+
+static MusicDspBiquad Quantize(double b0, double b1, double b2, double a0, double a1, double a2) {
+    const double scale = (double)(1 << MUSIC_DSP_COEF_SHIFT) / a0;
+    MusicDspBiquad biquad;
+    biquad.b0 = (int32_t)std::lrint(b0 * scale);
+    biquad.b1 = (int32_t)std::lrint(b1 * scale);
+    biquad.b2 = (int32_t)std::lrint(b2 * scale);
+    biquad.a1 = (int32_t)std::lrint(a1 * scale);
+    biquad.a2 = (int32_t)std::lrint(a2 * scale);
+    return biquad;
+}
+
+// Audio EQ Cookbook (R. Bristow-Johnson) shelving and peaking filters
+static MusicDspBiquad DesignEqBand(const EqBand& band, int sample_rate) {
+    double frequency = std::min(band.frequency, sample_rate * 0.45);
+    double a = std::pow(10.0, band.gain_db / 40.0);
+    double w0 = 2.0 * M_PI * frequency / sample_rate;
+    double cos_w0 = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * band.q);
+    double sqrt_a_alpha = 2.0 * std::sqrt(a) * alpha;
+
+    switch (band.type) {
+    case kEqLowShelf:
+        return Quantize(a * ((a + 1) - (a - 1) * cos_w0 + sqrt_a_alpha),
+                        2 * a * ((a - 1) - (a + 1) * cos_w0),
+                        a * ((a + 1) - (a - 1) * cos_w0 - sqrt_a_alpha),
+                        (a + 1) + (a - 1) * cos_w0 + sqrt_a_alpha,
+                        -2 * ((a - 1) + (a + 1) * cos_w0),
+                        (a + 1) + (a - 1) * cos_w0 - sqrt_a_alpha);
+    case kEqHighShelf:
+        return Quantize(a * ((a + 1) + (a - 1) * cos_w0 + sqrt_a_alpha),
+                        -2 * a * ((a - 1) + (a + 1) * cos_w0),
+                        a * ((a + 1) + (a - 1) * cos_w0 - sqrt_a_alpha),
+                        (a + 1) - (a - 1) * cos_w0 + sqrt_a_alpha,
+                        2 * ((a - 1) - (a + 1) * cos_w0),
+                        (a + 1) - (a - 1) * cos_w0 - sqrt_a_alpha);
+    default:
+        return Quantize(1 + alpha * a, -2 * cos_w0, 1 - alpha * a,
+                        1 + alpha / a, -2 * cos_w0, 1 - alpha / a);
+    }
+}
+
+// Direct form I, samples have MUSIC_DSP_SAMPLE_SHIFT fractional bits
+static inline int32_t BiquadStep(const MusicDspBiquad& f, MusicDspBiquadState& s, int32_t x) {
+    int64_t acc = (int64_t)f.b0 * x + (int64_t)f.b1 * s.x1 + (int64_t)f.b2 * s.x2 -
+                  (int64_t)f.a1 * s.y1 - (int64_t)f.a2 * s.y2;
+    int32_t y = (int32_t)((acc + (1 << (MUSIC_DSP_COEF_SHIFT - 1))) >> MUSIC_DSP_COEF_SHIFT);
+    s.x2 = s.x1;
+    s.x1 = x;
+    s.y2 = s.y1;
+    s.y1 = y;
+    return y;
+}
+
+// Filters one channel of an interleaved buffer in place, the state is kept in registers over the loop
+static void RunBiquad(const MusicDspBiquad& f, MusicDspBiquadState& state, int32_t* samples, size_t frames, int stride) {
+    MusicDspBiquadState s = state;
+    for (size_t i = 0; i < frames; i++) {
+        samples[i * stride] = BiquadStep(f, s, samples[i * stride]);
+    }
+    state = s;
+}
+
+// Compresses the part above the knee along t + e * r / (e + r): slope 1 at the knee, approaching
+// full scale for large excess e
+static inline int16_t SoftLimit(int32_t value, uint32_t* limited) {
+    const int32_t range = INT16_MAX - MUSIC_DSP_LIMITER_THRESHOLD;
+    int32_t magnitude = value < 0 ? -value : value;
+    if (magnitude <= MUSIC_DSP_LIMITER_THRESHOLD) {
+        return (int16_t)value;
+    }
+    (*limited)++;
+    int32_t excess = magnitude - MUSIC_DSP_LIMITER_THRESHOLD;
+    magnitude = MUSIC_DSP_LIMITER_THRESHOLD + (int32_t)((int64_t)excess * range / (excess + range));
+    return (int16_t)(value < 0 ? -magnitude : magnitude);
+}
+
+MusicDsp::MusicDsp() {
+    Configure(16000, 1);
+}
+
+void MusicDsp::Configure(int sample_rate, int channels) {
+    channels = std::max(1, std::min(MUSIC_DSP_MAX_CHANNELS, channels));
+    if (sample_rate == sample_rate_ && channels == channels_) {
+        return;
+    }
+    if (sample_rate != sample_rate_) {
+        sample_rate_ = sample_rate;
+        block_frames_ = sample_rate / 10;
+        block_position_ = 0;
+        block_energy_ = 0;
+        BuildEqualizer();
+        BuildKWeighting();
+    }
+    channels_ = channels;
+    Reset();
+}
+
+void MusicDsp::Reset() {
+    for (auto& band : eq_state_) {
+        for (auto& state : band) {
+            state = MusicDspBiquadState();
+        }
+    }
+    for (auto& stage : k_state_) {
+        for (auto& state : stage) {
+            state = MusicDspBiquadState();
+        }
+    }
+}
+
+void MusicDsp::SetEqPreset(MusicEqPreset preset) {
+    if (preset < 0 || preset >= kMusicEqPresetCount || preset == eq_preset_) {
+        return;
+    }
+    eq_preset_ = preset;
+    BuildEqualizer();
+    for (auto& band : eq_state_) {
+        for (auto& state : band) {
+            state = MusicDspBiquadState();
+        }
+    }
+}
+
+void MusicDsp::SetNormalization(bool enabled, float target_lufs) {
+    normalization_ = enabled;
+    target_lufs_ = target_lufs;
+}
+
+const char* MusicDsp::PresetName(MusicEqPreset preset) {
+    if (preset < 0 || preset >= kMusicEqPresetCount) {
+        return "unknown";
+    }
+    return kEqPresets[preset].name;
+}
+
+MusicEqPreset MusicDsp::PresetFromName(const char* name) {
+    for (int i = 0; i < kMusicEqPresetCount; i++) {
+        if (strcmp(kEqPresets[i].name, name) == 0) {
+            return (MusicEqPreset)i;
+        }
+    }
+    return kMusicEqPresetCount;
+}
+
+void MusicDsp::BuildEqualizer() {
+    const EqPreset& preset = kEqPresets[eq_preset_];
+    eq_band_count_ = preset.band_count;
+    for (int i = 0; i < eq_band_count_; i++) {
+        eq_[i] = DesignEqBand(preset.bands[i], sample_rate_);
+    }
+}
+
+// ITU-R BS.1770 K-weighting: a +4 dB high shelf modelling the head, then the RLB high-pass
+void MusicDsp::BuildKWeighting() {
+    double k = std::tan(M_PI * 1681.974450955533 / sample_rate_);
+    double q = 0.7071752369554196;
+    double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    k_shelf_ = Quantize(vh + vb * k / q + k * k, 2.0 * (k * k - vh), vh - vb * k / q + k * k,
+                        1.0 + k / q + k * k, 2.0 * (k * k - 1.0), 1.0 - k / q + k * k);
+
+    k = std::tan(M_PI * 38.13547087602444 / sample_rate_);
+    q = 0.5003270373238773;
+    double a0 = 1.0 + k / q + k * k;
+    k_highpass_ = Quantize(a0, -2.0 * a0, a0, a0, 2.0 * (k * k - 1.0), 1.0 - k / q + k * k);
+}
+
+void MusicDsp::Process(int16_t* pcm, size_t frames) {
+    if (!active() || frames == 0) {
+        return;
+    }
+    size_t samples = frames * channels_;
+    if (work_.size() < samples) {
+        work_.resize(samples);
+    }
+    int32_t* work = work_.data();
+    for (size_t i = 0; i < samples; i++) {
+        work[i] = (int32_t)pcm[i] * (1 << MUSIC_DSP_SAMPLE_SHIFT);
+    }
+
+    for (int band = 0; band < eq_band_count_; band++) {
+        for (int c = 0; c < channels_; c++) {
+            RunBiquad(eq_[band], eq_state_[band][c], work + c, frames, channels_);
+        }
+    }
+    if (normalization_) {
+        MeasureLoudness(work, frames);
+    }
+    ApplyGainAndLimit(pcm, frames);
+}
+
+void MusicDsp::MeasureLoudness(const int32_t* samples, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        for (int c = 0; c < channels_; c++) {
+            int32_t y = BiquadStep(k_highpass_, k_state_[1][c],
+                                   BiquadStep(k_shelf_, k_state_[0][c], samples[i * channels_ + c]));
+            y >>= MUSIC_DSP_ENERGY_SHIFT;
+            block_energy_ += (int64_t)y * y;
+        }
+        if (++block_position_ >= block_frames_) {
+            FinishLoudnessBlock();
+        }
+    }
+}
+
+void MusicDsp::FinishLoudnessBlock() {
+    // Mean square relative to full scale, summed over the channels as in BS.1770
+    const double full_scale = (double)(1LL << (2 * (15 + MUSIC_DSP_SAMPLE_SHIFT - MUSIC_DSP_ENERGY_SHIFT)));
+    block_loudness_[block_count_ % kLoudnessBlocks] = (double)block_energy_ / block_frames_ / full_scale;
+    block_count_++;
+    block_energy_ = 0;
+    block_position_ = 0;
+
+    int count = std::min(block_count_, kLoudnessBlocks);
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += block_loudness_[i];
+    }
+    double mean_square = sum / count;
+    float lufs = mean_square > 0 ? (float)(-0.691 + 10.0 * std::log10(mean_square)) : -70.0f;
+    lufs = std::max(lufs, -70.0f);
+    loudness_lufs_.store(lufs, std::memory_order_relaxed);
+
+    if (count >= MUSIC_DSP_MIN_LOUDNESS_BLOCKS && lufs > MUSIC_DSP_SILENCE_LUFS) {
+        target_gain_db_ = std::max(-MUSIC_DSP_MAX_GAIN_DB, std::min(MUSIC_DSP_MAX_GAIN_DB, target_lufs_ - lufs));
+    }
+}
+
+void MusicDsp::ApplyGainAndLimit(int16_t* pcm, size_t frames) {
+    // Move towards the target gain at a limited rate, ramping linearly over this call. With
+    // normalization off the gain returns to unity the same way.
+    float gain_db = gain_db_.load(std::memory_order_relaxed);
+    float target_db = normalization_ ? target_gain_db_ : 0.0f;
+    float seconds = (float)frames / sample_rate_;
+    float max_step = (target_db < gain_db ? MUSIC_DSP_GAIN_DOWN_DB_PER_SECOND : MUSIC_DSP_GAIN_UP_DB_PER_SECOND) * seconds;
+    gain_db += std::max(-max_step, std::min(max_step, target_db - gain_db));
+    gain_db_.store(gain_db, std::memory_order_relaxed);
+
+    int32_t end_q14 = (int32_t)std::lrint(std::pow(10.0f, gain_db / 20.0f) * (1 << 14));
+    int64_t gain_q30 = (int64_t)gain_q14_ << 16;
+    int64_t step_q30 = ((int64_t)(end_q14 - gain_q14_) << 16) / (int64_t)frames;
+    gain_q14_ = end_q14;
+
+    const int32_t* work = work_.data();
+    uint32_t limited = 0;
+    for (size_t i = 0; i < frames; i++) {
+        gain_q30 += step_q30;
+        int32_t gain = (int32_t)(gain_q30 >> 16);
+        for (int c = 0; c < channels_; c++) {
+            int64_t value = ((int64_t)work[i * channels_ + c] * gain) >> (14 + MUSIC_DSP_SAMPLE_SHIFT);
+            value = std::max<int64_t>(-(1 << 30), std::min<int64_t>(1 << 30, value));
+            pcm[i * channels_ + c] = SoftLimit((int32_t)value, &limited);
+        }
+    }
+    if (limited > 0) {
+        limited_samples_.fetch_add(limited, std::memory_order_relaxed);
+    }
+}
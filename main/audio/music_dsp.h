@@ -0,0 +1,118 @@
+#ifndef MUSIC_DSP_H
+#define MUSIC_DSP_H
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Streaming DSP stage for music PCM (16-bit mono or interleaved stereo), applied in place after
+ * resampling to the output sample rate:
+ *
+ * 1. Equalizer: a cascade of up to MUSIC_DSP_MAX_EQ_BANDS biquads (RBJ shelves / peaking filters)
+ *    selected by preset.
+ * 2. Loudness normalization: the equalized signal is K-weighted (ITU-R BS.1770) and its energy
+ *    summed in 100 ms blocks, the mean of the last 3 s gives the EBU R128 short-term loudness.
+ *    The gain follows target - loudness, limited to +-MUSIC_DSP_MAX_GAIN_DB and slew-rate limited
+ *    (faster down than up), and is ramped per sample between calls. Silent passages hold the gain.
+ * 3. Soft limiter: samples above -3 dBFS are compressed along a rational curve that approaches
+ *    full scale asymptotically, so EQ boost and normalization gain never wrap or hard clip.
+ *
+ * Samples are processed as 32-bit integers with 8 fractional bits, biquad coefficients are Q29 with
+ * 64-bit accumulation (precise enough for the 38 Hz K-weighting high-pass at 48 kHz). Filter
+ * coefficients are computed in double when the preset or format changes, the per-sample path is
+ * integer only. The loudness state survives Reset(), so a seek does not restart the gain.
+ *
+ * Not thread safe and independent of ESP-IDF; loudness_lufs() and gain_db() may be read from any thread.
+ */
+
+#define MUSIC_DSP_MAX_CHANNELS 2
+#define MUSIC_DSP_MAX_EQ_BANDS 4
+#define MUSIC_DSP_COEF_SHIFT 29
+#define MUSIC_DSP_SAMPLE_SHIFT 8
+#define MUSIC_DSP_MAX_GAIN_DB 12.0f
+
+enum MusicEqPreset {
+    kMusicEqFlat,
+    kMusicEqBass,
+    kMusicEqVocal,
+    kMusicEqTreble,
+    kMusicEqSpeaker,    // compensates small full-range speakers: more bass and presence, less boxiness
+    kMusicEqPresetCount,
+};
+
+struct MusicDspBiquad {
+    int32_t b0, b1, b2, a1, a2;     // Q29, a0 normalized to 1
+};
+
+struct MusicDspBiquadState {
+    int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+};
+
+class MusicDsp {
+public:
+    MusicDsp();
+
+    void Configure(int sample_rate, int channels);
+    // Clears the filter history for a new stream
+    void Reset();
+
+    void SetEqPreset(MusicEqPreset preset);
+    MusicEqPreset eq_preset() const { return eq_preset_; }
+    void SetNormalization(bool enabled, float target_lufs);
+    bool normalization() const { return normalization_; }
+    // False when Process() would not change the samples
+    bool active() const { return eq_band_count_ > 0 || normalization_; }
+
+    void Process(int16_t* pcm, size_t frames);
+
+    int sample_rate() const { return sample_rate_; }
+    int channels() const { return channels_; }
+    // Short-term loudness of the equalized music, -70 when not measured yet
+    float loudness_lufs() const { return loudness_lufs_.load(std::memory_order_relaxed); }
+    float gain_db() const { return gain_db_.load(std::memory_order_relaxed); }
+    // Samples compressed by the limiter
+    uint32_t limited_samples() const { return limited_samples_.load(std::memory_order_relaxed); }
+
+    static const char* PresetName(MusicEqPreset preset);
+    // Returns kMusicEqPresetCount for unknown names
+    static MusicEqPreset PresetFromName(const char* name);
+
+private:
+    static constexpr int kLoudnessBlocks = 30;      // 30 x 100 ms = 3 s short-term window
+
+    int sample_rate_ = 0;
+    int channels_ = 1;
+    std::vector<int32_t> work_;
+
+    MusicEqPreset eq_preset_ = kMusicEqFlat;
+    int eq_band_count_ = 0;
+    MusicDspBiquad eq_[MUSIC_DSP_MAX_EQ_BANDS];
+    MusicDspBiquadState eq_state_[MUSIC_DSP_MAX_EQ_BANDS][MUSIC_DSP_MAX_CHANNELS];
+
+    bool normalization_ = false;
+    float target_lufs_ = -16.0f;
+    MusicDspBiquad k_shelf_;
+    MusicDspBiquad k_highpass_;
+    MusicDspBiquadState k_state_[2][MUSIC_DSP_MAX_CHANNELS];
+    size_t block_frames_ = 0;       // frames per 100 ms block
+    size_t block_position_ = 0;
+    int64_t block_energy_ = 0;
+    double block_loudness_[kLoudnessBlocks] = {};   // mean square per block, relative to full scale
+    int block_count_ = 0;
+    float target_gain_db_ = 0.0f;
+
+    std::atomic<float> loudness_lufs_{-70.0f};
+    std::atomic<float> gain_db_{0.0f};
+    int32_t gain_q14_ = 1 << 14;
+    std::atomic<uint32_t> limited_samples_{0};
+
+    void BuildEqualizer();
+    void BuildKWeighting();
+    void MeasureLoudness(const int32_t* samples, size_t frames);
+    void FinishLoudnessBlock();
+    void ApplyGainAndLimit(int16_t* pcm, size_t frames);
+};
+
+#endif // MUSIC_DSP_H
@@ -0,0 +1,26 @@
+#include "pcm_channels.h"
+
+#include <cstring>
+
+// One 32-bit load per stereo frame (L in the low half on the little-endian targets we run on),
+// four frames per iteration so the loads, adds and stores of neighbouring frames can be scheduled together
+static inline int16_t Average(uint32_t frame) {
+    int32_t left = (int16_t)(frame & 0xFFFF);
+    int32_t right = (int16_t)(frame >> 16);
+    return (int16_t)((left + right) >> 1);
+}
+
+void DownmixStereoToMono(const int16_t* stereo, size_t frames, int16_t* mono) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        uint32_t words[4];
+        memcpy(words, stereo + i * 2, sizeof(words));
+        mono[i] = Average(words[0]);
+        mono[i + 1] = Average(words[1]);
+        mono[i + 2] = Average(words[2]);
+        mono[i + 3] = Average(words[3]);
+    }
+    for (; i < frames; i++) {
+        mono[i] = (int16_t)((stereo[i * 2] + stereo[i * 2 + 1]) >> 1);
+    }
+}
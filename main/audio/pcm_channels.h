@@ -0,0 +1,17 @@
+#ifndef PCM_CHANNELS_H
+#define PCM_CHANNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Channel conversion kernels for 16-bit interleaved PCM.
+ *
+ * Does not depend on ESP-IDF so it can be built and benchmarked on the host.
+ */
+
+// Averages the left and right samples of each interleaved stereo frame into one mono sample.
+// mono may point to stereo (in-place), the first frames samples are overwritten.
+void DownmixStereoToMono(const int16_t* stereo, size_t frames, int16_t* mono);
+
+#endif // PCM_CHANNELS_H
@@ -0,0 +1,192 @@
+#include "polyphase_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#ifdef ESP_PLATFORM
+#include <sdkconfig.h>
+#endif
+
+#if CONFIG_USE_ESP_DSP_RESAMPLER
+#include <dsps_dotprod.h>
+#endif
+
+/* Passband edge relative to the lower Nyquist frequency, and Kaiser window shape (~80 dB stopband) */
+#define POLYPHASE_RESAMPLER_ROLLOFF 0.92
+#define POLYPHASE_RESAMPLER_KAISER_BETA 8.0
+
+static double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+static inline int16_t Saturate(int32_t value) {
+    return (int16_t)std::max<int32_t>(INT16_MIN, std::min<int32_t>(INT16_MAX, value));
+}
+
+static inline int16_t DotProduct(const int16_t* samples, const int16_t* coefficients, int taps) {
+#if CONFIG_USE_ESP_DSP_RESAMPLER
+    // esp-dsp returns (sum >> 15) truncated to 16 bits, with Q14 coefficients that is half scale,
+    // which leaves headroom for filter overshoot instead of wrapping around
+    int16_t result;
+    dsps_dotprod_s16(samples, coefficients, &result, taps, 0);
+    return Saturate((int32_t)result * 2);
+#else
+    int32_t acc = 1 << (POLYPHASE_RESAMPLER_COEF_SHIFT - 1);
+    for (int i = 0; i < taps; i += 4) {
+        acc += samples[i] * coefficients[i];
+        acc += samples[i + 1] * coefficients[i + 1];
+        acc += samples[i + 2] * coefficients[i + 2];
+        acc += samples[i + 3] * coefficients[i + 3];
+    }
+    return Saturate(acc >> POLYPHASE_RESAMPLER_COEF_SHIFT);
+#endif
+}
+
+bool PolyphaseResampler::Configure(int input_sample_rate, int output_sample_rate, int channels) {
+    if (input_sample_rate <= 0 || output_sample_rate <= 0 || channels < 1 || channels > POLYPHASE_RESAMPLER_MAX_CHANNELS) {
+        return false;
+    }
+
+    int divisor = std::gcd(input_sample_rate, output_sample_rate);
+    int interpolation = output_sample_rate / divisor;
+    int decimation = input_sample_rate / divisor;
+    if (interpolation > POLYPHASE_RESAMPLER_MAX_PHASES) {
+        return false;
+    }
+
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    channels_ = channels;
+    interpolation_ = interpolation;
+    decimation_ = decimation;
+
+    // Downsampling needs a longer filter to keep the same transition band in output samples
+    double ratio = std::max(1.0, (double)decimation_ / interpolation_);
+    taps_ = (int)std::ceil(POLYPHASE_RESAMPLER_BASE_TAPS * ratio);
+    taps_ = (taps_ + 7) & ~7;
+
+    BuildCoefficients();
+    Reset();
+    return true;
+}
+
+void PolyphaseResampler::Reset() {
+    for (int c = 0; c < POLYPHASE_RESAMPLER_MAX_CHANNELS; c++) {
+        if (c < channels_) {
+            buffers_[c].assign(std::max(0, taps_ - 1), 0);
+        } else {
+            buffers_[c].clear();
+        }
+    }
+    phase_ = 0;
+    next_index_ = 0;
+}
+
+void PolyphaseResampler::BuildCoefficients() {
+    coefficients_.clear();
+    if (interpolation_ == 1 && decimation_ == 1) {
+        return;
+    }
+
+    const double cutoff = std::min(1.0, (double)interpolation_ / decimation_) * POLYPHASE_RESAMPLER_ROLLOFF;
+    const double half = taps_ / 2.0;
+    const double window_scale = 1.0 / BesselI0(POLYPHASE_RESAMPLER_KAISER_BETA);
+    const int unity = 1 << POLYPHASE_RESAMPLER_COEF_SHIFT;
+
+    coefficients_.resize((size_t)interpolation_ * taps_);
+    std::vector<double> row(taps_);
+    for (int p = 0; p < interpolation_; p++) {
+        // Tap j is applied to sample (newest - taps + 1 + j), the output lies p / L after sample (newest - half)
+        double sum = 0;
+        for (int j = 0; j < taps_; j++) {
+            double t = (half - 1 - j) + (double)p / interpolation_;
+            double x = cutoff * t;
+            double sinc = std::fabs(x) < 1e-9 ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+            double w = t / half;
+            double window = std::fabs(w) >= 1.0 ? 0.0 :
+                BesselI0(POLYPHASE_RESAMPLER_KAISER_BETA * std::sqrt(1.0 - w * w)) * window_scale;
+            row[j] = sinc * window;
+            sum += row[j];
+        }
+
+        // Normalize every phase to unity DC gain and put the rounding error on the largest tap
+        int16_t* phase = &coefficients_[(size_t)p * taps_];
+        int total = 0;
+        int largest = 0;
+        for (int j = 0; j < taps_; j++) {
+            phase[j] = (int16_t)std::lround(row[j] / sum * unity);
+            total += phase[j];
+            if (std::abs(phase[j]) > std::abs(phase[largest])) {
+                largest = j;
+            }
+        }
+        phase[largest] += unity - total;
+    }
+}
+
+int PolyphaseResampler::GetOutputSamples(int input_samples) const {
+    if (interpolation_ == 1 && decimation_ == 1) {
+        return input_samples;
+    }
+    int64_t span = (int64_t)(input_samples / channels_) * interpolation_ - ((int64_t)next_index_ * interpolation_ + phase_);
+    return span > 0 ? (int)((span + decimation_ - 1) / decimation_) * channels_ : 0;
+}
+
+int PolyphaseResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    if (taps_ == 0 || input_samples <= 0) {
+        return 0;
+    }
+    if (interpolation_ == 1 && decimation_ == 1) {
+        memcpy(output, input, input_samples * sizeof(int16_t));
+        return input_samples;
+    }
+
+    const int history = taps_ - 1;
+    const int frames = input_samples / channels_;
+    if (channels_ == 1) {
+        buffers_[0].resize(history + frames);
+        memcpy(buffers_[0].data() + history, input, frames * sizeof(int16_t));
+    } else {
+        // Deinterleave while appending to the history, this replaces the copy of the mono path
+        buffers_[0].resize(history + frames);
+        buffers_[1].resize(history + frames);
+        int16_t* left = buffers_[0].data() + history;
+        int16_t* right = buffers_[1].data() + history;
+        for (int i = 0; i < frames; i++) {
+            left[i] = input[i * 2];
+            right[i] = input[i * 2 + 1];
+        }
+    }
+
+    int produced = 0;
+    while (next_index_ < frames) {
+        // The window ends at input frame next_index_, i.e. buffers_[c][next_index_ + history]
+        const int16_t* phase = &coefficients_[(size_t)phase_ * taps_];
+        for (int c = 0; c < channels_; c++) {
+            output[produced++] = DotProduct(buffers_[c].data() + next_index_, phase, taps_);
+        }
+        phase_ += decimation_;
+        if (phase_ >= interpolation_) {
+            next_index_ += phase_ / interpolation_;
+            phase_ %= interpolation_;
+        }
+    }
+    next_index_ -= frames;
+
+    for (int c = 0; c < channels_; c++) {
+        memmove(buffers_[c].data(), buffers_[c].data() + frames, history * sizeof(int16_t));
+        buffers_[c].resize(history);
+    }
+    return produced;
+}
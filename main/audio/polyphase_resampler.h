@@ -0,0 +1,58 @@
+#ifndef POLYPHASE_RESAMPLER_H
+#define POLYPHASE_RESAMPLER_H
+
+#include <vector>
+#include <cstdint>
+
+/*
+ * Streaming fixed-point polyphase FIR resampler for 16-bit mono or interleaved stereo PCM.
+ *
+ * The ratio out/in is reduced to L/M and a windowed-sinc prototype filter is split into L phases
+ * of TAPS coefficients each (Q14). The coefficient table is computed once in Configure(), the
+ * per-sample path is integer only. Filter history and phase are kept between Process() calls,
+ * so frames of any size can be fed without clicks at the boundaries. Stereo input is split into one
+ * history buffer per channel while it is copied in, so the dot product always runs on contiguous
+ * samples and the output is written interleaved directly.
+ *
+ * Does not depend on ESP-IDF so it can be built and benchmarked on the host
+ * (see scripts/resampler_bench). With CONFIG_USE_ESP_DSP_RESAMPLER the dot product uses esp-dsp.
+ */
+
+#define POLYPHASE_RESAMPLER_BASE_TAPS 16
+#define POLYPHASE_RESAMPLER_MAX_PHASES 1024
+#define POLYPHASE_RESAMPLER_COEF_SHIFT 14
+#define POLYPHASE_RESAMPLER_MAX_CHANNELS 2
+
+class PolyphaseResampler {
+public:
+    bool Configure(int input_sample_rate, int output_sample_rate, int channels = 1);
+    void Reset();
+
+    // Sample counts include all channels. Returns the number of samples written,
+    // output must hold GetOutputSamples(input_samples)
+    int Process(const int16_t* input, int input_samples, int16_t* output);
+    int GetOutputSamples(int input_samples) const;
+
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+    int channels() const { return channels_; }
+    int taps() const { return taps_; }
+    int phases() const { return interpolation_; }
+
+private:
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    int channels_ = 1;
+    int interpolation_ = 1;   // L
+    int decimation_ = 1;      // M
+    int taps_ = 0;
+    std::vector<int16_t> coefficients_;  // interpolation_ x taps_, each phase ordered oldest sample first
+    // Per channel: taps_ - 1 samples of history followed by the current input
+    std::vector<int16_t> buffers_[POLYPHASE_RESAMPLER_MAX_CHANNELS];
+    int phase_ = 0;
+    int next_index_ = 0;      // input frame index (relative to the next call) of the newest sample of the next output
+
+    void BuildCoefficients();
+};
+
+#endif // POLYPHASE_RESAMPLER_H
@@ -0,0 +1,78 @@
+#include "aac_audio_decoder.h"
+#include "esp_audio_codec_utils.h"
+
+#include <esp_log.h>
+#include <esp_aac_dec.h>
+
+#define TAG "AacAudioDecoder"
+
+// 一帧AAC-LC解码后最多1024个样本/声道，按双声道预留
+#define AAC_MAX_FRAME_SAMPLES (1024 * 2)
+
+// ADTS帧长度（包括帧头），不是ADTS帧头时返回0
+static size_t GetAdtsFrameLength(const uint8_t* data, size_t size) {
+    if (size < 7 || data[0] != 0xFF || (data[1] & 0xF6) != 0xF0) {
+        return 0;
+    }
+    return ((size_t)(data[3] & 0x03) << 11) | ((size_t)data[4] << 3) | (data[5] >> 5);
+}
+
+AacAudioDecoder::~AacAudioDecoder() {
+    if (decoder_ != nullptr) {
+        esp_aac_dec_close(decoder_);
+    }
+}
+
+bool AacAudioDecoder::Probe(const uint8_t* data, size_t size) {
+    // 12位同步字，层固定为0，并且帧长度合理
+    return GetAdtsFrameLength(data, size) >= 7;
+}
+
+bool AacAudioDecoder::Initialize() {
+    esp_aac_dec_cfg_t config = {};
+    config.bits_per_sample = 16;
+    config.no_adts_header = false;
+    config.aac_plus_enable = false;
+    if (esp_aac_dec_open(&config, sizeof(config), &decoder_) != ESP_AUDIO_ERR_OK) {
+        ESP_LOGE(TAG, "Failed to open AAC decoder");
+        decoder_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AacAudioDecoder::Reset() {
+    if (decoder_ != nullptr) {
+        esp_aac_dec_close(decoder_);
+        decoder_ = nullptr;
+    }
+    Initialize();
+}
+
+AudioDecodeResult AacAudioDecoder::DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                               std::vector<int16_t>& pcm) {
+    *consumed = 0;
+    if (decoder_ == nullptr) {
+        return kAudioDecodeError;
+    }
+
+    // 重新同步到ADTS帧头
+    size_t offset = 0;
+    while (offset + 7 <= size && GetAdtsFrameLength(data + offset, size - offset) < 7) {
+        offset++;
+    }
+    if (offset > 0) {
+        *consumed = offset;
+        return kAudioDecodeSkipped;
+    }
+    size_t frame_length = GetAdtsFrameLength(data, size);
+    if (frame_length == 0 || frame_length > size) {
+        return kAudioDecodeNeedMoreData;
+    }
+
+    // 只送入一帧，解码器每次调用也只解码一帧
+    esp_audio_dec_in_raw_t raw = {};
+    raw.buffer = (uint8_t*)data;
+    raw.len = frame_length;
+    return DecodeEspAudioFrame(esp_aac_dec_decode, decoder_, &raw, AAC_MAX_FRAME_SAMPLES, consumed, pcm, frame_info_);
+}
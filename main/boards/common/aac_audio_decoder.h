@@ -0,0 +1,27 @@
+#ifndef AAC_AUDIO_DECODER_H
+#define AAC_AUDIO_DECODER_H
+
+#include "audio_decoder.h"
+
+// AAC-LC（ADTS封装）解码器，使用 esp_audio_codec 组件
+class AacAudioDecoder : public AudioDecoder {
+public:
+    ~AacAudioDecoder();
+
+    // 数据开头是否为ADTS帧头
+    static bool Probe(const uint8_t* data, size_t size);
+
+    AudioFormat format() const override { return kAudioFormatAac; }
+    const char* name() const override { return "AAC"; }
+    // ADTS帧长度字段为13位
+    size_t min_input_bytes() const override { return 8192; }
+    bool Initialize() override;
+    void Reset() override;
+    AudioDecodeResult DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                  std::vector<int16_t>& pcm) override;
+
+private:
+    void* decoder_ = nullptr;
+};
+
+#endif // AAC_AUDIO_DECODER_H
@@ -0,0 +1,33 @@
+#include "audio_decoder.h"
+#include "mp3_audio_decoder.h"
+#include "aac_audio_decoder.h"
+#include "flac_audio_decoder.h"
+#include "ogg_opus_audio_decoder.h"
+
+#include <esp_log.h>
+
+#define TAG "AudioDecoder"
+
+std::unique_ptr<AudioDecoder> AudioDecoder::Create(const uint8_t* data, size_t size, int output_sample_rate) {
+    std::unique_ptr<AudioDecoder> decoder;
+    if (FlacAudioDecoder::Probe(data, size)) {
+        decoder = std::make_unique<FlacAudioDecoder>();
+    } else if (OggOpusAudioDecoder::Probe(data, size)) {
+        decoder = std::make_unique<OggOpusAudioDecoder>(output_sample_rate);
+    } else if (AacAudioDecoder::Probe(data, size)) {
+        decoder = std::make_unique<AacAudioDecoder>();
+    } else {
+        // MP3帧头，或者无法识别（例如seek后的中间位置），由MP3解码器搜索同步字
+        if (!Mp3AudioDecoder::Probe(data, size) && size >= 4) {
+            ESP_LOGW(TAG, "Unknown audio format, first 4 bytes: %02X %02X %02X %02X, trying MP3",
+                    data[0], data[1], data[2], data[3]);
+        }
+        decoder = std::make_unique<Mp3AudioDecoder>();
+    }
+
+    if (!decoder->Initialize()) {
+        return nullptr;
+    }
+    ESP_LOGI(TAG, "Created %s decoder", decoder->name());
+    return decoder;
+}
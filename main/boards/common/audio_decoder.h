@@ -0,0 +1,66 @@
+#ifndef AUDIO_DECODER_H
+#define AUDIO_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum AudioFormat {
+    kAudioFormatMp3,
+    kAudioFormatAac,
+    kAudioFormatFlac,
+    kAudioFormatOggOpus,
+};
+
+enum AudioDecodeResult {
+    kAudioDecodeOk,             // 解码出一帧PCM（可能为0个样本，例如头部帧）
+    kAudioDecodeSkipped,        // 消耗了头部、同步或封装数据，没有输出
+    kAudioDecodeNeedMoreData,   // 剩余数据不足一帧，未消耗数据
+    kAudioDecodeError,          // 数据损坏，已跳过 consumed 字节
+};
+
+// 最近一帧的参数
+struct AudioFrameInfo {
+    int sample_rate = 0;
+    int channels = 0;
+    int bitrate = 0;            // bps，未知为0
+    int samples = 0;            // 每声道样本数
+};
+
+/*
+ * 音乐解码器接口，由播放线程直接在环形缓冲区的连续区间上调用：
+ *
+ * - Create()：根据数据开头（已跳过ID3标签）识别格式并创建对应的解码器，无法识别时按MP3处理；
+ *   output_sample_rate 为codec的输出采样率，能直接按该采样率输出的解码器（Opus）会省掉重采样
+ * - DecodeFrame()：传入（feed）从当前读位置开始的连续数据，最多解码一帧，
+ *   通过 consumed 返回消耗的字节数，PCM按 channels 交错写入 pcm
+ * - Reset()：丢弃解码器内部状态（seek后从新位置继续）
+ *
+ * 调用方保证传入的连续数据至少为 min(剩余数据, min_input_bytes())。
+ */
+class AudioDecoder {
+public:
+    virtual ~AudioDecoder() = default;
+
+    static std::unique_ptr<AudioDecoder> Create(const uint8_t* data, size_t size, int output_sample_rate = 0);
+    // 识别格式需要的数据量
+    static constexpr size_t kProbeBytes = 64;
+    // 各解码器 min_input_bytes() 的上限，环形缓冲区的镜像区按此大小分配
+    static constexpr size_t kMaxInputBytes = 24 * 1024;
+
+    virtual AudioFormat format() const = 0;
+    virtual const char* name() const = 0;
+    virtual size_t min_input_bytes() const = 0;
+    virtual bool Initialize() = 0;
+    virtual void Reset() = 0;
+    virtual AudioDecodeResult DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                          std::vector<int16_t>& pcm) = 0;
+
+    const AudioFrameInfo& frame_info() const { return frame_info_; }
+
+protected:
+    AudioFrameInfo frame_info_;
+};
+
+#endif // AUDIO_DECODER_H
@@ -2,19 +2,21 @@
 #include "board.h"
 #include "system_info.h"
 #include "audio/audio_codec.h"
+#include "audio/pcm_channels.h"
 #include "application.h"
 #include "protocols/protocol.h"
 #include "display/display.h"
+#include "device_state_event.h"
 
 #include <esp_log.h>
 #include <esp_heap_caps.h>
 #include <esp_pthread.h>
 #include <esp_timer.h>
+#include <esp_cpu.h>
 #include <mbedtls/sha256.h>
 #include <cJSON.h>
 #include <cstring>
 #include <chrono>
-#include <sstream>
 #include <algorithm>
 #include <cctype>  // 为isdigit函数
 #include <thread>   // 为线程ID比较
@@ -166,192 +168,204 @@ static std::string buildUrlWithParams(const std::string& base_url, const std::st
 }
 
 Esp32Music::Esp32Music() : last_downloaded_data_(), current_music_url_(), current_song_name_(),
-                         song_name_displayed_(false), current_lyric_url_(), lyrics_(), 
-                         current_lyric_index_(-1), lyric_thread_(), is_lyric_running_(false),
+                         song_name_displayed_(false), current_lyric_url_(), 
+                         current_lyric_index_(-1),
                          display_mode_(DISPLAY_MODE_LYRICS), is_playing_(false), is_downloading_(false), 
-                         play_thread_(), download_thread_(), audio_buffer_(), buffer_mutex_(), 
-                         buffer_cv_(), buffer_size_(0), mp3_decoder_(nullptr), mp3_frame_info_(), 
-                         mp3_decoder_initialized_(false) {
+                         play_thread_(), download_thread_(), audio_buffer_(MAX_BUFFER_SIZE, AudioDecoder::kMaxInputBytes),
+                         prefetch_buffer_(PREFETCH_BUFFER_SIZE, AudioDecoder::kMaxInputBytes), play_buffer_(&audio_buffer_),
+                         jitter_(MAX_BUFFER_SIZE) {
     ESP_LOGI(TAG, "Music player initialized with default spectrum display mode");
-    InitializeMp3Decoder();
+    cache_.Initialize();
+    library_.Start();
+
+    // 播放器与板子同生命周期，回调不需要注销
+    DeviceStateEventManager::GetInstance().RegisterStateChangeCallback(
+        [this](DeviceState previous_state, DeviceState current_state) {
+            OnDeviceStateChanged(previous_state, current_state);
+        });
 }
 
 Esp32Music::~Esp32Music() {
     ESP_LOGI(TAG, "Destroying music player - stopping all operations");
     
-    // 停止所有操作
-    is_downloading_ = false;
-    is_playing_ = false;
-    is_lyric_running_ = false;
-    
-    // 通知所有等待的线程
+    // 使排队中的启动任务失效并取消当前播放，正在下载的歌词也会立即返回，工作线程可以很快退出
     {
-        std::lock_guard<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.notify_all();
-    }
-    
-    // 等待下载线程结束，设置5秒超时
-    if (download_thread_.joinable()) {
-        ESP_LOGI(TAG, "Waiting for download thread to finish (timeout: 5s)");
-        auto start_time = std::chrono::steady_clock::now();
-        
-        // 等待线程结束
-        bool thread_finished = false;
-        while (!thread_finished) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::steady_clock::now() - start_time).count();
-            
-            if (elapsed >= 5) {
-                ESP_LOGW(TAG, "Download thread join timeout after 5 seconds");
-                break;
-            }
-            
-            // 再次设置停止标志，确保线程能够检测到
-            is_downloading_ = false;
-            
-            // 通知条件变量
-            {
-                std::lock_guard<std::mutex> lock(buffer_mutex_);
-                buffer_cv_.notify_all();
-            }
-            
-            // 检查线程是否已经结束
-            if (!download_thread_.joinable()) {
-                thread_finished = true;
-            }
-            
-            // 定期打印等待信息
-            if (elapsed > 0 && elapsed % 1 == 0) {
-                ESP_LOGI(TAG, "Still waiting for download thread to finish... (%ds)", (int)elapsed);
-            }
-        }
-        
-        if (download_thread_.joinable()) {
-            download_thread_.join();
-        }
-        ESP_LOGI(TAG, "Download thread finished");
-    }
-    
-    // 等待播放线程结束，设置3秒超时
-    if (play_thread_.joinable()) {
-        ESP_LOGI(TAG, "Waiting for playback thread to finish (timeout: 3s)");
-        auto start_time = std::chrono::steady_clock::now();
-        
-        bool thread_finished = false;
-        while (!thread_finished) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::steady_clock::now() - start_time).count();
-            
-            if (elapsed >= 3) {
-                ESP_LOGW(TAG, "Playback thread join timeout after 3 seconds");
-                break;
-            }
-            
-            // 再次设置停止标志
-            is_playing_ = false;
-            
-            // 通知条件变量
-            {
-                std::lock_guard<std::mutex> lock(buffer_mutex_);
-                buffer_cv_.notify_all();
-            }
-            
-            // 检查线程是否已经结束
-            if (!play_thread_.joinable()) {
-                thread_finished = true;
-            }
-        }
-        
-        if (play_thread_.joinable()) {
-            play_thread_.join();
-        }
-        ESP_LOGI(TAG, "Playback thread finished");
+        std::lock_guard<std::recursive_mutex> lock(stream_mutex_);
+        play_generation_++;
+        CancelStreaming();
     }
-    
-    // 等待歌词线程结束
-    if (lyric_thread_.joinable()) {
-        ESP_LOGI(TAG, "Waiting for lyric thread to finish");
-        lyric_thread_.join();
-        ESP_LOGI(TAG, "Lyric thread finished");
+    CancelLyrics();
+    worker_.Stop();
+
+    // 工作线程退出前可能刚启动了新的音频流
+    {
+        std::lock_guard<std::recursive_mutex> lock(stream_mutex_);
+        CancelStreaming();
     }
     
-    // 清理缓冲区和MP3解码器
+    // 清理缓冲区
     ClearAudioBuffer();
-    CleanupMp3Decoder();
+    delete pending_lyrics_.exchange(nullptr);
     
     ESP_LOGI(TAG, "Music player destroyed successfully");
 }
 
+// 缓存和本地曲库中的文件以挂载点开头，网络地址以 http 开头
+static bool IsLocalFile(const std::string& url) {
+    return !url.empty() && url[0] == '/';
+}
+
+// 把接口返回的相对路径补全为完整URL
+static std::string ResolveMusicUrl(const std::string& base_url, const std::string& path) {
+    // 检查是否已经是完整URL
+    if (path.find("http://") == 0 || path.find("https://") == 0) {
+        return path;
+    }
+    // 相对路径，需要拼接base_url
+    size_t query_pos = path.find("?");
+    if (query_pos != std::string::npos) {
+        return buildUrlWithParams(base_url, path.substr(0, query_pos), path.substr(query_pos + 1));
+    }
+    return base_url + path;
+}
+
+// 播放指定歌曲：插入到当前曲目之后并立即播放，队列中后续的歌曲保持不变
 bool Esp32Music::Download(const std::string& song_name, const std::string& artist_name) {
     ESP_LOGI(TAG, "小智开源音乐固件qq交流群:826072986");
     ESP_LOGI(TAG, "Starting to get music details for: %s", song_name.c_str());
-    
+
     // 清空之前的下载数据
     last_downloaded_data_.clear();
-    
-    // 保存歌名用于后续显示
-    current_song_name_ = song_name;
-    
+
+    MusicTrack track{song_name, artist_name};
+    int index;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        index = std::min(queue_index_ + 1, (int)queue_.size());
+        queue_.insert(queue_.begin() + index, track);
+        queue_index_ = index;
+        queue_generation_++;
+    }
+
+    if (!PlayTrack(track, &last_downloaded_data_)) {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (index < (int)queue_.size()) {
+            queue_.erase(queue_.begin() + index);
+        }
+        queue_index_ = index - 1;
+        return false;
+    }
+    return true;
+}
+
+// 解析歌曲的音频和歌词地址：4G网络直接拼接流地址，WiFi网络请求JSON接口
+bool Esp32Music::ResolveTrack(const MusicTrack& track, ResolvedTrack& resolved, std::string* response,
+                              MusicCancelToken* cancel) {
+    const std::string& song_name = track.song_name;
+    const std::string& artist_name = track.artist_name;
+    resolved = ResolvedTrack();
+
+    // 先查本地曲库，再查本地缓存，命中时不访问网络
+    MusicLibrary::Entry local;
+    if (library_.Lookup(song_name, artist_name, &local)) {
+        ESP_LOGI(TAG, "Local library hit for: %s -> %s", song_name.c_str(), local.path.c_str());
+        resolved.audio_url = local.path;
+        resolved.lyric_url = local.lyric_path;
+        resolved.audio_offset = local.audio_offset;
+        if (response != nullptr) {
+            cJSON* metadata = cJSON_CreateObject();
+            cJSON_AddStringToObject(metadata, "title", local.title.c_str());
+            cJSON_AddStringToObject(metadata, "artist", local.artist.c_str());
+            cJSON_AddNumberToObject(metadata, "duration_ms", local.duration_ms);
+            cJSON_AddStringToObject(metadata, "source", "local");
+            char* metadata_str = cJSON_PrintUnformatted(metadata);
+            *response = metadata_str;
+            cJSON_free(metadata_str);
+            cJSON_Delete(metadata);
+        }
+        return true;
+    }
+
+    if (cache_.enabled()) {
+        resolved.cache_key = MusicCache::MakeKey(song_name, artist_name);
+        MusicCache::Entry entry;
+        if (cache_.Lookup(resolved.cache_key, &entry)) {
+            ESP_LOGI(TAG, "Cache hit for: %s", song_name.c_str());
+            resolved.audio_url = cache_.GetAudioPath(resolved.cache_key);
+            if (entry.has_lyrics) {
+                resolved.lyric_url = cache_.GetLyricPath(resolved.cache_key);
+            }
+            resolved.cached = true;
+            if (response != nullptr) {
+                cache_.ReadMetadata(resolved.cache_key, response);
+            }
+            return true;
+        }
+    }
+
     // 检查是否是4G网络（ML307）
     auto& board = Board::GetInstance();
     std::string board_type = board.GetBoardType();
     bool is_4g_network = (board_type.find("ml307") != std::string::npos);
-    
+
     std::string base_url = "http://120.53.220.156:2233";
-    
-    // 4G网络使用简化流程：直接流式下载MP3
+
+    // 4G网络使用简化流程：直接流式下载MP3（或服务器转码后的Opus）
     if (is_4g_network) {
         ESP_LOGI(TAG, "4G network detected (ML307), using direct streaming mode");
-        
+
         // 构建直接下载URL（添加url=true参数）
         std::string query_params = "song=" + url_encode(song_name);
         if (!artist_name.empty()) {
             query_params += "&artist=" + url_encode(artist_name);
         }
         query_params += "&url=true";
-        
-        current_music_url_ = base_url + "/stream_pcm?" + query_params;
-        
-        ESP_LOGI(TAG, "Direct stream URL: %s", current_music_url_.c_str());
-        ESP_LOGI(TAG, "小智开源音乐固件qq交流群:826072986");
-        ESP_LOGI(TAG, "Starting direct streaming playback for: %s", song_name.c_str());
-        
-        song_name_displayed_ = false;  // 重置歌名显示标志
-        StartStreaming(current_music_url_);
-        
+#if CONFIG_MUSIC_4G_OPUS_STREAM
+        // 请求服务器转码为低码率 Ogg/Opus，节省流量并避免在与AFE共用的核上运行MP3解码
+        query_params += "&format=opus&br=" + std::to_string(CONFIG_MUSIC_4G_OPUS_BITRATE_KBPS);
+#endif
+
+        resolved.audio_url = base_url + "/stream_pcm?" + query_params;
+        ESP_LOGI(TAG, "Direct stream URL: %s", resolved.audio_url.c_str());
+
         // 4G模式下不支持歌词（因为没有单独的歌词URL）
         ESP_LOGI(TAG, "4G direct mode: lyrics not available");
-        
+
+        // 没有接口返回的元数据，缓存时只记录歌名和歌手
+        cJSON* metadata = cJSON_CreateObject();
+        cJSON_AddStringToObject(metadata, "title", song_name.c_str());
+        cJSON_AddStringToObject(metadata, "artist", artist_name.c_str());
+        char* metadata_str = cJSON_PrintUnformatted(metadata);
+        resolved.metadata = metadata_str;
+        cJSON_free(metadata_str);
+        cJSON_Delete(metadata);
         return true;
     }
-    
+
     // WiFi网络使用原有流程：先获取JSON信息，再下载
     ESP_LOGI(TAG, "WiFi network detected, using JSON metadata mode");
-    
-    // 第一步：请求stream_pcm接口获取音频信息
+
+    // 请求stream_pcm接口获取音频信息
     std::string full_url = base_url + "/stream_pcm?song=" + url_encode(song_name) + "&artist=" + url_encode(artist_name);
-    
+
     ESP_LOGI(TAG, "Request URL: %s", full_url.c_str());
-    
-    // 使用Board提供的HTTP客户端
-    auto network = board.GetNetwork();
-    auto http = network->CreateHttp(0);
-    
+
+    // 元数据和歌词请求复用连接池中的keep-alive连接
+    auto http = http_pool_.CreateHttp(cancel);
+
     // 设置基本请求头
     http->SetHeader("User-Agent", "ESP32-Music-Player/1.0");
     http->SetHeader("Accept", "application/json");
-    
+
     // 添加ESP32认证头
     add_auth_headers(http.get());
-    
+
     // 打开GET连接
     if (!http->Open("GET", full_url)) {
         ESP_LOGE(TAG, "Failed to connect to music API");
         return false;
     }
-    
+
     // 检查响应状态码
     int status_code = http->GetStatusCode();
     if (status_code != 200) {
@@ -359,279 +373,416 @@ bool Esp32Music::Download(const std::string& song_name, const std::string& artis
         http->Close();
         return false;
     }
-    
+
     // 读取响应数据
-    last_downloaded_data_ = http->ReadAll();
+    std::string data = http->ReadAll();
     http->Close();
-    
-    ESP_LOGI(TAG, "HTTP GET Status = %d, content_length = %d", status_code, last_downloaded_data_.length());
-    ESP_LOGD(TAG, "Complete music details response: %s", last_downloaded_data_.c_str());
-    
+    if (response != nullptr) {
+        *response = data;
+    }
+    resolved.metadata = data;
+
+    ESP_LOGI(TAG, "HTTP GET Status = %d, content_length = %u", status_code, (unsigned int)data.length());
+    ESP_LOGD(TAG, "Complete music details response: %s", data.c_str());
+
     // 简单的认证响应检查（可选）
-    if (last_downloaded_data_.find("ESP32动态密钥验证失败") != std::string::npos) {
+    if (data.find("ESP32动态密钥验证失败") != std::string::npos) {
         ESP_LOGE(TAG, "Authentication failed for song: %s", song_name.c_str());
         return false;
     }
-    
-    if (!last_downloaded_data_.empty()) {
-        // 解析响应JSON以提取音频URL
-        cJSON* response_json = cJSON_Parse(last_downloaded_data_.c_str());
-        if (response_json) {
-            // 提取关键信息
-            cJSON* artist = cJSON_GetObjectItem(response_json, "artist");
-            cJSON* title = cJSON_GetObjectItem(response_json, "title");
-            cJSON* audio_url = cJSON_GetObjectItem(response_json, "audio_url");
-            cJSON* lyric_url = cJSON_GetObjectItem(response_json, "lyric_url");
-            
-            if (cJSON_IsString(artist)) {
-                ESP_LOGI(TAG, "Artist: %s", artist->valuestring);
-            }
-            if (cJSON_IsString(title)) {
-                ESP_LOGI(TAG, "Title: %s", title->valuestring);
-            }
-            
-            // 检查audio_url是否有效
-            if (cJSON_IsString(audio_url) && audio_url->valuestring && strlen(audio_url->valuestring) > 0) {
-                ESP_LOGI(TAG, "Audio URL path: %s", audio_url->valuestring);
-                
-                // 第二步：处理音频URL
-                std::string audio_path = audio_url->valuestring;
-                
-                // 检查是否已经是完整URL
-                if (audio_path.find("http://") == 0 || audio_path.find("https://") == 0) {
-                    // 已经是完整URL，直接使用
-                    current_music_url_ = audio_path;
-                } else {
-                    // 相对路径，需要拼接base_url
-                    if (audio_path.find("?") != std::string::npos) {
-                        size_t query_pos = audio_path.find("?");
-                        std::string path = audio_path.substr(0, query_pos);
-                        std::string query = audio_path.substr(query_pos + 1);
-                        
-                        current_music_url_ = buildUrlWithParams(base_url, path, query);
-                    } else {
-                        current_music_url_ = base_url + audio_path;
-                    }
-                }
-                
-                ESP_LOGI(TAG, "小智开源音乐固件qq交流群:826072986");
-                ESP_LOGI(TAG, "Starting streaming playback for: %s", song_name.c_str());
-                song_name_displayed_ = false;  // 重置歌名显示标志
-                StartStreaming(current_music_url_);
-                
-                // 处理歌词URL - 只有在歌词显示模式下才启动歌词
-                if (cJSON_IsString(lyric_url) && lyric_url->valuestring && strlen(lyric_url->valuestring) > 0) {
-                    // 处理歌词URL
-                    std::string lyric_path = lyric_url->valuestring;
-                    
-                    // 检查是否已经是完整URL
-                    if (lyric_path.find("http://") == 0 || lyric_path.find("https://") == 0) {
-                        // 已经是完整URL，直接使用
-                        current_lyric_url_ = lyric_path;
-                    } else {
-                        // 相对路径，需要拼接base_url
-                        if (lyric_path.find("?") != std::string::npos) {
-                            size_t query_pos = lyric_path.find("?");
-                            std::string path = lyric_path.substr(0, query_pos);
-                            std::string query = lyric_path.substr(query_pos + 1);
-                            
-                            current_lyric_url_ = buildUrlWithParams(base_url, path, query);
-                        } else {
-                            current_lyric_url_ = base_url + lyric_path;
-                        }
-                    }
-                    
-                    // 根据显示模式决定是否启动歌词
-                    if (display_mode_ == DISPLAY_MODE_LYRICS) {
-                        ESP_LOGI(TAG, "Loading lyrics for: %s (lyrics display mode)", song_name.c_str());
-                        
-                        // 停止旧的歌词线程
-                        if (is_lyric_running_) {
-                            is_lyric_running_ = false;
-                            if (lyric_thread_.joinable()) {
-                                lyric_thread_.join();
-                            }
-                        }
-                        
-                        // 确保线程对象被完全重置
-                        if (lyric_thread_.joinable()) {
-                            lyric_thread_.join();
-                        }
-                        // 重置线程对象
-                        lyric_thread_ = std::thread();
-                        
-                        // 启动新的歌词线程
-                        is_lyric_running_ = true;
-                        current_lyric_index_ = -1;
-                        lyrics_.clear();
-                        
-                        lyric_thread_ = std::thread(&Esp32Music::LyricDisplayThread, this);
-                    } else {
-                        ESP_LOGI(TAG, "Lyric URL found but spectrum display mode is active, skipping lyrics");
-                    }
-                } else {
-                    ESP_LOGW(TAG, "No lyric URL found for this song");
-                }
-                
-                cJSON_Delete(response_json);
-                return true;
-            } else {
-                // audio_url为空或无效
-                ESP_LOGE(TAG, "Audio URL not found or empty for song: %s", song_name.c_str());
-                ESP_LOGE(TAG, "Failed to find music: 没有找到歌曲 '%s'", song_name.c_str());
-                cJSON_Delete(response_json);
-                return false;
-            }
-        } else {
-            ESP_LOGE(TAG, "Failed to parse JSON response");
-        }
-    } else {
+
+    if (data.empty()) {
         ESP_LOGE(TAG, "Empty response from music API");
+        return false;
     }
-    
-    return false;
-}
 
+    // 解析响应JSON以提取音频URL
+    cJSON* response_json = cJSON_Parse(data.c_str());
+    if (!response_json) {
+        ESP_LOGE(TAG, "Failed to parse JSON response");
+        return false;
+    }
 
+    // 提取关键信息
+    cJSON* artist = cJSON_GetObjectItem(response_json, "artist");
+    cJSON* title = cJSON_GetObjectItem(response_json, "title");
+    cJSON* audio_url = cJSON_GetObjectItem(response_json, "audio_url");
+    cJSON* lyric_url = cJSON_GetObjectItem(response_json, "lyric_url");
 
-std::string Esp32Music::GetDownloadResult() {
-    return last_downloaded_data_;
+    if (cJSON_IsString(artist)) {
+        ESP_LOGI(TAG, "Artist: %s", artist->valuestring);
+    }
+    if (cJSON_IsString(title)) {
+        ESP_LOGI(TAG, "Title: %s", title->valuestring);
+    }
+
+    // 检查audio_url是否有效
+    if (!cJSON_IsString(audio_url) || !audio_url->valuestring || strlen(audio_url->valuestring) == 0) {
+        ESP_LOGE(TAG, "Audio URL not found or empty for song: %s", song_name.c_str());
+        ESP_LOGE(TAG, "Failed to find music: 没有找到歌曲 '%s'", song_name.c_str());
+        cJSON_Delete(response_json);
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Audio URL path: %s", audio_url->valuestring);
+    resolved.audio_url = ResolveMusicUrl(base_url, audio_url->valuestring);
+
+    if (cJSON_IsString(lyric_url) && lyric_url->valuestring && strlen(lyric_url->valuestring) > 0) {
+        resolved.lyric_url = ResolveMusicUrl(base_url, lyric_url->valuestring);
+    } else {
+        ESP_LOGW(TAG, "No lyric URL found for this song");
+    }
+
+    cJSON_Delete(response_json);
+    return true;
 }
 
-// 开始流式播放
-bool Esp32Music::StartStreaming(const std::string& music_url) {
-    if (music_url.empty()) {
-        ESP_LOGE(TAG, "Music URL is empty");
+// 解析并立即播放一首歌（会打断当前播放）
+// 只在调用线程中解析元数据，启动音频流和加载歌词交给工作线程，解析成功即返回
+bool Esp32Music::PlayTrack(const MusicTrack& track, std::string* response) {
+    startup_timer_.Begin();
+    ResolvedTrack resolved;
+    if (!ResolveTrack(track, resolved, response)) {
         return false;
     }
-    
-    ESP_LOGD(TAG, "Starting streaming for URL: %s", music_url.c_str());
-    
-    // 停止之前的播放和下载
-    is_downloading_ = false;
-    is_playing_ = false;
-    
-    // 等待之前的线程完全结束
-    if (download_thread_.joinable()) {
-        {
-            std::lock_guard<std::mutex> lock(buffer_mutex_);
-            buffer_cv_.notify_all();  // 通知线程退出
-        }
-        download_thread_.join();
+    startup_timer_.Mark(kStartupStageMetadata);
+    return PostStartTrack(track, resolved);
+}
+
+// 播放网络电台，地址不经过音乐接口解析，也不加入播放队列
+bool Esp32Music::PlayRadio(const std::string& url, const std::string& name) {
+    if (url.find("http") != 0) {
+        ESP_LOGE(TAG, "Invalid radio URL: %s", url.c_str());
+        return false;
     }
-    if (play_thread_.joinable()) {
-        {
-            std::lock_guard<std::mutex> lock(buffer_mutex_);
-            buffer_cv_.notify_all();  // 通知线程退出
+    ESP_LOGI(TAG, "Playing radio: %s (%s)", name.c_str(), url.c_str());
+    startup_timer_.Begin();
+    MusicTrack track{name.empty() ? url : name, ""};
+    ResolvedTrack resolved;
+    resolved.audio_url = url;
+    resolved.live = true;
+    startup_timer_.Mark(kStartupStageMetadata);
+    return PostStartTrack(track, resolved);
+}
+
+// 在工作线程中启动已解析好的曲目
+bool Esp32Music::PostStartTrack(const MusicTrack& track, const ResolvedTrack& resolved) {
+    uint32_t generation = ++play_generation_;
+    start_pending_ = true;
+    // 工作线程可能正在下载上一首的歌词，立即中断，启动任务不用排在它后面
+    CancelLyrics();
+    bool posted = worker_.Post("start_track", [this, track, resolved, generation]() {
+        std::lock_guard<std::recursive_mutex> lock(stream_mutex_);
+        // 排队期间又有新的播放请求或者停止播放
+        if (generation != play_generation_) {
+            return;
         }
-        play_thread_.join();
+
+        // 先停止之前的播放线程，它切换到预取的下一首时也会修改当前曲目
+        CancelStreaming();
+        SetCurrentTrack(track, resolved);
+
+        ESP_LOGI(TAG, "Starting streaming playback for: %s", track.song_name.c_str());
+        if (!StartStreaming(resolved.audio_url)) {
+            ESP_LOGE(TAG, "Failed to start streaming: %s", track.song_name.c_str());
+        } else {
+            StartLyrics();
+        }
+        if (generation == play_generation_) {
+            start_pending_ = false;
+        }
+    });
+    if (!posted) {
+        start_pending_ = false;
+        return false;
     }
-    
-    // 清空缓冲区
-    ClearAudioBuffer();
-    
-    // 配置线程栈大小以避免栈溢出
-    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
-    cfg.stack_size = 8192;  // 8KB栈大小
-    cfg.prio = 5;           // 中等优先级
-    cfg.thread_name = "audio_stream";
-    esp_pthread_set_cfg(&cfg);
-    
-    // 开始下载线程
-    is_downloading_ = true;
-    download_thread_ = std::thread(&Esp32Music::DownloadAudioStream, this, music_url);
-    
-    // 开始播放线程（会等待缓冲区有足够数据）
-    is_playing_ = true;
-    play_thread_ = std::thread(&Esp32Music::PlayAudioStream, this);
-    
-    ESP_LOGI(TAG, "Streaming threads started successfully");
-    
     return true;
 }
 
-// 停止流式播放
-bool Esp32Music::StopStreaming() {
-    ESP_LOGI(TAG, "Stopping music streaming - current state: downloading=%d, playing=%d", 
-            is_downloading_.load(), is_playing_.load());
+// 发布当前曲目：工作线程在播放线程停止后、播放线程在无缝切歌时写入，其他线程在 track_mutex_ 下读取
+void Esp32Music::SetCurrentTrack(const MusicTrack& track, const ResolvedTrack& resolved) {
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        current_song_name_ = track.song_name;
+        current_music_url_ = resolved.audio_url;
+        current_lyric_url_ = resolved.lyric_url;
+        current_track_ = track;
+        current_resolved_ = resolved;
+        track_start_offset_ = resolved.audio_offset;
+    }
+    song_name_displayed_ = false;  // 重置歌名显示标志
+}
 
-    // 重置采样率到原始值
-    ResetSampleRate();
-    
-    // 检查是否有流式播放正在进行
-    if (!is_playing_ && !is_downloading_) {
-        ESP_LOGW(TAG, "No streaming in progress");
-        return true;
+// 为当前曲目加载歌词（只有在歌词显示模式下才加载），下载和解析在工作线程中与音频下载并行
+void Esp32Music::StartLyrics() {
+    // 使上一首的歌词和尚未完成的歌词任务失效
+    uint32_t generation = ++lyric_generation_;
+
+    std::string lyric_url;
+    std::string song_name;
+    auto cancel = std::make_shared<MusicCancelToken>();
+    std::shared_ptr<MusicCancelToken> previous;
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        lyric_url = current_lyric_url_;
+        song_name = current_song_name_;
+        previous = std::move(lyric_cancel_);
+        lyric_cancel_ = cancel;
     }
-    
-    // 停止下载和播放标志
+    if (previous) {
+        previous->Cancel();
+    }
+    if (lyric_url.empty()) {
+        return;
+    }
+    if (display_mode_ != DISPLAY_MODE_LYRICS) {
+        ESP_LOGI(TAG, "Lyric URL found but spectrum display mode is active, skipping lyrics");
+        return;
+    }
+
+    ESP_LOGI(TAG, "Loading lyrics for: %s (lyrics display mode)", song_name.c_str());
+    worker_.Post("load_lyrics", [this, lyric_url, generation, cancel]() {
+        LoadLyrics(lyric_url, generation, cancel);
+    });
+}
+
+// 中断正在下载的歌词，下一次 StartLyrics() 会新建令牌
+void Esp32Music::CancelLyrics() {
+    std::shared_ptr<MusicCancelToken> cancel;
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        cancel = std::move(lyric_cancel_);
+    }
+    if (cancel) {
+        cancel->Cancel();
+    }
+}
+
+// 唤醒所有在缓冲区、播放队列和混音队列上等待的线程，并丢弃尚未播放的PCM
+void Esp32Music::WakeStreamingThreads() {
+    audio_buffer_.Stop();
+    prefetch_buffer_.Stop();
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        prefetch_ready_ = false;
+    }
+    queue_cv_.notify_all();
+    Application::GetInstance().GetAudioService().FlushMusic();
+}
+
+// 取消当前播放并等待下载和播放线程退出，调用方持有 stream_mutex_
+// 取消令牌中断阻塞的网络读取和重连等待，WakeStreamingThreads() 唤醒缓冲区和队列上的等待者，
+// 两个线程都会在下一次检查时退出，因此直接 join()，不设超时也不 detach()
+void Esp32Music::CancelStreaming() {
     is_downloading_ = false;
     is_playing_ = false;
-    
-    // 清空歌名显示
-    auto& board = Board::GetInstance();
-    auto display = board.GetDisplay();
-    if (display) {
-        display->SetMusicInfo("");  // 清空歌名显示
-        ESP_LOGI(TAG, "Cleared song name display");
+    if (stream_cancel_) {
+        stream_cancel_->Cancel();
     }
-    
-    // 通知所有等待的线程
-    {
-        std::lock_guard<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.notify_all();
+    WakeStreamingThreads();
+
+    if (!download_thread_.joinable() && !play_thread_.joinable()) {
+        return;
     }
-    
-    // 等待线程结束（避免重复代码，让StopStreaming也能等待线程完全停止）
+    int64_t start_us = esp_timer_get_time();
     if (download_thread_.joinable()) {
         download_thread_.join();
-        ESP_LOGI(TAG, "Download thread joined in StopStreaming");
     }
-    
-    // 等待播放线程结束，使用更安全的方式
     if (play_thread_.joinable()) {
-        // 先设置停止标志
-        is_playing_ = false;
-        
-        // 多次通知条件变量，确保线程能够退出
-        for (int i = 0; i < 3; i++) {
-            std::lock_guard<std::mutex> lock(buffer_mutex_);
-            buffer_cv_.notify_all();
-            vTaskDelay(pdMS_TO_TICKS(10));
+        play_thread_.join();
+    }
+    ESP_LOGI(TAG, "Streaming threads stopped in %d ms", (int)((esp_timer_get_time() - start_us) / 1000));
+}
+
+// 添加到队列末尾，当前没有播放时立即开始播放
+bool Esp32Music::Enqueue(const std::string& song_name, const std::string& artist_name) {
+    MusicTrack track{song_name, artist_name};
+    int index;
+    bool idle;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.push_back(track);
+        index = queue_.size() - 1;
+        // 已提交但还没开始的播放也算作正在播放，否则连续入队会互相打断
+        idle = !is_playing_ && !is_downloading_ && !start_pending_;
+        if (idle) {
+            queue_index_ = index;
         }
-        
-        // 使用超时机制等待线程结束，避免死锁
-        bool thread_finished = false;
-        int wait_count = 0;
-        const int max_wait = 100; // 增加1秒超时
-        
-        while (!thread_finished && wait_count < max_wait) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-            wait_count++;
-            
-            // 每隔50次（500ms）打印一次等待信息
-            if (wait_count % 50 == 0) {
-                ESP_LOGI(TAG, "Waiting for play thread to finish... (%d ms)", wait_count * 10);
-            }
-            
-            // 检查线程是否仍然可join
-            if (!play_thread_.joinable()) {
-                thread_finished = true;
-                break;
-            }
+    }
+    // 唤醒正在等待下一首的下载线程
+    queue_cv_.notify_all();
+    ESP_LOGI(TAG, "Enqueued: %s (position %d)", song_name.c_str(), index);
+
+    if (idle) {
+        return PlayTrack(track, nullptr);
+    }
+    return true;
+}
+
+bool Esp32Music::Next() {
+    MusicTrack track;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (queue_index_ + 1 >= (int)queue_.size()) {
+            return false;
         }
-        
-        if (play_thread_.joinable()) {
-            if (wait_count >= max_wait) {
-                ESP_LOGW(TAG, "Play thread join timeout after %d ms, detaching thread", wait_count * 10);
-                play_thread_.detach();
-            } else {
-                play_thread_.join();
-                ESP_LOGI(TAG, "Play thread joined successfully after %d ms", wait_count * 10);
-            }
+        queue_index_++;
+        queue_generation_++;
+        track = queue_[queue_index_];
+    }
+    return PlayTrack(track, nullptr);
+}
+
+bool Esp32Music::Previous() {
+    MusicTrack track;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        if (queue_index_ <= 0 || queue_index_ > (int)queue_.size()) {
+            return false;
         }
+        queue_index_--;
+        queue_generation_++;
+        track = queue_[queue_index_];
+    }
+    return PlayTrack(track, nullptr);
+}
+
+void Esp32Music::Clear() {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    queue_.clear();
+    queue_index_ = -1;
+    queue_generation_++;
+    ESP_LOGI(TAG, "Play queue cleared");
+}
+
+std::vector<MusicTrack> Esp32Music::GetQueue() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return queue_;
+}
+
+int Esp32Music::GetQueueIndex() const {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    return queue_index_;
+}
+
+std::string Esp32Music::GetDownloadResult() {
+    return last_downloaded_data_;
+}
+
+// 开始流式播放
+bool Esp32Music::StartStreaming(const std::string& music_url) {
+    // 新曲目，seek索引在解码第一帧时重新建立
+    {
+        std::lock_guard<std::mutex> lock(seek_mutex_);
+        seek_index_.Clear();
+    }
+    std::lock_guard<std::recursive_mutex> lock(stream_mutex_);
+    // 先停止播放线程，之后只有这里修改 track_start_offset_
+    CancelStreaming();
+    size_t start_offset;
+    {
+        std::lock_guard<std::mutex> track_lock(track_mutex_);
+        start_offset = current_resolved_.audio_url == music_url ? current_resolved_.audio_offset : 0;
+        track_start_offset_ = start_offset;
+    }
+    return StartStreamingAt(music_url, start_offset, 0);
+}
+
+// 从源文件的 byte_offset 处开始流式播放，start_ms 为该位置对应的播放时间
+bool Esp32Music::StartStreamingAt(const std::string& music_url, size_t byte_offset, int64_t start_ms) {
+    std::lock_guard<std::recursive_mutex> lock(stream_mutex_);
+    if (music_url.empty()) {
+        ESP_LOGE(TAG, "Music URL is empty");
+        return false;
+    }
+    
+    ESP_LOGD(TAG, "Starting streaming for URL: %s (offset %u)", music_url.c_str(), (unsigned int)byte_offset);
+    
+    // 停止之前的播放和下载，等待之前的线程结束，并丢弃上一首尚未播放的PCM
+    CancelStreaming();
+    {
+        std::lock_guard<std::mutex> track_lock(track_mutex_);
+        live_stream_ = current_resolved_.live && current_resolved_.audio_url == music_url;
+    }
+
+    // 清空缓冲区
+    ClearAudioBuffer(byte_offset);
+    if (!audio_buffer_.valid() || !prefetch_buffer_.valid()) {
+        ESP_LOGE(TAG, "Audio ring buffer not allocated");
+        return false;
+    }
+    
+    // 配置线程栈大小以避免栈溢出
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size = 8192;  // 8KB栈大小
+    cfg.prio = 5;           // 中等优先级
+    cfg.thread_name = "audio_stream";
+    esp_pthread_set_cfg(&cfg);
+    
+    // 重新统计缓冲指标，吞吐量估计沿用之前的测量结果
+    jitter_.Reset();
+    stats_.Reset();
+
+    // 开始播放即取消用户暂停；在对话中点播时等对话结束再出声
+    ArbitrateDeviceState(Application::GetInstance().GetDeviceState());
+
+    // 开始下载线程
+    auto cancel = std::make_shared<MusicCancelToken>();
+    {
+        std::lock_guard<std::mutex> track_lock(track_mutex_);
+        stream_cancel_ = cancel;
+    }
+    is_downloading_ = true;
+    download_thread_ = std::thread(&Esp32Music::DownloadAudioStream, this, music_url, byte_offset, cancel);
+    
+    // 开始播放线程（会等待缓冲区有足够数据）
+    is_playing_ = true;
+    play_thread_ = std::thread(&Esp32Music::PlayAudioStream, this, start_ms);
+    
+    ESP_LOGI(TAG, "Streaming threads started successfully");
+    
+    return true;
+}
+
+// 停止流式播放
+bool Esp32Music::StopStreaming() {
+    ESP_LOGI(TAG, "Stopping music streaming - current state: downloading=%d, playing=%d", 
+            is_downloading_.load(), is_playing_.load());
+
+    // 取消工作线程中尚未开始的播放和正在下载的歌词
+    CancelLyrics();
+    std::lock_guard<std::recursive_mutex> lock(stream_mutex_);
+    play_generation_++;
+    start_pending_ = false;
+
+    // 检查是否有流式播放正在进行
+    if (!is_playing_ && !is_downloading_) {
+        ESP_LOGW(TAG, "No streaming in progress");
+        return true;
+    }
+    
+    // 停止下载和播放标志
+    is_downloading_ = false;
+    is_playing_ = false;
+    {
+        std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+        is_paused_ = false;
+        end_chat_for_music_ = false;
+        UpdatePauseState();
+    }
+    
+    // 清空歌名显示
+    auto& board = Board::GetInstance();
+    auto display = board.GetDisplay();
+    if (display) {
+        display->SetMusicInfo("");  // 清空歌名显示
+        display->SetLyric("");
+        ESP_LOGI(TAG, "Cleared song name display");
     }
     
+    // 唤醒所有等待中的线程，丢弃尚未播放的PCM，并等待线程结束
+    CancelStreaming();
+    
     // 在线程完全结束后，只在频谱模式下停止FFT显示
     if (display && display_mode_ == DISPLAY_MODE_SPECTRUM) {
         display->stopFft();
@@ -640,165 +791,833 @@ bool Esp32Music::StopStreaming() {
         ESP_LOGI(TAG, "Not in spectrum mode, skipping FFT stop in StopStreaming");
     }
     
-    ESP_LOGI(TAG, "Music streaming stop signal sent");
+    ESP_LOGI(TAG, "Music streaming stopped");
     return true;
 }
 
-// 流式下载音频数据
-void Esp32Music::DownloadAudioStream(const std::string& music_url) {
-    ESP_LOGD(TAG, "Starting audio stream download from: %s", music_url.c_str());
-    
-    // 验证URL有效性
-    if (music_url.empty() || music_url.find("http") != 0) {
-        ESP_LOGE(TAG, "Invalid URL format: %s", music_url.c_str());
+// 暂停：混音器中已解码的PCM保留不动，播放线程停在循环开头；下载线程照常缓冲到高水位后空闲
+bool Esp32Music::Pause() {
+    std::lock_guard<std::recursive_mutex> lock(stream_mutex_);
+    if (!is_playing_ || is_paused_) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+        is_paused_ = true;
+        UpdatePauseState();
+    }
+    ESP_LOGI(TAG, "Music paused at %lld ms", GetPosition());
+    return true;
+}
+
+bool Esp32Music::Resume() {
+    std::lock_guard<std::recursive_mutex> lock(stream_mutex_);
+    if (!is_paused_) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+        is_paused_ = false;
+        UpdatePauseState();
+    }
+    queue_cv_.notify_all();
+    ESP_LOGI(TAG, "Music resumed at %lld ms", GetPosition());
+    return true;
+}
+
+// 混音器中的音乐在用户暂停或语音交互期间都保持暂停，调用方持有 queue_mutex_
+void Esp32Music::UpdatePauseState() {
+    Application::GetInstance().GetAudioService().PauseMusic(is_paused_ || is_interrupted_);
+}
+
+// 开始新的播放时调用：取消用户暂停，按当前设备状态决定是否先等对话结束
+void Esp32Music::ArbitrateDeviceState(DeviceState state) {
+    bool end_chat = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        is_paused_ = false;
+        is_interrupted_ = state != kDeviceStateIdle;
+        // 正在播报回复时等播报完（进入聆听状态）再结束对话，已经在聆听时直接结束
+        end_chat_for_music_ = state == kDeviceStateSpeaking;
+        end_chat = state == kDeviceStateListening;
+        UpdatePauseState();
+    }
+    if (end_chat) {
+        ESP_LOGI(TAG, "Ending the conversation to start music playback");
+        Application::GetInstance().ToggleChatState();
+    }
+}
+
+// 在默认事件循环任务中调用，不能阻塞：离开待机（唤醒词、对话）时暂停音乐，保留缓冲区和解码器状态，
+// 回到待机后从暂停处继续
+void Esp32Music::OnDeviceStateChanged(DeviceState previous_state, DeviceState current_state) {
+    bool end_chat = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        is_interrupted_ = current_state != kDeviceStateIdle;
+        UpdatePauseState();
+        if (current_state == kDeviceStateListening && end_chat_for_music_) {
+            end_chat_for_music_ = false;
+            end_chat = is_playing_;
+        } else if (current_state == kDeviceStateIdle) {
+            end_chat_for_music_ = false;
+        }
+    }
+    queue_cv_.notify_all();
+
+    if (is_playing_ && (previous_state == kDeviceStateIdle || current_state == kDeviceStateIdle)) {
+        ESP_LOGI(TAG, "Music %s by device state change", is_interrupted_ ? "interrupted" : "resumed");
+    }
+    if (end_chat) {
+        ESP_LOGI(TAG, "Reply finished, ending the conversation to start music playback");
+        Application::GetInstance().ToggleChatState();
+    }
+}
+
+// 流式下载线程：当前曲目下载完成后，解析队列中的下一首并预取到另一个缓冲区
+void Esp32Music::DownloadAudioStream(const std::string& music_url, size_t start_offset,
+                                     std::shared_ptr<MusicCancelToken> cancel) {
+    MusicRingBuffer* buffer = play_buffer_.load();
+    MusicTrack track;
+    ResolvedTrack resolved;
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        track = current_track_;
+        resolved = current_resolved_;
+    }
+    // 直接调用StartStreaming播放的URL没有对应的曲目信息，不写入缓存
+    if (resolved.audio_url != music_url) {
+        track = MusicTrack();
+        resolved = ResolvedTrack();
+        resolved.audio_url = music_url;
+    }
+    size_t offset = start_offset;
+
+    while (DownloadTrack(track, resolved, buffer, offset, *cancel)) {
+        // 等待队列中有下一首，或者播放停止
+        MusicTrack next;
+        int next_index;
+        uint32_t generation;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this]() {
+                return !is_downloading_ || !is_playing_ || queue_index_ + 1 < (int)queue_.size();
+            });
+            if (!is_downloading_ || !is_playing_) {
+                break;
+            }
+            next_index = queue_index_ + 1;
+            next = queue_[next_index];
+            generation = queue_generation_;
+        }
+
+        ESP_LOGI(TAG, "Current track downloaded, prefetching next: %s", next.song_name.c_str());
+        if (!ResolveTrack(next, resolved, nullptr, cancel.get())) {
+            ESP_LOGW(TAG, "Failed to resolve next track: %s", next.song_name.c_str());
+            break;
+        }
+
+        // 另一个缓冲区可能还在播放上一首（当前曲目很短时），等播放线程切走后再复用
+        MusicRingBuffer* target = (buffer == &audio_buffer_) ? &prefetch_buffer_ : &audio_buffer_;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this, target]() {
+                return !is_downloading_ || !is_playing_ || play_buffer_.load() != target;
+            });
+            if (!is_downloading_ || !is_playing_) {
+                break;
+            }
+            target->Reset(resolved.audio_offset);
+            prefetched_.track = next;
+            prefetched_.resolved = resolved;
+            prefetched_.queue_index = next_index;
+            prefetched_.queue_generation = generation;
+            prefetched_.buffer = target;
+            prefetch_ready_ = true;
+        }
+        queue_cv_.notify_all();
+
+        buffer = target;
+        track = next;
+        offset = resolved.audio_offset;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
         is_downloading_ = false;
-        return;
     }
-    
-    auto network = Board::GetInstance().GetNetwork();
-    auto http = network->CreateHttp(0);
-    
+    queue_cv_.notify_all();
+    ESP_LOGI(TAG, "Audio stream download thread finished");
+}
+
+// 从指定偏移打开音频流，offset>0时发送Range请求续传
+// 直播流没有偏移，改为请求服务器在流中插入ICY元数据
+static std::unique_ptr<Http> OpenMusicStream(MusicHttpPool& pool, const std::string& music_url, size_t offset,
+                                             MusicCancelToken* cancel, bool live = false) {
+    auto http = pool.CreateHttp(cancel);
+
     // 设置基本请求头
     http->SetHeader("User-Agent", "ESP32-Music-Player/1.0");
     http->SetHeader("Accept", "*/*");
-    http->SetHeader("Range", "bytes=0-");  // 支持断点续传
-    
+    if (live) {
+        http->SetHeader("Icy-MetaData", "1");
+    } else {
+        http->SetHeader("Range", "bytes=" + std::to_string(offset) + "-");  // 支持断点续传
+    }
+
     // 添加ESP32认证头
     add_auth_headers(http.get());
-    
+
     if (!http->Open("GET", music_url)) {
-        ESP_LOGE(TAG, "Failed to connect to music stream URL");
-        is_downloading_ = false;
-        return;
+        return nullptr;
     }
-    
-    int status_code = http->GetStatusCode();
-    if (status_code != 200 && status_code != 206) {  // 206 for partial content
-        ESP_LOGE(TAG, "HTTP GET failed with status code: %d", status_code);
-        http->Close();
-        is_downloading_ = false;
-        return;
+    return http;
+}
+
+// 读掉并丢弃响应体中接下来的 size 字节
+static bool SkipBytes(Http* http, size_t size) {
+    char discard[512];
+    while (size > 0) {
+        int n = http->Read(discard, std::min(size, sizeof(discard)));
+        if (n <= 0) {
+            return false;
+        }
+        size -= n;
     }
-    
-    ESP_LOGI(TAG, "Started downloading audio stream, status: %d", status_code);
-    
-    // 分块读取音频数据
+    return true;
+}
+
+// 从本地缓存或曲库中的文件读取一首歌到指定缓冲区，读到文件末尾时返回true
+bool Esp32Music::ReadCachedTrack(const std::string& path, MusicRingBuffer* buffer, size_t start_offset) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        ESP_LOGE(TAG, "Failed to open cached track: %s", path.c_str());
+        buffer->Close();
+        return false;
+    }
+    // 不经过stdio的缓冲区，整扇区的读取由FAT直接从SD卡/闪存读入环形缓冲区
+    setvbuf(file, nullptr, _IONBF, 0);
+    fseek(file, 0, SEEK_END);
+    buffer->SetStreamLength(ftell(file));
+    fseek(file, start_offset, SEEK_SET);
+    ESP_LOGI(TAG, "Playing local file: %s (offset %u)", path.c_str(), (unsigned int)start_offset);
+    startup_timer_.Mark(kStartupStageStreamOpen);
+
+    // 本地读取不受网络限制，每次尽量多读，读取的结束位置对齐到扇区，减少SD卡命令次数
+    const size_t chunk_size = 16 * 1024;
+    const size_t sector_size = 512;
+    size_t position = start_offset;
+    bool completed = false;
+    while (is_downloading_ && is_playing_) {
+        if (!buffer->WaitForSpace(sector_size) || !is_downloading_) {
+            break;
+        }
+        size_t span_size = 0;
+        uint8_t* data = buffer->GetWriteSpan(&span_size);
+        size_t read_size = std::min(span_size, chunk_size);
+        if (read_size > sector_size) {
+            read_size -= (position + read_size) % sector_size;
+        }
+        size_t bytes_read = fread(data, 1, read_size, file);
+        if (bytes_read == 0) {
+            completed = !ferror(file);
+            break;
+        }
+        buffer->CommitWrite(bytes_read);
+        startup_timer_.Mark(kStartupStageFirstByte);
+        position += bytes_read;
+    }
+    fclose(file);
+
+    buffer->Close();
+    return completed && is_downloading_;
+}
+
+// 从 start_offset 开始下载一首歌到指定缓冲区，完整下载到文件末尾时返回true
+// 连接中断时以指数退避重新发起Range请求，缓冲区中已有的数据继续播放
+// 从头完整下载的歌曲同时写入本地缓存
+bool Esp32Music::DownloadTrack(const MusicTrack& track, const ResolvedTrack& resolved, MusicRingBuffer* buffer,
+                               size_t start_offset, MusicCancelToken& cancel) {
+    const std::string& music_url = resolved.audio_url;
+    if (IsLocalFile(music_url)) {
+        return ReadCachedTrack(music_url, buffer, start_offset);
+    }
+    // 直播流没有结尾，播放结束后也不切换到队列中的下一首
+    if (resolved.live) {
+        if (HlsPlaylist::IsPlaylist(music_url, "")) {
+            DownloadHlsStream(resolved, buffer, cancel);
+        } else {
+            DownloadLiveStream(track, resolved, buffer, cancel);
+        }
+        return false;
+    }
+
+    ESP_LOGD(TAG, "Starting audio stream download from: %s", music_url.c_str());
+
+    // 验证URL有效性
+    if (music_url.empty() || music_url.find("http") != 0) {
+        ESP_LOGE(TAG, "Invalid URL format: %s", music_url.c_str());
+        buffer->Close();
+        return false;
+    }
+
+    // 分块读取音频数据，直接读入环形缓冲区的可写区域（零拷贝）
     const size_t chunk_size = 4096;  // 4KB每块
-    char buffer[chunk_size];
-    size_t total_downloaded = 0;
-    int consecutive_errors = 0;
-    const int max_consecutive_errors = 10;  // 最多连续10次错误后退出
-    
+    size_t total_downloaded = start_offset;  // 已下载到的源文件偏移
+    size_t total_length = 0;         // 文件总长度，服务器未返回Content-Length时为0
+    int reconnect_attempts = 0;
+    bool connected = false;
+    bool completed = false;
+    bool caching = false;
+    bool resumed_from_idle = false;  // 刚在高水位等待过，连接可能已被服务器关闭或者接收缓存溢出
+    std::unique_ptr<Http> http;
+
+    // 可被取消令牌立即打断的退避等待
+    auto backoff = [&cancel](int attempt) {
+        int delay_ms = std::min(RECONNECT_BASE_DELAY_MS << (attempt - 1), RECONNECT_MAX_DELAY_MS);
+        ESP_LOGW(TAG, "Reconnecting in %d ms (attempt %d/%d)", delay_ms, attempt, RECONNECT_MAX_ATTEMPTS);
+        cancel.WaitFor(delay_ms);
+    };
+
     while (is_downloading_ && is_playing_) {
-        int bytes_read = http->Read(buffer, chunk_size);
-        if (bytes_read < 0) {
-            consecutive_errors++;
-            ESP_LOGW(TAG, "Failed to read audio data: error code %d (consecutive errors: %d/%d)", 
-                    bytes_read, consecutive_errors, max_consecutive_errors);
-            
-            // 如果连续错误次数超过阈值，退出
-            if (consecutive_errors >= max_consecutive_errors) {
-                ESP_LOGE(TAG, "Too many consecutive read errors, stopping download");
+        // 建立（或重新建立）连接
+        if (!http) {
+            if (reconnect_attempts > 0) {
+                if (reconnect_attempts > RECONNECT_MAX_ATTEMPTS) {
+                    ESP_LOGE(TAG, "Giving up after %d reconnect attempts, downloaded %u bytes",
+                            RECONNECT_MAX_ATTEMPTS, (unsigned int)total_downloaded);
+                    break;
+                }
+                backoff(reconnect_attempts);
+                if (!is_downloading_ || !is_playing_) {
+                    break;
+                }
+            }
+
+            http = OpenMusicStream(http_pool_, music_url, total_downloaded, &cancel);
+            if (!http) {
+                ESP_LOGE(TAG, "Failed to connect to music stream URL");
+                reconnect_attempts++;
+                continue;
+            }
+
+            int status_code = http->GetStatusCode();
+            if (status_code == 416 && total_downloaded > 0) {
+                // 请求的偏移已经到达文件末尾
+                ESP_LOGI(TAG, "Range past end of stream, download completed, total: %u bytes",
+                        (unsigned int)total_downloaded);
+                completed = true;
                 break;
             }
-            
-            // 短暂延迟后继续尝试
-            vTaskDelay(pdMS_TO_TICKS(50));
-            continue;
+            if (status_code != 200 && status_code != 206) {  // 206 for partial content
+                ESP_LOGE(TAG, "HTTP GET failed with status code: %d", status_code);
+                http->Close();
+                http.reset();
+                // 首次请求失败说明地址无效，不再重试；续传时的错误可能是临时的
+                if (!connected) {
+                    break;
+                }
+                reconnect_attempts++;
+                continue;
+            }
+
+            size_t body_length = http->GetBodyLength();
+            if (status_code == 200 && total_downloaded > 0) {
+                // 服务器不支持Range，丢弃已经下载过的部分
+                ESP_LOGW(TAG, "Server ignored Range, skipping %u bytes already downloaded",
+                        (unsigned int)total_downloaded);
+                char discard[512];
+                size_t remaining = total_downloaded;
+                while (remaining > 0 && is_downloading_) {
+                    int n = http->Read(discard, std::min(remaining, sizeof(discard)));
+                    if (n <= 0) {
+                        break;
+                    }
+                    remaining -= n;
+                }
+                if (remaining > 0) {
+                    http->Close();
+                    http.reset();
+                    reconnect_attempts++;
+                    continue;
+                }
+            }
+            if (body_length > 0 && total_length == 0) {
+                total_length = status_code == 206 ? total_downloaded + body_length : body_length;
+                buffer->SetStreamLength(total_length);
+            }
+
+            if (!connected) {
+                connected = true;
+                startup_timer_.Mark(kStartupStageStreamOpen);
+                if (start_offset == 0 && !resolved.cache_key.empty()) {
+                    caching = cache_.BeginAudio(resolved.cache_key, total_length);
+                }
+                ESP_LOGI(TAG, "Started downloading audio stream at %u bytes, status: %d, length: %u",
+                        (unsigned int)total_downloaded, status_code, (unsigned int)total_length);
+            } else {
+                ESP_LOGI(TAG, "Resumed audio stream at %u bytes, status: %d", (unsigned int)total_downloaded,
+                        status_code);
+            }
         }
-        
-        // 成功读取，重置错误计数器
+
+        if (!WaitForBufferSpace(buffer, chunk_size, &resumed_from_idle)) {
+            break;
+        }
+        size_t span_size = 0;
+        char* data = (char*)buffer->GetWriteSpan(&span_size);
+        int64_t read_start_us = esp_timer_get_time();
+        int bytes_read = http->Read(data, std::min(span_size, chunk_size));
         if (bytes_read > 0) {
-            consecutive_errors = 0;
+            jitter_.OnDownload(bytes_read, esp_timer_get_time() - read_start_us);
+            stats_.OnDownload(bytes_read);
+        }
+        if (bytes_read <= 0 && resumed_from_idle) {
+            // 等待期间连接被关闭或者溢出，立即用Range请求从断点续传，不计入重连次数
+            // （长度未知的流读到0也可能是连接被关闭，续传时服务器返回416即表示已经下载完）
+            ESP_LOGI(TAG, "Connection lost while idle, reconnecting at %u bytes", (unsigned int)total_downloaded);
+            resumed_from_idle = false;
+            http->Close();
+            http.reset();
+            continue;
+        }
+        if (bytes_read < 0) {
+            // 连接中断，重新发起Range请求
+            ESP_LOGW(TAG, "Failed to read audio data: error code %d at %u bytes", bytes_read,
+                    (unsigned int)total_downloaded);
+            http->Close();
+            http.reset();
+            reconnect_attempts++;
+            continue;
         }
         
         if (bytes_read == 0) {
-            ESP_LOGI(TAG, "Audio stream download completed, total: %d bytes", total_downloaded);
+            if (total_length > 0 && total_downloaded < total_length) {
+                // 连接提前关闭，数据不完整
+                ESP_LOGW(TAG, "Stream closed early at %u/%u bytes", (unsigned int)total_downloaded,
+                        (unsigned int)total_length);
+                http->Close();
+                http.reset();
+                reconnect_attempts++;
+                continue;
+            }
+            ESP_LOGI(TAG, "Audio stream download completed, total: %u bytes", (unsigned int)total_downloaded);
+            completed = true;
             break;
         }
+
+        // 成功读取，重置重连计数器
+        reconnect_attempts = 0;
+        resumed_from_idle = false;
         
-        // 打印数据块信息
-        // ESP_LOGI(TAG, "Downloaded chunk: %d bytes at offset %d", bytes_read, total_downloaded);
-        
-        // 安全地打印数据块的十六进制内容（前16字节）
-        if (bytes_read >= 16) {
-            // ESP_LOGI(TAG, "Data: %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X %02X ...", 
-            //         (unsigned char)buffer[0], (unsigned char)buffer[1], (unsigned char)buffer[2], (unsigned char)buffer[3],
-            //         (unsigned char)buffer[4], (unsigned char)buffer[5], (unsigned char)buffer[6], (unsigned char)buffer[7],
-            //         (unsigned char)buffer[8], (unsigned char)buffer[9], (unsigned char)buffer[10], (unsigned char)buffer[11],
-            //         (unsigned char)buffer[12], (unsigned char)buffer[13], (unsigned char)buffer[14], (unsigned char)buffer[15]);
+        // 写入缓存失败（超出预算或闪存写满）时只停止缓存，不影响播放
+        if (caching && !cache_.AppendAudio(data, bytes_read)) {
+            caching = false;
+        }
+
+        // 数据已经在环形缓冲区中，提交即可对播放线程可见
+        buffer->CommitWrite(bytes_read);
+        startup_timer_.Mark(kStartupStageFirstByte);
+        total_downloaded += bytes_read;
+
+        if (total_downloaded % (256 * 1024) == 0) {  // 每256KB打印一次进度
+            ESP_LOGI(TAG, "Downloaded %u bytes, buffer size: %u", (unsigned int)total_downloaded,
+                    (unsigned int)buffer->Size());
+        }
+    }
+
+    if (http) {
+        http->Close();
+    }
+    if (caching) {
+        if (completed && is_downloading_) {
+            cache_.CommitAudio(track.song_name, track.artist_name, resolved.metadata);
         } else {
-            ESP_LOGI(TAG, "Data chunk too small: %d bytes", bytes_read);
+            cache_.AbortAudio();
+        }
+    }
+
+    // 通知播放线程该曲目下载完成
+    buffer->Close();
+    return completed && is_downloading_;
+}
+
+// 达到高水位后暂停读取，等播放消耗到低水位再继续；连接保持打开，由连接池的流量控制让服务器放慢发送
+// 暂停播放时可能在这里等待很久，期间服务器可能断开或者连接的接收缓存溢出，resumed_from_idle 为true时
+// 调用方读取失败应立即用Range请求续传。缓冲区停止时返回false
+bool Esp32Music::WaitForBufferSpace(MusicRingBuffer* buffer, size_t chunk_size, bool* resumed_from_idle) {
+    size_t high_watermark = std::min(jitter_.GetHighWatermark(), buffer->capacity());
+    if (buffer->Size() + chunk_size > high_watermark) {
+        size_t low_watermark = std::min(jitter_.GetLowWatermark(), high_watermark - chunk_size);
+        if (!buffer->WaitForSpace(buffer->capacity() - low_watermark) || !is_downloading_) {
+            return false;
+        }
+        *resumed_from_idle = true;
+    }
+
+    // 等待缓冲区有空间
+    return buffer->WaitForSpace(chunk_size) && is_downloading_;
+}
+
+// 下载 Shoutcast/Icecast 直播流，直到停止播放或者重连失败
+// 流没有长度，读到0说明服务器关闭了连接，重新连接即可；元数据块不进入环形缓冲区，StreamTitle 显示为歌名
+void Esp32Music::DownloadLiveStream(const MusicTrack& track, const ResolvedTrack& resolved, MusicRingBuffer* buffer,
+                                    MusicCancelToken& cancel) {
+    const std::string& url = resolved.audio_url;
+    const size_t chunk_size = 4096;
+    size_t total_downloaded = 0;
+    int reconnect_attempts = 0;
+    bool connected = false;
+    std::unique_ptr<Http> http;
+    IcyMetadataReader icy;
+
+    while (is_downloading_ && is_playing_) {
+        if (!http) {
+            if (reconnect_attempts > 0) {
+                if (reconnect_attempts > RECONNECT_MAX_ATTEMPTS) {
+                    ESP_LOGE(TAG, "Giving up live stream after %d reconnect attempts", RECONNECT_MAX_ATTEMPTS);
+                    break;
+                }
+                int delay_ms = std::min(RECONNECT_BASE_DELAY_MS << (reconnect_attempts - 1), RECONNECT_MAX_DELAY_MS);
+                ESP_LOGW(TAG, "Reconnecting live stream in %d ms (attempt %d/%d)", delay_ms, reconnect_attempts,
+                        RECONNECT_MAX_ATTEMPTS);
+                if (!cancel.WaitFor(delay_ms) || !is_downloading_ || !is_playing_) {
+                    break;
+                }
+            }
+
+            http = OpenMusicStream(http_pool_, url, 0, &cancel, true);
+            if (!http) {
+                ESP_LOGE(TAG, "Failed to connect to live stream URL");
+                reconnect_attempts++;
+                continue;
+            }
+            int status_code = http->GetStatusCode();
+            if (status_code != 200) {
+                ESP_LOGE(TAG, "Live stream request failed with status code: %d", status_code);
+                http->Close();
+                http.reset();
+                if (!connected) {
+                    break;
+                }
+                reconnect_attempts++;
+                continue;
+            }
+            // 没有 .m3u8 后缀的HLS地址
+            if (!connected && HlsPlaylist::IsPlaylist(url, http->GetResponseHeader("Content-Type"))) {
+                http->Close();
+                http.reset();
+                DownloadHlsStream(resolved, buffer, cancel);
+                return;
+            }
+
+            // 每个连接的元数据间隔各自独立
+            icy = IcyMetadataReader(strtoul(http->GetResponseHeader("icy-metaint").c_str(), nullptr, 10));
+            if (!connected) {
+                connected = true;
+                startup_timer_.Mark(kStartupStageStreamOpen);
+                ESP_LOGI(TAG, "Live stream opened: %s, type: %s, bitrate: %s, metaint: %s",
+                        http->GetResponseHeader("icy-name").c_str(), http->GetResponseHeader("Content-Type").c_str(),
+                        http->GetResponseHeader("icy-br").c_str(), http->GetResponseHeader("icy-metaint").c_str());
+            } else {
+                ESP_LOGI(TAG, "Live stream reconnected after %u bytes", (unsigned int)total_downloaded);
+            }
+        }
+
+        // 直播流按播放速度发送，不用高低水位（关闭连接会丢掉这段时间的直播内容），有空间就读
+        if (!buffer->WaitForSpace(chunk_size) || !is_downloading_) {
+            break;
+        }
+
+        // 到达元数据位置时先读元数据块，音频读取不跨过元数据，数据直接读入环形缓冲区
+        if (icy.AudioBytesBeforeMetadata() == 0) {
+            bool title_changed = false;
+            if (!icy.ReadMetadata(http.get(), &title_changed)) {
+                ESP_LOGW(TAG, "Failed to read stream metadata");
+                http->Close();
+                http.reset();
+                reconnect_attempts++;
+                continue;
+            }
+            if (title_changed) {
+                ESP_LOGI(TAG, "Stream title: %s", icy.title().c_str());
+                auto display = Board::GetInstance().GetDisplay();
+                if (display) {
+                    std::string info = "《" + track.song_name + "》" + icy.title();
+                    display->SetMusicInfo(info.c_str());
+                }
+            }
+            continue;
+        }
+
+        size_t span_size = 0;
+        char* data = (char*)buffer->GetWriteSpan(&span_size);
+        size_t read_size = std::min(std::min(span_size, chunk_size), icy.AudioBytesBeforeMetadata());
+        int64_t read_start_us = esp_timer_get_time();
+        int bytes_read = http->Read(data, read_size);
+        if (bytes_read <= 0) {
+            // 服务器断开，或者暂停播放期间接收缓存溢出，按退避重连
+            ESP_LOGW(TAG, "Live stream interrupted (%d) after %u bytes", bytes_read, (unsigned int)total_downloaded);
+            http->Close();
+            http.reset();
+            reconnect_attempts++;
+            continue;
+        }
+
+        jitter_.OnDownload(bytes_read, esp_timer_get_time() - read_start_us);
+        stats_.OnDownload(bytes_read);
+        reconnect_attempts = 0;
+        icy.OnAudio(bytes_read);
+        buffer->CommitWrite(bytes_read);
+        startup_timer_.Mark(kStartupStageFirstByte);
+        total_downloaded += bytes_read;
+    }
+
+    if (http) {
+        http->Close();
+    }
+    buffer->Close();
+    ESP_LOGI(TAG, "Live stream stopped, total: %u bytes", (unsigned int)total_downloaded);
+}
+
+// 下载HLS播放列表：直播列表每隔约一个 target duration 重新加载，下载新出现的分段
+// 分段按顺序写入同一个环形缓冲区，当前分段播放时下一个分段已经在下载，落后于列表时跳到最早的可用分段
+void Esp32Music::DownloadHlsStream(const ResolvedTrack& resolved, MusicRingBuffer* buffer, MusicCancelToken& cancel) {
+    std::string playlist_url = resolved.audio_url;
+    HlsPlaylist playlist;
+    int64_t next_sequence = -1;
+    int failures = 0;
+    int variant_depth = 0;
+
+    while (is_downloading_ && is_playing_) {
+        if (failures > 0) {
+            if (failures > RECONNECT_MAX_ATTEMPTS) {
+                ESP_LOGE(TAG, "Giving up HLS stream after %d failures", RECONNECT_MAX_ATTEMPTS);
+                break;
+            }
+            int delay_ms = std::min(RECONNECT_BASE_DELAY_MS << (failures - 1), RECONNECT_MAX_DELAY_MS);
+            if (!cancel.WaitFor(delay_ms) || !is_downloading_ || !is_playing_) {
+                break;
+            }
+        }
+
+        int64_t load_start_us = esp_timer_get_time();
+        auto http = OpenMusicStream(http_pool_, playlist_url, 0, &cancel);
+        if (!http || (http->GetStatusCode() != 200 && http->GetStatusCode() != 206)) {
+            ESP_LOGE(TAG, "Failed to load playlist: %s (status %d)", playlist_url.c_str(),
+                    http ? http->GetStatusCode() : -1);
+            if (http) {
+                http->Close();
+            }
+            // 第一次就加载失败说明地址无效
+            if (next_sequence < 0 && variant_depth == 0) {
+                break;
+            }
+            failures++;
+            continue;
+        }
+        std::string text = http->ReadAll();
+        http->Close();
+        if (!playlist.Parse(text, playlist_url)) {
+            failures++;
+            continue;
+        }
+
+        if (playlist.is_master()) {
+            const auto* variant = playlist.SelectVariant(HLS_MAX_BANDWIDTH);
+            if (++variant_depth > 2) {
+                ESP_LOGE(TAG, "Too many nested HLS playlists");
+                break;
+            }
+            ESP_LOGI(TAG, "Selected HLS variant %u bps: %s", (unsigned int)variant->bandwidth, variant->url.c_str());
+            playlist_url = variant->url;
+            continue;
+        }
+
+        const auto& segments = playlist.segments();
+        if (next_sequence < 0) {
+            next_sequence = playlist.StartSequence();
+            startup_timer_.Mark(kStartupStageStreamOpen);
+            ESP_LOGI(TAG, "HLS %s playlist, %d segments, target duration %d ms, starting at #%lld",
+                    playlist.ended() ? "VOD" : "live", (int)segments.size(), playlist.target_duration_ms(),
+                    next_sequence);
+        } else if (!segments.empty() && next_sequence < segments.front().sequence) {
+            ESP_LOGW(TAG, "HLS playback fell behind, skipping %lld segments",
+                    segments.front().sequence - next_sequence);
+            next_sequence = segments.front().sequence;
+        }
+
+        bool got_new_segment = false;
+        bool segment_failed = false;
+        for (const auto& segment : segments) {
+            if (segment.sequence < next_sequence) {
+                continue;
+            }
+            bool unsupported = false;
+            if (!DownloadHlsSegment(segment.url, buffer, cancel, &unsupported)) {
+                if (unsupported) {
+                    buffer->Close();
+                    return;
+                }
+                segment_failed = true;
+                break;
+            }
+            next_sequence = segment.sequence + 1;
+            got_new_segment = true;
+            if (!is_downloading_ || !is_playing_) {
+                break;
+            }
+        }
+        if (segment_failed) {
+            failures++;
+            continue;
+        }
+        failures = 0;
+
+        if (playlist.ended() && (segments.empty() || next_sequence > segments.back().sequence)) {
+            ESP_LOGI(TAG, "HLS playlist ended");
+            break;
+        }
+
+        // 列表有更新时间隔一个 target duration 再加载，没有更新时间隔减半（RFC 8216 6.3.4）
+        int reload_ms = got_new_segment ? playlist.target_duration_ms() : playlist.target_duration_ms() / 2;
+        reload_ms -= (int)((esp_timer_get_time() - load_start_us) / 1000);
+        if (!cancel.WaitFor(std::max(reload_ms, HLS_MIN_RELOAD_MS))) {
+            break;
+        }
+    }
+
+    buffer->Close();
+    ESP_LOGI(TAG, "HLS stream stopped");
+}
+
+// 下载一个HLS分段写入环形缓冲区，跳过分段开头的ID3时间戳标签
+// 只支持打包的AAC/MP3分段，MPEG-TS分段时 unsupported 为true
+// 在高水位等待后连接断开时，用Range请求从已经读到的位置继续
+bool Esp32Music::DownloadHlsSegment(const std::string& url, MusicRingBuffer* buffer, MusicCancelToken& cancel,
+                                    bool* unsupported) {
+    size_t position = 0;  // 已经读过的分段字节数
+    bool completed = false;
+    std::unique_ptr<Http> http;
+
+    // 从 position 处打开分段，服务器不支持Range时跳过已经读过的部分
+    auto open = [&]() {
+        http = OpenMusicStream(http_pool_, url, position, &cancel);
+        if (!http) {
+            ESP_LOGE(TAG, "Failed to connect to HLS segment");
+            return false;
+        }
+        int status_code = http->GetStatusCode();
+        if (status_code == 416 && position > 0) {
+            // 关闭连接前已经读到分段末尾
+            completed = true;
+        } else if (status_code != 200 && status_code != 206) {
+            ESP_LOGE(TAG, "HLS segment request failed with status code: %d", status_code);
+        } else if (status_code == 206 || position == 0 || SkipBytes(http.get(), position)) {
+            return true;
+        }
+        http->Close();
+        http.reset();
+        return false;
+    };
+
+    auto read_fully = [&http](uint8_t* data, size_t size) {
+        while (size > 0) {
+            int n = http->Read((char*)data, size);
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            size -= n;
+        }
+        return true;
+    };
+
+    if (!open()) {
+        return false;
+    }
+
+    // 分段开头：ID3标签、MPEG-TS同步字节或者音频帧
+    uint8_t header[10];
+    if (!read_fully(header, sizeof(header))) {
+        http->Close();
+        return false;
+    }
+    position = sizeof(header);
+    if (header[0] == 0x47) {
+        ESP_LOGE(TAG, "MPEG-TS HLS segments are not supported: %s", url.c_str());
+        *unsupported = true;
+        http->Close();
+        return false;
+    }
+    if (memcmp(header, "ID3", 3) == 0) {
+        size_t skip = ((header[6] & 0x7F) << 21) | ((header[7] & 0x7F) << 14) | ((header[8] & 0x7F) << 7) |
+                      (header[9] & 0x7F);
+        if (header[5] & 0x10) {
+            skip += 10;  // footer
+        }
+        if (!SkipBytes(http.get(), skip)) {
+            http->Close();
+            return !is_downloading_ || !is_playing_;
+        }
+        position += skip;
+    } else {
+        if (!buffer->WaitForSpace(sizeof(header)) || !is_downloading_) {
+            http->Close();
+            return true;
+        }
+        buffer->Write(header, sizeof(header));
+    }
+
+    const size_t chunk_size = 4096;
+    bool resumed_from_idle = false;
+    while (is_downloading_ && is_playing_) {
+        if (!http && !open()) {
+            break;
+        }
+        if (!WaitForBufferSpace(buffer, chunk_size, &resumed_from_idle)) {
+            completed = true;  // 停止播放，不算失败
+            break;
         }
-        
-        // 尝试检测文件格式（检查文件头）
-        if (total_downloaded == 0 && bytes_read >= 4) {
-            if (memcmp(buffer, "ID3", 3) == 0) {
-                ESP_LOGI(TAG, "Detected MP3 file with ID3 tag");
-            } else if (buffer[0] == 0xFF && (buffer[1] & 0xE0) == 0xE0) {
-                ESP_LOGI(TAG, "Detected MP3 file header");
-            } else if (memcmp(buffer, "RIFF", 4) == 0) {
-                ESP_LOGI(TAG, "Detected WAV file");
-            } else if (memcmp(buffer, "fLaC", 4) == 0) {
-                ESP_LOGI(TAG, "Detected FLAC file");
-            } else if (memcmp(buffer, "OggS", 4) == 0) {
-                ESP_LOGI(TAG, "Detected OGG file");
-            } else {
-                ESP_LOGI(TAG, "Unknown audio format, first 4 bytes: %02X %02X %02X %02X", 
-                        (unsigned char)buffer[0], (unsigned char)buffer[1], 
-                        (unsigned char)buffer[2], (unsigned char)buffer[3]);
-            }
+        size_t span_size = 0;
+        char* data = (char*)buffer->GetWriteSpan(&span_size);
+        int64_t read_start_us = esp_timer_get_time();
+        int bytes_read = http->Read(data, std::min(span_size, chunk_size));
+        if (bytes_read <= 0 && resumed_from_idle) {
+            // 等待期间连接被关闭或者溢出，从断点续传（分段已经读完时服务器返回416）
+            resumed_from_idle = false;
+            http->Close();
+            http.reset();
+            continue;
         }
-        
-        // 创建音频数据块
-        uint8_t* chunk_data = (uint8_t*)heap_caps_malloc(bytes_read, MALLOC_CAP_SPIRAM);
-        if (!chunk_data) {
-            ESP_LOGE(TAG, "Failed to allocate memory for audio chunk");
+        resumed_from_idle = false;
+        if (bytes_read < 0) {
+            ESP_LOGW(TAG, "Failed to read HLS segment: error code %d", bytes_read);
             break;
         }
-        memcpy(chunk_data, buffer, bytes_read);
-        
-        // 等待缓冲区有空间
-        {
-            std::unique_lock<std::mutex> lock(buffer_mutex_);
-            buffer_cv_.wait(lock, [this] { return buffer_size_ < MAX_BUFFER_SIZE || !is_downloading_; });
-            
-            if (is_downloading_) {
-                audio_buffer_.push(AudioChunk(chunk_data, bytes_read));
-                buffer_size_ += bytes_read;
-                total_downloaded += bytes_read;
-                
-                // 通知播放线程有新数据
-                buffer_cv_.notify_one();
-                
-                if (total_downloaded % (256 * 1024) == 0) {  // 每256KB打印一次进度
-                    ESP_LOGI(TAG, "Downloaded %d bytes, buffer size: %d", total_downloaded, buffer_size_);
-                }
-            } else {
-                heap_caps_free(chunk_data);
-                break;
-            }
+        if (bytes_read == 0) {
+            completed = true;
+            break;
         }
+        jitter_.OnDownload(bytes_read, esp_timer_get_time() - read_start_us);
+        stats_.OnDownload(bytes_read);
+        buffer->CommitWrite(bytes_read);
+        startup_timer_.Mark(kStartupStageFirstByte);
+        position += bytes_read;
     }
-    
-    http->Close();
-    is_downloading_ = false;
-    
-    // 通知播放线程下载完成
-    {
-        std::lock_guard<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.notify_all();
+    if (http) {
+        http->Close();
     }
-    
-    ESP_LOGI(TAG, "Audio stream download thread finished");
+    return completed || !is_downloading_ || !is_playing_;
 }
 
 // 流式播放音频数据
-void Esp32Music::PlayAudioStream() {
-    ESP_LOGI(TAG, "Starting audio stream playback");
+void Esp32Music::PlayAudioStream(int64_t start_ms) {
+    ESP_LOGI(TAG, "Starting audio stream playback at %lld ms", start_ms);
     
     // 初始化时间跟踪变量
-    current_play_time_ms_ = 0;
+    current_play_time_ms_ = start_ms;
+    clock_offset_ms_ = start_ms - Application::GetInstance().GetAudioService().GetMusicEndClockMs();
     last_frame_time_ms_ = 0;
     total_frames_decoded_ = 0;
     
@@ -809,89 +1628,67 @@ void Esp32Music::PlayAudioStream() {
         return;
     }
     
-    if (!mp3_decoder_initialized_) {
-        ESP_LOGE(TAG, "MP3 decoder not initialized");
-        is_playing_ = false;
-        return;
-    }
     
+    // 等待缓冲区达到起播水位（下载结束时缓冲区中剩余的数据也可以播放）
+    MusicRingBuffer* buffer = play_buffer_.load();
+    WaitForStartWatermark(buffer);
     
-    // 等待缓冲区有足够数据开始播放
-    {
-        std::unique_lock<std::mutex> lock(buffer_mutex_);
-        buffer_cv_.wait(lock, [this] { 
-            return !is_playing_ || buffer_size_ >= MIN_BUFFER_SIZE || (!is_downloading_ && !audio_buffer_.empty()); 
-        });
-        
-        // 如果停止标志已设置，提前退出
-        if (!is_playing_) {
-            ESP_LOGI(TAG, "Playback stopped before starting");
-            return;
-        }
+    // 如果停止标志已设置，提前退出
+    if (!is_playing_ || buffer->stopped()) {
+        ESP_LOGI(TAG, "Playback stopped before starting");
+        return;
+    }
+    if (buffer->Size() == 0) {
+        ESP_LOGW(TAG, "No audio data downloaded, nothing to play");
+        is_playing_ = false;
+        return;
     }
+    startup_timer_.Mark(kStartupStageBuffered);
     
     ESP_LOGI(TAG, "小智开源音乐固件qq交流群:826072986");
-    ESP_LOGI(TAG, "Starting playback with buffer size: %d", buffer_size_);
+    ESP_LOGI(TAG, "Starting playback with buffer size: %u", (unsigned int)buffer->Size());
+    int average_bitrate = 0;  // 平滑后的帧码率，VBR每帧码率不同
+    std::vector<int16_t> pcm;
     
     size_t total_played = 0;
-    uint8_t* mp3_input_buffer = nullptr;
-    int bytes_left = 0;
-    uint8_t* read_ptr = nullptr;
+    const size_t min_decode_bytes = 4096;  // 保持至少4KB连续数据用于解码
     
-    // 分配MP3输入缓冲区
-    mp3_input_buffer = (uint8_t*)heap_caps_malloc(8192, MALLOC_CAP_SPIRAM);
-    if (!mp3_input_buffer) {
-        ESP_LOGE(TAG, "Failed to allocate MP3 input buffer");
-        is_playing_ = false;
-        return;
+    // 标记是否已经处理过ID3标签，以及标签中尚未跳过的字节数；从文件中间开始（seek）时没有ID3标签
+    bool id3_processed = buffer->ReadPosition() > 0;
+    size_t id3_skip_remaining = 0;
+    // 从文件开头播放时，用第一帧建立seek索引
+    size_t track_start_offset;
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        track_start_offset = track_start_offset_;
     }
-    
-    // 标记是否已经处理过ID3标签
-    bool id3_processed = false;
+    bool seek_index_pending = buffer->ReadPosition() == track_start_offset && !live_stream_;
+    // 解码器在识别出格式后创建，切换到下一首时重新识别
+    std::unique_ptr<AudioDecoder> decoder;
+    int64_t frame_time_remainder = 0;
+    int decode_error_count = 0;
     
     while (is_playing_) {
-        // 检查设备状态，只有在空闲状态才播放音乐
-        auto& app = Application::GetInstance();
-        DeviceState current_state = app.GetDeviceState();
-        
-        // 状态转换：说话中-》聆听中-》待机状态-》播放音乐
-        if (current_state == kDeviceStateListening || current_state == kDeviceStateSpeaking) {
-            if (current_state == kDeviceStateSpeaking) {
-                ESP_LOGI(TAG, "Device is in speaking state, switching to listening state for music playback");
-            }
-            if (current_state == kDeviceStateListening) {
-                ESP_LOGI(TAG, "Device is in listening state, switching to idle state for music playback");
-            }
-            // 切换状态
-            app.ToggleChatState(); // 变成待机状态
-            vTaskDelay(pdMS_TO_TICKS(300));
-            
-            // 在等待状态切换时检查停止标志
-            if (!is_playing_) {
-                ESP_LOGI(TAG, "Playback stopped during state transition");
-                break;
-            }
-            continue;
-        } else if (current_state != kDeviceStateIdle) { // 不是待机状态，就一直卡在这里，不让播放音乐
-            ESP_LOGD(TAG, "Device state is %d, pausing music playback", current_state);
-            // 如果不是空闲状态，暂停播放
-            vTaskDelay(pdMS_TO_TICKS(50));
-            
-            // 在暂停时检查停止标志，提高响应速度
-            if (!is_playing_) {
-                ESP_LOGI(TAG, "Playback stopped while waiting for idle state");
-                break;
-            }
+        // 用户暂停或语音交互期间不解码，Resume()、回到待机或停止时唤醒
+        if (is_paused_ || is_interrupted_) {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this]() { return (!is_paused_ && !is_interrupted_) || !is_playing_; });
             continue;
         }
-        
-        // 设备状态检查通过，显示当前播放的歌名
-        if (!song_name_displayed_ && !current_song_name_.empty()) {
+        auto& app = Application::GetInstance();
+
+        // 显示当前播放的歌名
+        std::string song_name;
+        if (!song_name_displayed_) {
+            std::lock_guard<std::mutex> lock(track_mutex_);
+            song_name = current_song_name_;
+        }
+        if (!song_name_displayed_ && !song_name.empty()) {
             auto& board = Board::GetInstance();
             auto display = board.GetDisplay();
             if (display) {
                 // 格式化歌名显示为《歌名》播放中...
-                std::string formatted_song_name = "《" + current_song_name_ + "》播放中...";
+                std::string formatted_song_name = "《" + song_name + "》播放中...";
                 display->SetMusicInfo(formatted_song_name.c_str());
                 ESP_LOGI(TAG, "Displaying song name: %s", formatted_song_name.c_str());
                 song_name_displayed_ = true;
@@ -908,242 +1705,213 @@ void Esp32Music::PlayAudioStream() {
             }
         }
         
-        // 如果需要更多MP3数据，从缓冲区读取
-        if (bytes_left < 4096) {  // 保持至少4KB数据用于解码
-            AudioChunk chunk;
-            
-            // 从缓冲区获取音频数据
-            {
-                std::unique_lock<std::mutex> lock(buffer_mutex_);
-                if (audio_buffer_.empty()) {
-                    if (!is_downloading_) {
-                        // 下载完成且缓冲区为空，播放结束
-                        ESP_LOGI(TAG, "Playback finished, total played: %d bytes", total_played);
-                        break;
-                    }
-                    // 等待新数据，同时检查停止标志
-                    buffer_cv_.wait(lock, [this] { 
-                        return !is_playing_ || !audio_buffer_.empty() || !is_downloading_; 
-                    });
-                    
-                    // 如果停止标志已设置，退出
-                    if (!is_playing_) {
-                        ESP_LOGI(TAG, "Playback stopped while waiting for buffer data");
-                        break;
-                    }
-                    
-                    if (audio_buffer_.empty()) {
-                        continue;
-                    }
+        // 缓冲区为空时等待新数据，同时检查停止标志
+        if (buffer->Size() == 0) {
+            if (buffer->closed()) {
+                // 当前曲目播放完毕，如果队列中的下一首已经预取则无缝切换
+                ESP_LOGI(TAG, "Track finished, total played: %u bytes", (unsigned int)total_played);
+                if (SwitchToNextTrack(buffer)) {
+                    id3_processed = false;
+                    id3_skip_remaining = 0;
+                    seek_index_pending = true;
+                    decoder.reset();
+                    frame_time_remainder = 0;
+                    continue;
                 }
-                
-                chunk = audio_buffer_.front();
-                audio_buffer_.pop();
-                buffer_size_ -= chunk.size;
-                
-                // 通知下载线程缓冲区有空间
-                buffer_cv_.notify_one();
+                break;
             }
+            // 欠载：重新缓冲到起播水位再继续，避免刚恢复就再次断续
+            jitter_.OnUnderrun();
+            ESP_LOGW(TAG, "Buffer underrun, rebuffering to %u bytes", (unsigned int)jitter_.GetStartWatermark());
+            int64_t stall_start_us = esp_timer_get_time();
+            WaitForStartWatermark(buffer);
+            jitter_.OnStallEnd(esp_timer_get_time() - stall_start_us);
             
-            // 将新数据添加到MP3输入缓冲区
-            if (chunk.data && chunk.size > 0) {
-                // 移动剩余数据到缓冲区开头
-                if (bytes_left > 0 && read_ptr != mp3_input_buffer) {
-                    memmove(mp3_input_buffer, read_ptr, bytes_left);
-                }
-                
-                // 检查缓冲区空间
-                size_t space_available = 8192 - bytes_left;
-                size_t copy_size = std::min(chunk.size, space_available);
-                
-                // 复制新数据
-                memcpy(mp3_input_buffer + bytes_left, chunk.data, copy_size);
-                bytes_left += copy_size;
-                read_ptr = mp3_input_buffer;
-                
-                // 检查并跳过ID3标签（仅在开始时处理一次）
-                if (!id3_processed && bytes_left >= 10) {
-                    size_t id3_skip = SkipId3Tag(read_ptr, bytes_left);
-                    if (id3_skip > 0) {
-                        read_ptr += id3_skip;
-                        bytes_left -= id3_skip;
-                        ESP_LOGI(TAG, "Skipped ID3 tag: %u bytes", (unsigned int)id3_skip);
-                    }
-                    id3_processed = true;
-                }
-                
-                // 释放chunk内存
-                heap_caps_free(chunk.data);
+            // 如果停止标志已设置，退出
+            if (!is_playing_ || buffer->stopped()) {
+                ESP_LOGI(TAG, "Playback stopped while waiting for buffer data");
+                break;
             }
+            continue;
         }
         
-        // 尝试找到MP3帧同步
-        int sync_offset = MP3FindSyncWord(read_ptr, bytes_left);
-        if (sync_offset < 0) {
-            ESP_LOGW(TAG, "No MP3 sync word found, skipping %d bytes", bytes_left);
-            bytes_left = 0;
+        // 检查并跳过ID3标签（仅在开始时处理一次），标签可能比缓冲区中已有的数据更长
+        if (!id3_processed) {
+            if (buffer->Size() < 10 && !buffer->closed()) {
+                buffer->WaitForData(10);
+                continue;
+            }
+            size_t header_size = 0;
+            uint8_t* header = buffer->GetReadSpan(&header_size, 10);
+            id3_skip_remaining = SkipId3Tag(header, header_size);
+            id3_processed = true;
+        }
+        if (id3_skip_remaining > 0) {
+            id3_skip_remaining -= buffer->Skip(id3_skip_remaining);
             continue;
         }
+
+        // 根据数据开头识别格式，创建对应的解码器
+        if (!decoder) {
+            if (buffer->Size() < AudioDecoder::kProbeBytes && !buffer->closed()) {
+                buffer->WaitForData(AudioDecoder::kProbeBytes);
+                continue;
+            }
+            size_t probe_size = 0;
+            uint8_t* probe = buffer->GetReadSpan(&probe_size, AudioDecoder::kProbeBytes);
+            decoder = AudioDecoder::Create(probe, probe_size, codec->output_sample_rate());
+            if (!decoder) {
+                ESP_LOGE(TAG, "Failed to create audio decoder");
+                break;
+            }
+        }
         
-        // 跳过到同步位置
-        if (sync_offset > 0) {
-            read_ptr += sync_offset;
-            bytes_left -= sync_offset;
+        // 直接在环形缓冲区上解码，跨越环形边界时由缓冲区提供连续的镜像数据
+        size_t span_size = 0;
+        uint8_t* read_ptr = buffer->GetReadSpan(&span_size, decoder->min_input_bytes());
+
+        // MP3第一帧可能带有Xing/VBRI头，用它建立时间到字节偏移的索引；其他格式不支持seek
+        if (seek_index_pending && decoder->format() == kAudioFormatMp3) {
+            int sync_offset = MP3FindSyncWord(read_ptr, (int)span_size);
+            if (sync_offset > 0) {
+                buffer->Skip(sync_offset);
+                continue;
+            }
+            seek_index_pending = false;
+            if (sync_offset == 0) {
+                std::lock_guard<std::mutex> lock(seek_mutex_);
+                if (seek_index_.Build(read_ptr, span_size, buffer->ReadPosition(), buffer->stream_length())) {
+                    ESP_LOGI(TAG, "Seek index built from %s header, duration: %lld ms",
+                            seek_index_.type_name(), seek_index_.GetDurationMs());
+                }
+            }
         }
         
-        // 解码MP3帧
-        int16_t pcm_buffer[2304];
-        int decode_result = MP3Decode(mp3_decoder_, &read_ptr, &bytes_left, pcm_buffer, 0);
+        // 直接解码到交给混音器的PCM缓冲区（送出后重新分配），提交解码器消耗的字节
+        // 解码耗时按CPU周期计数，解码期间线程被调度到另一个核时周期计数不可比较
+        size_t consumed = 0;
+        BaseType_t decode_core = xPortGetCoreID();
+        uint32_t decode_start_cycles = esp_cpu_get_cycle_count();
+        AudioDecodeResult decode_result = decoder->DecodeFrame(read_ptr, span_size, &consumed, pcm);
+        uint32_t decode_cycles = esp_cpu_get_cycle_count() - decode_start_cycles;
+        buffer->CommitRead(consumed);
         
-        if (decode_result == 0) {
-            // 解码成功，获取帧信息
-            MP3GetLastFrameInfo(mp3_decoder_, &mp3_frame_info_);
+        if (decode_result == kAudioDecodeOk) {
+            const AudioFrameInfo& frame_info = decoder->frame_info();
             total_frames_decoded_++;
-            
-            // 基本的帧信息有效性检查，防止除零错误
-            if (mp3_frame_info_.samprate == 0 || mp3_frame_info_.nChans == 0) {
-                ESP_LOGW(TAG, "Invalid frame info: rate=%d, channels=%d, skipping", 
-                        mp3_frame_info_.samprate, mp3_frame_info_.nChans);
+            stats_.OnDecode(xPortGetCoreID() == decode_core ? (int64_t)decode_cycles : -1);
+            stats_.OnDecodeOk();
+            stats_.OnBufferFill(buffer->Size(), buffer->capacity());
+            if (frame_info.samples == 0) {
                 continue;
             }
+
+            // VBR每帧码率不同，平滑后作为水位计算的码率
+            average_bitrate = average_bitrate == 0 ? frame_info.bitrate
+                                                   : average_bitrate + ((frame_info.bitrate - average_bitrate) >> 4);
+            jitter_.SetBitrate(average_bitrate);
             
-            // 计算当前帧的持续时间(毫秒)
-            int frame_duration_ms = (mp3_frame_info_.outputSamps * 1000) / 
-                                  (mp3_frame_info_.samprate * mp3_frame_info_.nChans);
+            // 本帧在混音器中的开始时刻与本帧的播放位置对齐，此前送出的帧被丢弃（非空闲状态）时也能保持同步
+            int64_t frame_clock_ms = app.GetAudioService().GetMusicEndClockMs();
+            clock_offset_ms_ = current_play_time_ms_ - frame_clock_ms;
+
+            // 按样本数累计播放时间，余数留到下一帧，避免每帧取整带来的累积误差
+            frame_time_remainder += (int64_t)frame_info.samples * 1000;
+            int frame_duration_ms = (int)(frame_time_remainder / frame_info.sample_rate);
+            frame_time_remainder %= frame_info.sample_rate;
             
             // 更新当前播放时间
             current_play_time_ms_ += frame_duration_ms;
             
             ESP_LOGD(TAG, "Frame %d: time=%lldms, duration=%dms, rate=%d, ch=%d", 
-                    total_frames_decoded_, current_play_time_ms_, frame_duration_ms,
-                    mp3_frame_info_.samprate, mp3_frame_info_.nChans);
+                    total_frames_decoded_, current_play_time_ms_.load(), frame_duration_ms,
+                    frame_info.sample_rate, frame_info.channels);
             
-            // 更新歌词显示
-            int buffer_latency_ms = 600; // 实测调整值
-            UpdateLyricDisplay(current_play_time_ms_ + buffer_latency_ms);
+            // 按扬声器实际播放到的位置更新歌词显示
+            UpdateLyricDisplay(GetPosition());
             
             // 将PCM数据发送到Application的音频解码队列
-            if (mp3_frame_info_.outputSamps > 0) {
-                int16_t* final_pcm_data = pcm_buffer;
-                int final_sample_count = mp3_frame_info_.outputSamps;
-                std::vector<int16_t> mono_buffer;
-                
-                // 如果是双通道，转换为单通道混合
-                if (mp3_frame_info_.nChans == 2) {
-                    // 双通道转单通道：将左右声道混合
-                    int stereo_samples = mp3_frame_info_.outputSamps;  // 包含左右声道的总样本数
-                    int mono_samples = stereo_samples / 2;  // 实际的单声道样本数
-                    
-                    mono_buffer.resize(mono_samples);
-                    
-                    for (int i = 0; i < mono_samples; ++i) {
-                        // 混合左右声道 (L + R) / 2
-                        int left = pcm_buffer[i * 2];      // 左声道
-                        int right = pcm_buffer[i * 2 + 1]; // 右声道
-                        mono_buffer[i] = (int16_t)((left + right) / 2);
+            // 双声道保持交错格式，由AudioService根据codec的声道数决定是否混为单声道
+            if (frame_info.channels <= 2) {
+                int channels = frame_info.channels;
+                int frames = frame_info.samples;
+                size_t pcm_size_bytes = pcm.size() * sizeof(int16_t);
+
+                // 频谱显示使用单声道数据，按一帧MP3的最大单声道样本数分配，切换曲目后帧长可能变化
+                // 解码比播放超前，按帧记录开始播放的时钟，由 GetAudioData() 取出正在播放的那一帧
+                if (display_mode_ == DISPLAY_MODE_SPECTRUM) {
+                    if (final_pcm_data_fft == nullptr) {
+                        final_pcm_data_fft = (int16_t*)heap_caps_calloc(
+                            FFT_HISTORY_FRAMES * MAX_FFT_SAMPLES, sizeof(int16_t),
+                            MALLOC_CAP_SPIRAM
+                        );
+                    }
+                    if (final_pcm_data_fft != nullptr) {
+                        int slot = fft_frame_count_.load() % FFT_HISTORY_FRAMES;
+                        int16_t* fft_frame = final_pcm_data_fft + slot * MAX_FFT_SAMPLES;
+                        int fft_samples = std::min(frames, MAX_FFT_SAMPLES);
+                        if (channels == 2) {
+                            DownmixStereoToMono(pcm.data(), fft_samples, fft_frame);
+                        } else {
+                            memcpy(fft_frame, pcm.data(), fft_samples * sizeof(int16_t));
+                        }
+                        fft_frame_clock_ms_[slot] = frame_clock_ms;
+                        fft_frame_count_++;
                     }
-                    
-                    final_pcm_data = mono_buffer.data();
-                    final_sample_count = mono_samples;
-
-                    ESP_LOGD(TAG, "Converted stereo to mono: %d -> %d samples", 
-                            stereo_samples, mono_samples);
-                } else if (mp3_frame_info_.nChans == 1) {
-                    // 已经是单声道，无需转换
-                    ESP_LOGD(TAG, "Already mono audio: %d samples", final_sample_count);
-                } else {
-                    ESP_LOGW(TAG, "Unsupported channel count: %d, treating as mono", 
-                            mp3_frame_info_.nChans);
-                }
-                
-                // 创建AudioStreamPacket
-                AudioStreamPacket packet;
-                packet.sample_rate = mp3_frame_info_.samprate;
-                packet.frame_duration = 60;  // 使用Application默认的帧时长
-                packet.timestamp = 0;
-                
-                // 将int16_t PCM数据转换为uint8_t字节数组
-                size_t pcm_size_bytes = final_sample_count * sizeof(int16_t);
-                packet.payload.resize(pcm_size_bytes);
-                memcpy(packet.payload.data(), final_pcm_data, pcm_size_bytes);
-
-                if (final_pcm_data_fft == nullptr) {
-                    final_pcm_data_fft = (int16_t*)heap_caps_malloc(
-                        final_sample_count * sizeof(int16_t),
-                        MALLOC_CAP_SPIRAM
-                    );
                 }
                 
-                memcpy(
-                    final_pcm_data_fft,
-                    final_pcm_data,
-                    final_sample_count * sizeof(int16_t)
-                );
-                
-                ESP_LOGD(TAG, "Sending %d PCM samples (%d bytes, rate=%d, channels=%d->1) to Application", 
-                        final_sample_count, pcm_size_bytes, mp3_frame_info_.samprate, mp3_frame_info_.nChans);
+                ESP_LOGD(TAG, "Sending %d PCM frames (%u bytes, rate=%d, channels=%d) to Application", 
+                        frames, (unsigned int)pcm_size_bytes, frame_info.sample_rate, channels);
                 
                 // 发送到Application的音频解码队列
-                app.AddAudioData(std::move(packet));
+                app.AddAudioData(std::move(pcm), frame_info.sample_rate, channels);
+                pcm.clear();
+                jitter_.OnFirstAudio();
+                startup_timer_.Mark(kStartupStageFirstAudio);
                 total_played += pcm_size_bytes;
                 
                 // 打印播放进度
                 if (total_played % (128 * 1024) == 0) {
-                    ESP_LOGI(TAG, "Played %d bytes, buffer size: %d", total_played, buffer_size_);
+                    ESP_LOGI(TAG, "Played %u bytes, buffer size: %u", (unsigned int)total_played,
+                            (unsigned int)buffer->Size());
                 }
+            } else {
+                ESP_LOGW(TAG, "Unsupported channel count: %d, skipping frame", frame_info.channels);
             }
-            
-        } else {
-            // 解码失败
-            // 错误代码说明:
-            // -1: ERR_MP3_INDATA_UNDERFLOW (数据不足)
-            // -2: ERR_MP3_MAINDATA_UNDERFLOW (主数据不足)
-            // -9: ERR_MP3_INVALID_FRAMEHEADER (无效帧头)
-            
-            // 根据错误类型采取不同的处理策略
-            if (decode_result == -1 || decode_result == -2) {
-                // 数据不足，等待更多数据
-                ESP_LOGD(TAG, "MP3 decode: insufficient data (error %d), need more data", decode_result);
-                bytes_left = 0;  // 清空当前缓冲区，等待新数据
-            } else if (decode_result == -9) {
-                // 无效帧头，尝试重新同步
-                static int invalid_frame_count = 0;
-                invalid_frame_count++;
-                
-                if (invalid_frame_count % 10 == 1) {  // 每10次打印一次，减少日志
-                    ESP_LOGW(TAG, "MP3 decode: invalid frame header (count: %d), resyncing", invalid_frame_count);
-                }
-                
-                // 跳过一些字节寻找新的同步词
-                if (bytes_left > 1) {
-                    read_ptr++;
-                    bytes_left--;
-                } else {
-                    bytes_left = 0;
-                }
+        } else if (decode_result == kAudioDecodeNeedMoreData) {
+            // 数据不足一帧，等待更多数据；下载已结束或连续数据已足够仍不足时丢弃剩余数据
+            ESP_LOGD(TAG, "%s decode: insufficient data, need more data", decoder->name());
+            if (!buffer->closed() && span_size < decoder->min_input_bytes()) {
+                buffer->WaitForData(span_size + 1);
             } else {
-                // 其他错误
-                ESP_LOGW(TAG, "MP3 decode failed with error: %d, skipping data", decode_result);
-                
-                // 跳过更多字节
-                int skip_bytes = std::min(bytes_left, 128);
-                read_ptr += skip_bytes;
-                bytes_left -= skip_bytes;
+                stats_.OnDroppedBytes(buffer->Skip(span_size));
+            }
+        } else if (decode_result == kAudioDecodeError) {
+            // 解码器已跳过损坏的数据，继续寻找下一帧
+            decode_error_count++;
+            stats_.OnDecodeError(consumed);
+            if (decode_error_count % 10 == 1) {  // 每10次打印一次，减少日志
+                ESP_LOGW(TAG, "%s decode error (count: %d), resyncing", decoder->name(), decode_error_count);
             }
         }
     }
     
-    // 清理
-    if (mp3_input_buffer) {
-        heap_caps_free(mp3_input_buffer);
-    }
-    
     // 播放结束时进行基本清理，但不调用StopStreaming避免线程自我等待
-    ESP_LOGI(TAG, "Audio stream playback finished, total played: %d bytes", total_played);
+    ESP_LOGI(TAG, "Audio stream playback finished, total played: %u bytes", (unsigned int)total_played);
+    JitterBufferStats stats = jitter_.GetStats();
+    ESP_LOGI(TAG, "Stream stats: throughput=%d±%d kbps, bitrate=%d kbps, ttfa=%lld ms, underruns=%d, stall=%lld ms",
+            stats.throughput_kbps, stats.throughput_deviation_kbps, stats.bitrate_kbps,
+            stats.time_to_first_audio_ms, stats.underrun_count, stats.stall_ms);
     ESP_LOGI(TAG, "Performing basic cleanup from play thread");
     
-    // 停止播放标志
-    is_playing_ = false;
+    // 停止播放标志，并唤醒等待下一首的下载线程
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        is_playing_ = false;
+    }
+    audio_buffer_.Stop();
+    prefetch_buffer_.Stop();
+    queue_cv_.notify_all();
     
     // 只在频谱显示模式下才停止FFT显示
     if (display_mode_ == DISPLAY_MODE_SPECTRUM) {
@@ -1158,63 +1926,121 @@ void Esp32Music::PlayAudioStream() {
     }
 }
 
-// 清空音频缓冲区
-void Esp32Music::ClearAudioBuffer() {
-    std::lock_guard<std::mutex> lock(buffer_mutex_);
-    
-    while (!audio_buffer_.empty()) {
-        AudioChunk chunk = audio_buffer_.front();
-        audio_buffer_.pop();
-        if (chunk.data) {
-            heap_caps_free(chunk.data);
+// 跳转到指定播放位置：按seek索引换算字节偏移后重新发起一次Range请求，不重新下载整首歌
+bool Esp32Music::Seek(int64_t position_ms) {
+    if (!is_playing_) {
+        ESP_LOGW(TAG, "Seek ignored, no music is playing");
+        return false;
+    }
+
+    if (live_stream_) {
+        ESP_LOGW(TAG, "Seek not supported for live streams");
+        return false;
+    }
+
+    size_t byte_offset;
+    {
+        std::lock_guard<std::mutex> lock(seek_mutex_);
+        if (!seek_index_.valid()) {
+            ESP_LOGW(TAG, "Seek index not available for current track");
+            return false;
         }
+        int64_t duration_ms = seek_index_.GetDurationMs();
+        position_ms = std::max<int64_t>(0, position_ms);
+        if (duration_ms > 0 && position_ms >= duration_ms) {
+            ESP_LOGW(TAG, "Seek position %lld ms beyond duration %lld ms", position_ms, duration_ms);
+            return false;
+        }
+        byte_offset = seek_index_.GetByteOffset(position_ms);
     }
-    
-    buffer_size_ = 0;
-    ESP_LOGI(TAG, "Audio buffer cleared");
+
+    ESP_LOGI(TAG, "Seeking to %lld ms (byte offset %u)", position_ms, (unsigned int)byte_offset);
+
+    // 歌词从头重新查找，重新显示歌名并启动频谱
+    current_lyric_index_ = -1;
+    song_name_displayed_ = false;
+
+    std::string music_url;
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        music_url = current_music_url_;
+    }
+    return StartStreamingAt(music_url, byte_offset, position_ms);
 }
 
-// 初始化MP3解码器
-bool Esp32Music::InitializeMp3Decoder() {
-    mp3_decoder_ = MP3InitDecoder();
-    if (mp3_decoder_ == nullptr) {
-        ESP_LOGE(TAG, "Failed to initialize MP3 decoder");
-        mp3_decoder_initialized_ = false;
-        return false;
+int64_t Esp32Music::GetDuration() const {
+    std::lock_guard<std::mutex> lock(seek_mutex_);
+    return seek_index_.GetDurationMs();
+}
+
+// 清空音频缓冲区（仅在下载和播放线程都已退出后调用）
+void Esp32Music::ClearAudioBuffer(size_t stream_offset) {
+    audio_buffer_.Reset(stream_offset);
+    prefetch_buffer_.Reset();
+    play_buffer_ = &audio_buffer_;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        prefetch_ready_ = false;
     }
-    
-    mp3_decoder_initialized_ = true;
-    ESP_LOGI(TAG, "MP3 decoder initialized successfully");
-    return true;
+    ESP_LOGI(TAG, "Audio buffer cleared");
 }
 
-// 清理MP3解码器
-void Esp32Music::CleanupMp3Decoder() {
-    if (mp3_decoder_ != nullptr) {
-        MP3FreeDecoder(mp3_decoder_);
-        mp3_decoder_ = nullptr;
+// 等待缓冲区达到起播水位，水位随吞吐量和码率的测量结果变化，所以分段等待并重新计算
+bool Esp32Music::WaitForStartWatermark(MusicRingBuffer* buffer) {
+    while (is_playing_ && !buffer->stopped() && !buffer->closed()) {
+        size_t watermark = std::min(jitter_.GetStartWatermark(), buffer->capacity());
+        if (buffer->Size() >= watermark) {
+            break;
+        }
+        buffer->WaitForData(watermark, 100);
     }
-    mp3_decoder_initialized_ = false;
-    ESP_LOGI(TAG, "MP3 decoder cleaned up");
+    return is_playing_ && !buffer->stopped();
 }
 
-// 重置采样率到原始值
-void Esp32Music::ResetSampleRate() {
-    auto& board = Board::GetInstance();
-    auto codec = board.GetAudioCodec();
-    if (codec && codec->original_output_sample_rate() > 0 && 
-        codec->output_sample_rate() != codec->original_output_sample_rate()) {
-        ESP_LOGI(TAG, "重置采样率：从 %d Hz 重置到原始值 %d Hz", 
-                codec->output_sample_rate(), codec->original_output_sample_rate());
-        if (codec->SetOutputSampleRate(-1)) {  // -1 表示重置到原始值
-            ESP_LOGI(TAG, "成功重置采样率到原始值: %d Hz", codec->output_sample_rate());
-        } else {
-            ESP_LOGW(TAG, "无法重置采样率到原始值");
+// 当前曲目缓冲区播放完毕后切换到已预取的下一首，没有下一首时返回false
+bool Esp32Music::SwitchToNextTrack(MusicRingBuffer*& buffer) {
+    PrefetchedTrack next;
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        // 下载线程可能还在解析下一首的地址
+        queue_cv_.wait(lock, [this]() {
+            return prefetch_ready_ || !is_downloading_ || !is_playing_;
+        });
+        if (!prefetch_ready_ || !is_playing_) {
+            return false;
+        }
+        next = prefetched_;
+        prefetch_ready_ = false;
+        // 预取期间队列被切歌或清空，预取的数据已经过期
+        if (next.queue_generation != queue_generation_) {
+            ESP_LOGW(TAG, "Prefetched track is stale, stopping playback");
+            return false;
         }
+        queue_index_ = next.queue_index;
+        play_buffer_ = next.buffer;
     }
+    // 通知下载线程旧缓冲区已经空闲
+    queue_cv_.notify_all();
+    buffer = next.buffer;
+
+    SetCurrentTrack(next.track, next.resolved);
+    current_play_time_ms_ = 0;
+    // 上一首剩余的PCM还在混音队列中，下一首从队列末尾开始计时
+    clock_offset_ms_ = -Application::GetInstance().GetAudioService().GetMusicEndClockMs();
+    last_frame_time_ms_ = 0;
+    total_frames_decoded_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(seek_mutex_);
+        seek_index_.Clear();
+    }
+
+    StartLyrics();
+
+    ESP_LOGI(TAG, "Gapless switch to next track: %s", next.track.song_name.c_str());
+    return true;
 }
 
-// 跳过MP3文件开头的ID3标签
+// 计算MP3文件开头ID3标签的总长度（不是ID3标签时返回0）
 size_t Esp32Music::SkipId3Tag(uint8_t* data, size_t size) {
     if (!data || size < 10) {
         return 0;
@@ -1231,20 +2057,15 @@ size_t Esp32Music::SkipId3Tag(uint8_t* data, size_t size) {
                         ((uint32_t)(data[8] & 0x7F) << 7)  |
                         ((uint32_t)(data[9] & 0x7F));
     
-    // ID3v2头部(10字节) + 标签内容
+    // ID3v2头部(10字节) + 标签内容，可能超过当前可用数据，由调用方从环形缓冲区中逐步跳过
     size_t total_skip = 10 + tag_size;
     
-    // 确保不超过可用数据大小
-    if (total_skip > size) {
-        total_skip = size;
-    }
-    
     ESP_LOGI(TAG, "Found ID3v2 tag, skipping %u bytes", (unsigned int)total_skip);
     return total_skip;
 }
 
-// 下载歌词
-bool Esp32Music::DownloadLyrics(const std::string& lyric_url) {
+// 下载歌词（缓存中的歌词直接读取文件）
+bool Esp32Music::DownloadLyrics(const std::string& lyric_url, std::string* content, MusicCancelToken* cancel) {
     ESP_LOGI(TAG, "Downloading lyrics from: %s", lyric_url.c_str());
     
     // 检查URL是否为空
@@ -1252,6 +2073,23 @@ bool Esp32Music::DownloadLyrics(const std::string& lyric_url) {
         ESP_LOGE(TAG, "Lyric URL is empty!");
         return false;
     }
+
+    // 缓存和本地曲库中的歌词直接读取
+    if (IsLocalFile(lyric_url)) {
+        FILE* file = fopen(lyric_url.c_str(), "rb");
+        if (file == nullptr) {
+            ESP_LOGE(TAG, "Failed to open cached lyrics: %s", lyric_url.c_str());
+            return false;
+        }
+        content->clear();
+        char buffer[512];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            content->append(buffer, n);
+        }
+        fclose(file);
+        return true;
+    }
     
     // 添加重试逻辑
     const int max_retries = 3;
@@ -1265,13 +2103,16 @@ bool Esp32Music::DownloadLyrics(const std::string& lyric_url) {
     while (retry_count < max_retries && !success && redirect_count < max_redirects) {
         if (retry_count > 0) {
             ESP_LOGI(TAG, "Retrying lyric download (attempt %d of %d)", retry_count + 1, max_retries);
-            // 重试前暂停一下
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            // 重试前暂停一下，停止播放时立即放弃
+            if (cancel == nullptr) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            } else if (!cancel->WaitFor(500)) {
+                break;
+            }
         }
         
-        // 使用Board提供的HTTP客户端
-        auto network = Board::GetInstance().GetNetwork();
-        auto http = network->CreateHttp(0);
+        // 与元数据请求复用同一条keep-alive连接
+        auto http = http_pool_.CreateHttp(cancel);
         if (!http) {
             ESP_LOGE(TAG, "Failed to create HTTP client for lyric download");
             retry_count++;
@@ -1347,7 +2188,8 @@ bool Esp32Music::DownloadLyrics(const std::string& lyric_url) {
                 // bytes_read < 0，可能是ESP-IDF的已知问题
                 // 如果已经读取到了一些数据，则认为下载成功
                 if (!lyric_content.empty()) {
-                    ESP_LOGW(TAG, "HTTP read returned %d, but we have data (%d bytes), continuing", bytes_read, lyric_content.length());
+                    ESP_LOGW(TAG, "HTTP read returned %d, but we have data (%u bytes), continuing", bytes_read,
+                            (unsigned int)lyric_content.length());
                     success = true;
                     break;
                 } else {
@@ -1381,174 +2223,193 @@ bool Esp32Music::DownloadLyrics(const std::string& lyric_url) {
     if (!lyric_content.empty()) {
         size_t preview_size = std::min(lyric_content.size(), size_t(50));
         std::string preview = lyric_content.substr(0, preview_size);
-        ESP_LOGD(TAG, "Lyric content preview (%d bytes): %s", lyric_content.length(), preview.c_str());
+        ESP_LOGD(TAG, "Lyric content preview (%u bytes): %s", (unsigned int)lyric_content.length(), preview.c_str());
     } else {
         ESP_LOGE(TAG, "Failed to download lyrics or lyrics are empty");
         return false;
     }
     
-    ESP_LOGI(TAG, "Lyrics downloaded successfully, size: %d bytes", lyric_content.length());
-    return ParseLyrics(lyric_content);
+    ESP_LOGI(TAG, "Lyrics downloaded successfully, size: %u bytes", (unsigned int)lyric_content.length());
+    *content = std::move(lyric_content);
+    return true;
 }
 
-// 解析歌词
-bool Esp32Music::ParseLyrics(const std::string& lyric_content) {
-    ESP_LOGI(TAG, "Parsing lyrics content");
-    
-    // 使用锁保护lyrics_数组访问
-    std::lock_guard<std::mutex> lock(lyrics_mutex_);
-    
-    lyrics_.clear();
-    
-    // 按行分割歌词内容
-    std::istringstream stream(lyric_content);
-    std::string line;
-    
-    while (std::getline(stream, line)) {
-        // 去除行尾的回车符
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-        
-        // 跳过空行
-        if (line.empty()) {
-            continue;
+// 工作线程中下载并解析歌词，期间切了歌（generation 过期）时丢弃结果
+void Esp32Music::LoadLyrics(const std::string& lyric_url, uint32_t generation,
+                            std::shared_ptr<MusicCancelToken> cancel) {
+    std::string lyric_content;
+    if (!DownloadLyrics(lyric_url, &lyric_content, cancel.get())) {
+        ESP_LOGE(TAG, "Failed to download lyrics");
+        return;
+    }
+    // 被取消的下载可能只读到了一部分
+    if (cancel && cancel->cancelled()) {
+        return;
+    }
+    startup_timer_.Mark(kStartupStageLyricsFetched);
+    if (generation != lyric_generation_) {
+        return;
+    }
+
+    auto snapshot = std::make_unique<LyricSnapshot>();
+    snapshot->generation = generation;
+    if (!snapshot->index.Parse(lyric_content)) {
+        ESP_LOGE(TAG, "Failed to parse lyrics");
+        return;
+    }
+    ESP_LOGI(TAG, "Parsed %d lyric lines (offset %d ms)", (int)snapshot->index.size(), snapshot->index.offset_ms());
+    // 播放线程还没取走的旧歌词直接丢弃
+    delete pending_lyrics_.exchange(snapshot.release(), std::memory_order_acq_rel);
+    startup_timer_.Mark(kStartupStageLyricsParsed);
+
+    // 歌词属于当前曲目，写入缓存（音频还在下载时会在音频提交后一起计入）
+    std::string cache_key;
+    {
+        std::lock_guard<std::mutex> lock(track_mutex_);
+        if (current_resolved_.lyric_url == lyric_url) {
+            cache_key = current_resolved_.cache_key;
         }
-        
-        // 解析LRC格式: [mm:ss.xx]歌词文本
-        if (line.length() > 10 && line[0] == '[') {
-            size_t close_bracket = line.find(']');
-            if (close_bracket != std::string::npos) {
-                std::string tag_or_time = line.substr(1, close_bracket - 1);
-                std::string content = line.substr(close_bracket + 1);
-                
-                // 检查是否是元数据标签而不是时间戳
-                // 元数据标签通常是 [ti:标题], [ar:艺术家], [al:专辑] 等
-                size_t colon_pos = tag_or_time.find(':');
-                if (colon_pos != std::string::npos) {
-                    std::string left_part = tag_or_time.substr(0, colon_pos);
-                    
-                    // 检查冒号左边是否是时间（数字）
-                    bool is_time_format = true;
-                    for (char c : left_part) {
-                        if (!isdigit(c)) {
-                            is_time_format = false;
-                            break;
-                        }
-                    }
-                    
-                    // 如果不是时间格式，跳过这一行（元数据标签）
-                    if (!is_time_format) {
-                        // 可以在这里处理元数据，例如提取标题、艺术家等信息
-                        ESP_LOGD(TAG, "Skipping metadata tag: [%s]", tag_or_time.c_str());
-                        continue;
-                    }
-                    
-                    // 是时间格式，解析时间戳
-                    try {
-                        int minutes = std::stoi(tag_or_time.substr(0, colon_pos));
-                        float seconds = std::stof(tag_or_time.substr(colon_pos + 1));
-                        int timestamp_ms = minutes * 60 * 1000 + (int)(seconds * 1000);
-                        
-                        // 安全处理歌词文本，确保UTF-8编码正确
-                        std::string safe_lyric_text;
-                        if (!content.empty()) {
-                            // 创建安全副本并验证字符串
-                            safe_lyric_text = content;
-                            // 确保字符串以null结尾
-                            safe_lyric_text.shrink_to_fit();
-                        }
-                        
-                        lyrics_.push_back(std::make_pair(timestamp_ms, safe_lyric_text));
-                        
-                        if (!safe_lyric_text.empty()) {
-                            // 限制日志输出长度，避免中文字符截断问题
-                            size_t log_len = std::min(safe_lyric_text.length(), size_t(50));
-                            std::string log_text = safe_lyric_text.substr(0, log_len);
-                            ESP_LOGD(TAG, "Parsed lyric: [%d ms] %s", timestamp_ms, log_text.c_str());
-                        } else {
-                            ESP_LOGD(TAG, "Parsed lyric: [%d ms] (empty)", timestamp_ms);
-                        }
-                    } catch (const std::exception& e) {
-                        ESP_LOGW(TAG, "Failed to parse time: %s", tag_or_time.c_str());
-                    }
-                }
-            }
+    }
+    if (!cache_key.empty() && !IsLocalFile(lyric_url)) {
+        cache_.StoreLyrics(cache_key, lyric_content);
+    }
+}
+
+// 扬声器实际播放到的位置：AudioService的音乐播放时钟已扣除混音队列和I2S DMA中尚未播放的数据
+int64_t Esp32Music::GetPosition() const {
+    int64_t position = Application::GetInstance().GetAudioService().GetMusicPlaybackClockMs() + clock_offset_ms_;
+    // 切歌或seek后旧数据还在播放时位置为负，解码前不会超过已解码的位置
+    return std::clamp<int64_t>(position, 0, current_play_time_ms_.load());
+}
+
+// 返回正在播放的那一帧PCM：最近记录的帧中开始时钟不晚于当前播放时钟的最新一帧
+int16_t* Esp32Music::GetAudioData() {
+    if (final_pcm_data_fft == nullptr) {
+        return nullptr;
+    }
+    int count = fft_frame_count_.load();
+    if (count == 0) {
+        return final_pcm_data_fft;
+    }
+    int64_t clock_ms = Application::GetInstance().GetAudioService().GetMusicPlaybackClockMs();
+    int history = std::min(count, FFT_HISTORY_FRAMES);
+    int slot = (count - 1) % FFT_HISTORY_FRAMES;
+    for (int i = 0; i < history; i++) {
+        slot = (count - 1 - i) % FFT_HISTORY_FRAMES;
+        if (fft_frame_clock_ms_[slot] <= clock_ms) {
+            break;
         }
     }
-    
-    // 按时间戳排序
-    std::sort(lyrics_.begin(), lyrics_.end());
-    
-    ESP_LOGI(TAG, "Parsed %d lyric lines", lyrics_.size());
-    return !lyrics_.empty();
+    return final_pcm_data_fft + slot * MAX_FFT_SAMPLES;
 }
 
-// 歌词显示线程
-void Esp32Music::LyricDisplayThread() {
-    ESP_LOGI(TAG, "Lyric display thread started");
-    
-    if (!DownloadLyrics(current_lyric_url_)) {
-        ESP_LOGE(TAG, "Failed to download or parse lyrics");
-        is_lyric_running_ = false;
-        return;
+cJSON* Esp32Music::GetStatsJson(bool detailed) const {
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json, "playing", is_playing_.load());
+    cJSON_AddBoolToObject(json, "paused", is_paused_.load());
+    if (is_playing_) {
+        cJSON_AddNumberToObject(json, "position_ms", (double)GetPosition());
     }
-    
-    // 定期检查是否需要更新显示(频率可以降低)
-    while (is_lyric_running_ && is_playing_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    JitterBufferStats stream = jitter_.GetStats();
+    cJSON_AddNumberToObject(json, "throughput_kbps", stream.throughput_kbps);
+    cJSON_AddNumberToObject(json, "bitrate_kbps", stream.bitrate_kbps);
+    cJSON_AddNumberToObject(json, "buffer_bytes", (double)play_buffer_.load()->Size());
+    cJSON_AddNumberToObject(json, "underruns", stream.underrun_count);
+    cJSON_AddNumberToObject(json, "stall_ms", (double)stream.stall_ms);
+    cJSON_AddNumberToObject(json, "ttfa_ms", (double)stream.time_to_first_audio_ms);
+    if (!detailed) {
+        return json;
     }
-    
-    ESP_LOGI(TAG, "Lyric display thread finished");
+
+    cJSON_AddNumberToObject(json, "throughput_deviation_kbps", stream.throughput_deviation_kbps);
+    cJSON* watermarks = cJSON_AddObjectToObject(json, "watermarks");
+    cJSON_AddNumberToObject(watermarks, "start", (double)stream.start_watermark);
+    cJSON_AddNumberToObject(watermarks, "low", (double)stream.low_watermark);
+    cJSON_AddNumberToObject(watermarks, "high", (double)stream.high_watermark);
+    cJSON_AddNumberToObject(watermarks, "capacity", (double)play_buffer_.load()->capacity());
+
+    // 起播各阶段距离播放请求的时间，-1表示还没有到达
+    MusicStartupStats startup = startup_timer_.GetStats();
+    cJSON* startup_json = cJSON_AddObjectToObject(json, "startup_ms");
+    for (int i = 0; i < kStartupStageCount; i++) {
+        cJSON_AddNumberToObject(startup_json, MusicStartupTimer::StageName((MusicStartupStage)i),
+                                (double)startup.stage_ms[i]);
+    }
+
+    cJSON* http = cJSON_AddObjectToObject(json, "http");
+    cJSON_AddNumberToObject(http, "connects", http_pool_.connect_count());
+    cJSON_AddNumberToObject(http, "reuses", http_pool_.reuse_count());
+
+    stats_.AddToJson(json);
+
+    // 均衡器和响度均衡，cpu_percent 为按播放速率折算的单核占用
+    MusicDspStats dsp = Application::GetInstance().GetAudioService().GetMusicDspStats();
+    cJSON* dsp_json = cJSON_AddObjectToObject(json, "dsp");
+    cJSON_AddStringToObject(dsp_json, "eq_preset", MusicDsp::PresetName(dsp.eq_preset));
+    cJSON_AddBoolToObject(dsp_json, "normalization", dsp.normalization);
+    cJSON_AddNumberToObject(dsp_json, "loudness_lufs", dsp.loudness_lufs);
+    cJSON_AddNumberToObject(dsp_json, "gain_db", dsp.gain_db);
+    cJSON_AddNumberToObject(dsp_json, "limited_samples", dsp.limited_samples);
+    cJSON_AddNumberToObject(dsp_json, "avg_cycles", dsp.avg_cycles);
+    cJSON_AddNumberToObject(dsp_json, "max_cycles", dsp.max_cycles);
+    cJSON_AddNumberToObject(dsp_json, "cpu_percent", dsp.cpu_percent);
+    return json;
 }
 
+// 播放线程中调用，不加锁：先接收工作线程新发布的歌词，再二分查找当前行
 void Esp32Music::UpdateLyricDisplay(int64_t current_time_ms) {
-    std::lock_guard<std::mutex> lock(lyrics_mutex_);
-    
-    if (lyrics_.empty()) {
-        return;
+    LyricSnapshot* published = pending_lyrics_.exchange(nullptr, std::memory_order_acq_rel);
+    if (published != nullptr) {
+        lyrics_.reset(published);
+        current_lyric_index_ = -1;
     }
-    
-    // 查找当前应该显示的歌词
+
+    // 已经切到下一首但新歌词还没有加载完
     int new_lyric_index = -1;
-    
-    // 从当前歌词索引开始查找，提高效率
-    int start_index = (current_lyric_index_.load() >= 0) ? current_lyric_index_.load() : 0;
-    
-    // 正向查找：找到最后一个时间戳小于等于当前时间的歌词
-    for (int i = start_index; i < (int)lyrics_.size(); i++) {
-        if (lyrics_[i].first <= current_time_ms) {
-            new_lyric_index = i;
-        } else {
-            break;  // 时间戳已超过当前时间
-        }
+    if (lyrics_ && lyrics_->generation == lyric_generation_.load(std::memory_order_relaxed)) {
+        new_lyric_index = lyrics_->index.Find(current_time_ms);
+    } else if (current_lyric_index_ < 0) {
+        return;
     }
     
-    // 如果没有找到(可能当前时间比第一句歌词还早)，显示空
-    if (new_lyric_index == -1) {
-        new_lyric_index = -1;
+    auto& board = Board::GetInstance();
+    auto display = board.GetDisplay();
+    if (display == nullptr) {
+        return;
     }
-    
+
     // 如果歌词索引发生变化，更新显示
     if (new_lyric_index != current_lyric_index_) {
         current_lyric_index_ = new_lyric_index;
-        
-        auto& board = Board::GetInstance();
-        auto display = board.GetDisplay();
-        if (display) {
-            std::string lyric_text;
-            
-            if (current_lyric_index_ >= 0 && current_lyric_index_ < (int)lyrics_.size()) {
-                lyric_text = lyrics_[current_lyric_index_].second;
-            }
-            
-            // 显示歌词
-            display->SetChatMessage("lyric", lyric_text.c_str());
-            
-            ESP_LOGD(TAG, "Lyric update at %lldms: %s", 
-                    current_time_ms, 
-                    lyric_text.empty() ? "(no lyric)" : lyric_text.c_str());
-        }
+
+        const char* lyric_text = new_lyric_index >= 0 ? lyrics_->index.text(new_lyric_index) : "";
+        bool karaoke = new_lyric_index >= 0 && lyrics_->index.has_word_timing(new_lyric_index);
+
+        // 显示歌词，逐字歌词随后更新进度
+        display->SetLyric(lyric_text, karaoke);
+        lyric_progress_dirty_ = true;
+
+        ESP_LOGD(TAG, "Lyric update at %lldms: %s", 
+                current_time_ms, 
+                lyric_text[0] == '\0' ? "(no lyric)" : lyric_text);
+    }
+
+    // 每帧解码后都会调用，逐字进度按 LYRIC_PROGRESS_INTERVAL_MS 限制刷新频率
+    if (new_lyric_index < 0 || !lyrics_->index.has_word_timing(new_lyric_index)) {
+        return;
+    }
+    // 换行后立即刷新；seek 后播放时间可能倒退，也立即刷新
+    if (!lyric_progress_dirty_ && current_time_ms >= lyric_progress_time_ms_ &&
+        current_time_ms - lyric_progress_time_ms_ < LYRIC_PROGRESS_INTERVAL_MS) {
+        return;
+    }
+    lyric_progress_dirty_ = false;
+    lyric_progress_time_ms_ = current_time_ms;
+
+    LyricWordProgress progress;
+    if (lyrics_->index.GetWordProgress(new_lyric_index, current_time_ms, &progress)) {
+        display->SetLyricProgress(progress.word_start, progress.word_end, progress.permille);
     }
 }
 
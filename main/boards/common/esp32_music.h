@@ -2,91 +2,201 @@
 #define ESP32_MUSIC_H
 
 #include <string>
+#include <memory>
 #include <thread>
 #include <atomic>
-#include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <vector>
 
 #include "music.h"
+#include "device_state.h"
+#include "music_ring_buffer.h"
+#include "mp3_seek_index.h"
+#include "music_cache.h"
+#include "music_library.h"
+#include "jitter_buffer_controller.h"
+#include "audio_decoder.h"
+#include "music_http_pool.h"
+#include "music_worker.h"
+#include "music_cancel_token.h"
+#include "music_startup_timer.h"
+#include "music_stats.h"
+#include "lyric_index.h"
+#include "icy_metadata.h"
+#include "hls_playlist.h"
+
+struct cJSON;
 
 // MP3解码器支持
 extern "C" {
 #include "mp3dec.h"
 }
 
-// 音频数据块结构
-struct AudioChunk {
-    uint8_t* data;
-    size_t size;
-    
-    AudioChunk() : data(nullptr), size(0) {}
-    AudioChunk(uint8_t* d, size_t s) : data(d), size(s) {}
-};
-
 class Esp32Music : public Music {
-public:
-    // 显示模式控制 - 移动到public区域
-    enum DisplayMode {
-        DISPLAY_MODE_SPECTRUM = 0,  // 默认显示频谱
-        DISPLAY_MODE_LYRICS = 1     // 显示歌词
+private:
+    // 解析得到的播放地址
+    struct ResolvedTrack {
+        std::string audio_url;     // 网络URL，或者命中缓存/本地曲库时的本地文件路径
+        std::string lyric_url;
+        std::string cache_key;     // 缓存未启用时为空
+        std::string metadata;      // 接口返回的元数据，写入缓存用
+        bool cached = false;
+        bool live = false;         // 电台直播流：没有长度，不缓存，不支持seek
+        size_t audio_offset = 0;   // 从文件的这个偏移开始读取（本地曲库跳过ID3标签）
+    };
+
+    // 下载线程预取好的下一首
+    struct PrefetchedTrack {
+        MusicTrack track;
+        ResolvedTrack resolved;
+        int queue_index = -1;
+        uint32_t queue_generation = 0;
+        MusicRingBuffer* buffer = nullptr;
     };
 
-private:
     std::string last_downloaded_data_;
+    // 当前曲目，工作线程启动播放和播放线程无缝切歌时更新，受 track_mutex_ 保护
+    mutable std::mutex track_mutex_;
     std::string current_music_url_;
     std::string current_song_name_;
-    bool song_name_displayed_;
+    MusicTrack current_track_;          // 当前曲目及其解析结果（缓存键、元数据）
+    ResolvedTrack current_resolved_;
+    std::atomic<bool> song_name_displayed_;
     
     // 歌词相关
     std::string current_lyric_url_;
-    std::vector<std::pair<int, std::string>> lyrics_;  // 时间戳和歌词文本
-    std::mutex lyrics_mutex_;  // 保护lyrics_数组的互斥锁
+    // 解析好的歌词及其所属的歌词代数
+    struct LyricSnapshot {
+        uint32_t generation;
+        LyricIndex index;
+    };
+    // 工作线程把解析好的歌词放到 pending_lyrics_，播放线程取走后独占 lyrics_，查询时不加锁
+    std::atomic<LyricSnapshot*> pending_lyrics_{nullptr};
+    std::unique_ptr<LyricSnapshot> lyrics_;
     std::atomic<int> current_lyric_index_;
-    std::thread lyric_thread_;
-    std::atomic<bool> is_lyric_running_;
+    static constexpr int LYRIC_PROGRESS_INTERVAL_MS = 40;  // 逐字进度最多25fps刷新
+    int64_t lyric_progress_time_ms_ = 0;  // 上次更新逐字进度时的播放时间
+    bool lyric_progress_dirty_ = true;    // 歌词换行后需要立即刷新逐字进度
+    std::atomic<uint32_t> lyric_generation_{0};  // 每次加载歌词时增加，代数不同的歌词不再显示
     
     std::atomic<DisplayMode> display_mode_;
     std::atomic<bool> is_playing_;
+    std::atomic<bool> is_paused_{false};  // 暂停时播放线程在 queue_cv_ 上等待，下载线程缓冲到高水位后空闲
+    std::atomic<bool> is_interrupted_{false};  // 语音交互（非待机状态）期间同样暂停，回到待机后自动继续
+    bool end_chat_for_music_ = false;  // 对话中点播的歌曲，回复播报完后结束对话再开始播放（受 queue_mutex_ 保护）
     std::atomic<bool> is_downloading_;
     std::thread play_thread_;
     std::thread download_thread_;
-    int64_t current_play_time_ms_;  // 当前播放时间(毫秒)
+    // 已解码到的播放时间(毫秒)，比实际听到的位置超前混音队列和DMA缓冲的长度；播放线程写入，GetPosition() 在其他线程读取
+    std::atomic<int64_t> current_play_time_ms_{0};
+    // 实际播放位置 = AudioService的音乐播放时钟 + clock_offset_ms_，每次送出PCM时重新对齐
+    std::atomic<int64_t> clock_offset_ms_{0};
     int64_t last_frame_time_ms_;    // 上一帧的时间戳
     int total_frames_decoded_;      // 已解码的帧数
 
-    // 音频缓冲区
-    std::queue<AudioChunk> audio_buffer_;
-    std::mutex buffer_mutex_;
-    std::condition_variable buffer_cv_;
-    size_t buffer_size_;
+    // 音频缓冲区（预分配的单生产者/单消费者环形缓冲区）
     static constexpr size_t MAX_BUFFER_SIZE = 256 * 1024;  // 256KB缓冲区（降低以减少brownout风险）
-    static constexpr size_t MIN_BUFFER_SIZE = 32 * 1024;   // 32KB最小播放缓冲（降低以减少brownout风险）
-    
-    // MP3解码器相关
-    HMP3Decoder mp3_decoder_;
-    MP3FrameInfo mp3_frame_info_;
-    bool mp3_decoder_initialized_;
+    static constexpr int MAX_FFT_SAMPLES = 1152;           // 一帧MP3解码后的最大单声道样本数
+    MusicRingBuffer audio_buffer_;
+
+    // 下载中断后的重连策略：指数退避，成功读到数据后重置
+    static constexpr int RECONNECT_MAX_ATTEMPTS = 8;
+    static constexpr int RECONNECT_BASE_DELAY_MS = 250;
+    static constexpr int RECONNECT_MAX_DELAY_MS = 8000;
+
+    // HLS直播：选择不超过该码率的子播放列表，播放列表至少间隔 HLS_MIN_RELOAD_MS 重新加载一次
+    static constexpr uint32_t HLS_MAX_BANDWIDTH = 192000;
+    static constexpr int HLS_MIN_RELOAD_MS = 1000;
+
+    // 预取缓冲区：与audio_buffer_轮流作为当前曲目和下一首的缓冲区，大小即预取的数据量
+    static constexpr size_t PREFETCH_BUFFER_SIZE = 128 * 1024;
+    MusicRingBuffer prefetch_buffer_;
+    std::atomic<MusicRingBuffer*> play_buffer_;  // 播放线程正在解码的缓冲区
+
+    // 起播/高/低水位根据实测吞吐量和码率调整
+    JitterBufferController jitter_;
+    MusicStats stats_;
+
+    // 播放队列，queue_cv_ 用于下载线程等待下一首/空闲缓冲区、播放线程等待预取完成和恢复播放
+    mutable std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    std::vector<MusicTrack> queue_;
+    int queue_index_ = -1;
+    uint32_t queue_generation_ = 0;  // 队列被清空或插入新曲目时增加，使旧的预取失效
+    bool prefetch_ready_ = false;
+    PrefetchedTrack prefetched_;
+
+    // 当前曲目的时间->字节偏移索引，由播放线程在第一帧建立
+    mutable std::mutex seek_mutex_;
+    Mp3SeekIndex seek_index_;
+
+    // 本地歌曲缓存
+    MusicCache cache_;
+    // SD卡/闪存上的本地曲库，解析歌曲时优先查找
+    MusicLibrary library_;
+    size_t track_start_offset_ = 0;  // 当前曲目从文件中的这个偏移开始播放，在该处建立seek索引（受 track_mutex_ 保护）
+
+    // 音乐接口、音频流和歌词共用的keep-alive连接池
+    MusicHttpPool http_pool_;
+
+    // 启动音频流和加载歌词在工作线程中执行，play_generation_ 在新的播放请求或停止时增加，
+    // 使尚未执行的启动任务失效
+    MusicWorker worker_;
+    std::atomic<uint32_t> play_generation_{0};
+    std::atomic<bool> start_pending_{false};
+    std::recursive_mutex stream_mutex_;  // 串行化工作线程和工具调用线程对流式播放的启动/停止
+    // 当前播放的取消令牌，每次启动音频流时新建，由下载线程和歌词任务共享
+    // （持有 stream_mutex_ 和 track_mutex_ 时写入，持有其中之一即可读取）
+    std::shared_ptr<MusicCancelToken> stream_cancel_;
+    // 当前歌词任务的取消令牌，与音频流分开，切歌时不等音频流停止就能中断歌词下载（受 track_mutex_ 保护）
+    std::shared_ptr<MusicCancelToken> lyric_cancel_;
+    MusicStartupTimer startup_timer_;
+    std::atomic<bool> live_stream_{false};  // 正在播放电台直播流
     
     // 私有方法
-    void DownloadAudioStream(const std::string& music_url);
-    void PlayAudioStream();
-    void ClearAudioBuffer();
-    bool InitializeMp3Decoder();
-    void CleanupMp3Decoder();
-    void ResetSampleRate();  // 重置采样率到原始值
+    bool ResolveTrack(const MusicTrack& track, ResolvedTrack& resolved, std::string* response,
+                      MusicCancelToken* cancel = nullptr);
+    bool PlayTrack(const MusicTrack& track, std::string* response);
+    bool PostStartTrack(const MusicTrack& track, const ResolvedTrack& resolved);
+    void SetCurrentTrack(const MusicTrack& track, const ResolvedTrack& resolved);
+    void StartLyrics();
+    void CancelLyrics();
+    void WakeStreamingThreads();
+    void CancelStreaming();
+    bool StartStreamingAt(const std::string& music_url, size_t byte_offset, int64_t start_ms);
+    void DownloadAudioStream(const std::string& music_url, size_t start_offset,
+                             std::shared_ptr<MusicCancelToken> cancel);
+    bool DownloadTrack(const MusicTrack& track, const ResolvedTrack& resolved, MusicRingBuffer* buffer,
+                       size_t start_offset, MusicCancelToken& cancel);
+    bool ReadCachedTrack(const std::string& path, MusicRingBuffer* buffer, size_t start_offset);
+    bool WaitForBufferSpace(MusicRingBuffer* buffer, size_t chunk_size, bool* resumed_from_idle);
+    void DownloadLiveStream(const MusicTrack& track, const ResolvedTrack& resolved, MusicRingBuffer* buffer,
+                            MusicCancelToken& cancel);
+    void DownloadHlsStream(const ResolvedTrack& resolved, MusicRingBuffer* buffer, MusicCancelToken& cancel);
+    bool DownloadHlsSegment(const std::string& url, MusicRingBuffer* buffer, MusicCancelToken& cancel,
+                            bool* unsupported);
+    void PlayAudioStream(int64_t start_ms);
+    bool WaitForStartWatermark(MusicRingBuffer* buffer);
+    bool SwitchToNextTrack(MusicRingBuffer*& buffer);
+    void ClearAudioBuffer(size_t stream_offset = 0);
+    void OnDeviceStateChanged(DeviceState previous_state, DeviceState current_state);
+    void ArbitrateDeviceState(DeviceState state);
+    void UpdatePauseState();
     
     // 歌词相关私有方法
-    bool DownloadLyrics(const std::string& lyric_url);
-    bool ParseLyrics(const std::string& lyric_content);
-    void LyricDisplayThread();
+    bool DownloadLyrics(const std::string& lyric_url, std::string* lyric_content, MusicCancelToken* cancel);
+    void LoadLyrics(const std::string& lyric_url, uint32_t generation, std::shared_ptr<MusicCancelToken> cancel);
     void UpdateLyricDisplay(int64_t current_time_ms);
     
     // ID3标签处理
     size_t SkipId3Tag(uint8_t* data, size_t size);
 
+    // 频谱数据：最近 FFT_HISTORY_FRAMES 帧的单声道PCM及其开始播放的时钟，频谱显示取正在播放的那一帧
+    static constexpr int FFT_HISTORY_FRAMES = 24;          // 覆盖混音队列和DMA缓冲的长度
     int16_t* final_pcm_data_fft = nullptr;
+    std::atomic<int64_t> fft_frame_clock_ms_[FFT_HISTORY_FRAMES] = {};  // 播放线程写入，显示线程读取
+    std::atomic<int> fft_frame_count_{0};
 
 public:
     Esp32Music();
@@ -95,17 +205,37 @@ public:
     virtual bool Download(const std::string& song_name, const std::string& artist_name) override;
   
     virtual std::string GetDownloadResult() override;
+    virtual bool PlayRadio(const std::string& url, const std::string& name) override;
     
     // 新增方法
     virtual bool StartStreaming(const std::string& music_url) override;
     virtual bool StopStreaming() override;  // 停止流式播放
-    virtual size_t GetBufferSize() const override { return buffer_size_; }
+    virtual bool Pause() override;
+    virtual bool Resume() override;
+    virtual bool IsPaused() const override { return is_paused_; }
+    virtual size_t GetBufferSize() const override { return play_buffer_.load()->Size(); }
     virtual bool IsDownloading() const override { return is_downloading_; }
-    virtual int16_t* GetAudioData() override { return final_pcm_data_fft; }
+    virtual int16_t* GetAudioData() override;
+
+    // 播放队列
+    virtual bool Enqueue(const std::string& song_name, const std::string& artist_name) override;
+    virtual bool Next() override;
+    virtual bool Previous() override;
+    virtual void Clear() override;
+    virtual std::vector<MusicTrack> GetQueue() const override;
+    virtual int GetQueueIndex() const override;
+
+    // 播放位置
+    virtual bool Seek(int64_t position_ms) override;
+    virtual int64_t GetDuration() const override;
+    virtual int64_t GetPosition() const override;
+    JitterBufferStats GetStreamStats() const { return jitter_.GetStats(); }
+    MusicStartupStats GetStartupStats() const { return startup_timer_.GetStats(); }
+    virtual cJSON* GetStatsJson(bool detailed) const override;
     
     // 显示模式控制方法
-    void SetDisplayMode(DisplayMode mode);
-    DisplayMode GetDisplayMode() const { return display_mode_.load(); }
+    virtual void SetDisplayMode(DisplayMode mode) override;
+    virtual DisplayMode GetDisplayMode() const override { return display_mode_.load(); }
 };
 
 #endif // ESP32_MUSIC_H
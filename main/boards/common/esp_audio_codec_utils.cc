@@ -0,0 +1,68 @@
+#include "esp_audio_codec_utils.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "EspAudioCodec"
+
+// 原地把小端的24位（3字节）或32位样本转换为16位，只保留高16位
+static void ConvertTo16Bit(uint8_t* data, size_t samples, int bits_per_sample) {
+    int16_t* output = (int16_t*)data;
+    size_t stride = bits_per_sample / 8;
+    for (size_t i = 0; i < samples; i++) {
+        const uint8_t* sample = data + i * stride;
+        output[i] = (int16_t)(sample[stride - 2] | (sample[stride - 1] << 8));
+    }
+}
+
+AudioDecodeResult DecodeEspAudioFrame(EspAudioDecodeFunc decode, void* decoder, esp_audio_dec_in_raw_t* raw,
+                                      size_t max_frame_samples, size_t* consumed, std::vector<int16_t>& pcm,
+                                      AudioFrameInfo& frame_info) {
+    if (pcm.size() < max_frame_samples) {
+        pcm.resize(max_frame_samples);
+    }
+    esp_audio_dec_out_frame_t frame = {};
+    frame.buffer = (uint8_t*)pcm.data();
+    frame.len = pcm.size() * sizeof(int16_t);
+    esp_audio_dec_info_t info = {};
+
+    esp_audio_err_t ret = decode(decoder, raw, &frame, &info);
+    if (ret == ESP_AUDIO_ERR_BUFF_NOT_ENOUGH) {
+        pcm.resize((frame.needed_size + 1) / sizeof(int16_t));
+        frame.buffer = (uint8_t*)pcm.data();
+        frame.len = pcm.size() * sizeof(int16_t);
+        ret = decode(decoder, raw, &frame, &info);
+    }
+    *consumed = raw->consumed;
+
+    if (ret == ESP_AUDIO_ERR_DATA_LACK) {
+        return *consumed > 0 ? kAudioDecodeSkipped : kAudioDecodeNeedMoreData;
+    }
+    if (ret != ESP_AUDIO_ERR_OK) {
+        ESP_LOGW(TAG, "Decode failed with error: %d, skipping data", ret);
+        *consumed = std::max<size_t>(*consumed, 1);
+        return kAudioDecodeError;
+    }
+    if (frame.decoded_size == 0 || info.channel == 0 || info.sample_rate == 0) {
+        // 头部或元数据，没有PCM输出
+        pcm.clear();
+        return kAudioDecodeSkipped;
+    }
+
+    int bits_per_sample = info.bits_per_sample > 0 ? info.bits_per_sample : 16;
+    size_t samples = frame.decoded_size / (bits_per_sample / 8);
+    if (bits_per_sample != 16) {
+        ConvertTo16Bit(frame.buffer, samples, bits_per_sample);
+    }
+    pcm.resize(samples);
+
+    frame_info.sample_rate = info.sample_rate;
+    frame_info.channels = info.channel;
+    frame_info.samples = samples / info.channel;
+    if (info.bitrate > 0) {
+        frame_info.bitrate = info.bitrate;
+    } else if (frame_info.samples > 0) {
+        frame_info.bitrate = (int)((int64_t)*consumed * 8 * info.sample_rate / frame_info.samples);
+    }
+    return kAudioDecodeOk;
+}
@@ -0,0 +1,17 @@
+#ifndef ESP_AUDIO_CODEC_UTILS_H
+#define ESP_AUDIO_CODEC_UTILS_H
+
+#include "audio_decoder.h"
+
+#include <esp_audio_dec.h>
+
+typedef esp_audio_err_t (*EspAudioDecodeFunc)(void* decoder, esp_audio_dec_in_raw_t* raw,
+                                              esp_audio_dec_out_frame_t* frame, esp_audio_dec_info_t* info);
+
+// 调用 esp_audio_codec 的解码函数解码一帧：输出缓冲区不够时按需扩大后重试，
+// 24/32位输出转换为16位，并更新帧信息（解码器不提供码率时按消耗的字节数估算）
+AudioDecodeResult DecodeEspAudioFrame(EspAudioDecodeFunc decode, void* decoder, esp_audio_dec_in_raw_t* raw,
+                                      size_t max_frame_samples, size_t* consumed, std::vector<int16_t>& pcm,
+                                      AudioFrameInfo& frame_info);
+
+#endif // ESP_AUDIO_CODEC_UTILS_H
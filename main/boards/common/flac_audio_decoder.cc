@@ -0,0 +1,50 @@
+#include "flac_audio_decoder.h"
+#include "esp_audio_codec_utils.h"
+
+#include <esp_log.h>
+#include <esp_flac_dec.h>
+#include <cstring>
+
+#define TAG "FlacAudioDecoder"
+
+// 常见的块大小为4096样本/声道，更大的块由解码器报告所需的输出大小
+#define FLAC_MAX_FRAME_SAMPLES (4096 * 2)
+
+FlacAudioDecoder::~FlacAudioDecoder() {
+    if (decoder_ != nullptr) {
+        esp_flac_dec_close(decoder_);
+    }
+}
+
+bool FlacAudioDecoder::Probe(const uint8_t* data, size_t size) {
+    return size >= 4 && memcmp(data, "fLaC", 4) == 0;
+}
+
+bool FlacAudioDecoder::Initialize() {
+    if (esp_flac_dec_open(nullptr, 0, &decoder_) != ESP_AUDIO_ERR_OK) {
+        ESP_LOGE(TAG, "Failed to open FLAC decoder");
+        decoder_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void FlacAudioDecoder::Reset() {
+    if (decoder_ != nullptr) {
+        esp_flac_dec_close(decoder_);
+        decoder_ = nullptr;
+    }
+    Initialize();
+}
+
+AudioDecodeResult FlacAudioDecoder::DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                                std::vector<int16_t>& pcm) {
+    *consumed = 0;
+    if (decoder_ == nullptr) {
+        return kAudioDecodeError;
+    }
+    esp_audio_dec_in_raw_t raw = {};
+    raw.buffer = (uint8_t*)data;
+    raw.len = size;
+    return DecodeEspAudioFrame(esp_flac_dec_decode, decoder_, &raw, FLAC_MAX_FRAME_SAMPLES, consumed, pcm, frame_info_);
+}
@@ -0,0 +1,26 @@
+#ifndef FLAC_AUDIO_DECODER_H
+#define FLAC_AUDIO_DECODER_H
+
+#include "audio_decoder.h"
+
+// FLAC解码器，使用 esp_audio_codec 组件，"fLaC" 头和元数据块由解码器自行解析
+class FlacAudioDecoder : public AudioDecoder {
+public:
+    ~FlacAudioDecoder();
+
+    static bool Probe(const uint8_t* data, size_t size);
+
+    AudioFormat format() const override { return kAudioFormatFlac; }
+    const char* name() const override { return "FLAC"; }
+    // 16位立体声4096样本的块压缩后通常在16KB以内
+    size_t min_input_bytes() const override { return kMaxInputBytes; }
+    bool Initialize() override;
+    void Reset() override;
+    AudioDecodeResult DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                  std::vector<int16_t>& pcm) override;
+
+private:
+    void* decoder_ = nullptr;
+};
+
+#endif // FLAC_AUDIO_DECODER_H
@@ -0,0 +1,183 @@
+#include "hls_playlist.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#define TAG "HlsPlaylist"
+
+// 直播时从距离末尾多少个分段开始播放
+static const int kLiveStartSegments = 3;
+
+static bool StartsWith(const std::string& line, const char* prefix) {
+    return line.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// 从属性列表（如 BANDWIDTH=128000,CODECS="mp4a.40.2"）中取出属性值
+static std::string GetAttribute(const std::string& attributes, const char* name) {
+    size_t name_length = strlen(name);
+    size_t pos = 0;
+    while (pos < attributes.size()) {
+        size_t end = pos;
+        bool quoted = false;
+        while (end < attributes.size() && (quoted || attributes[end] != ',')) {
+            if (attributes[end] == '"') {
+                quoted = !quoted;
+            }
+            end++;
+        }
+        if (attributes.compare(pos, name_length, name) == 0 && pos + name_length < end &&
+            attributes[pos + name_length] == '=') {
+            std::string value = attributes.substr(pos + name_length + 1, end - pos - name_length - 1);
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+                value = value.substr(1, value.size() - 2);
+            }
+            return value;
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+bool HlsPlaylist::Parse(const std::string& text, const std::string& base_url) {
+    variants_.clear();
+    segments_.clear();
+    target_duration_ms_ = 0;
+    ended_ = false;
+
+    int64_t sequence = 0;
+    int segment_duration_ms = 0;
+    uint32_t variant_bandwidth = 0;
+    bool expect_variant = false;
+    bool header_found = false;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string line = text.substr(pos, end - pos);
+        pos = end + 1;
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        if (!header_found) {
+            // 可能带有UTF-8 BOM
+            if (StartsWith(line, "\xEF\xBB\xBF")) {
+                line = line.substr(3);
+            }
+            if (line != "#EXTM3U") {
+                ESP_LOGE(TAG, "Not an M3U8 playlist");
+                return false;
+            }
+            header_found = true;
+        } else if (StartsWith(line, "#EXT-X-STREAM-INF:")) {
+            variant_bandwidth = strtoul(GetAttribute(line.substr(18), "BANDWIDTH").c_str(), nullptr, 10);
+            expect_variant = true;
+        } else if (StartsWith(line, "#EXT-X-TARGETDURATION:")) {
+            target_duration_ms_ = atoi(line.c_str() + 22) * 1000;
+        } else if (StartsWith(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+            sequence = strtoll(line.c_str() + 22, nullptr, 10);
+        } else if (StartsWith(line, "#EXTINF:")) {
+            segment_duration_ms = (int)(strtod(line.c_str() + 8, nullptr) * 1000);
+        } else if (StartsWith(line, "#EXT-X-ENDLIST")) {
+            ended_ = true;
+        } else if (StartsWith(line, "#EXT-X-KEY:")) {
+            std::string method = GetAttribute(line.substr(11), "METHOD");
+            if (method != "NONE") {
+                ESP_LOGE(TAG, "Encrypted segments are not supported: %s", method.c_str());
+                return false;
+            }
+        } else if (line[0] == '#') {
+            // 其他标签不影响播放
+        } else if (expect_variant) {
+            variants_.push_back({ResolveUrl(base_url, line), variant_bandwidth});
+            expect_variant = false;
+        } else {
+            segments_.push_back({sequence++, ResolveUrl(base_url, line), segment_duration_ms});
+            segment_duration_ms = 0;
+        }
+    }
+
+    if (!header_found) {
+        ESP_LOGE(TAG, "Empty playlist");
+        return false;
+    }
+    if (target_duration_ms_ <= 0) {
+        int max_duration_ms = 0;
+        for (const auto& segment : segments_) {
+            max_duration_ms = std::max(max_duration_ms, segment.duration_ms);
+        }
+        target_duration_ms_ = max_duration_ms > 0 ? max_duration_ms : 10000;
+    }
+    return true;
+}
+
+const HlsPlaylist::Variant* HlsPlaylist::SelectVariant(uint32_t max_bandwidth) const {
+    const Variant* best = nullptr;
+    const Variant* lowest = nullptr;
+    for (const auto& variant : variants_) {
+        if (variant.bandwidth <= max_bandwidth && (best == nullptr || variant.bandwidth > best->bandwidth)) {
+            best = &variant;
+        }
+        if (lowest == nullptr || variant.bandwidth < lowest->bandwidth) {
+            lowest = &variant;
+        }
+    }
+    return best != nullptr ? best : lowest;
+}
+
+int64_t HlsPlaylist::StartSequence() const {
+    if (segments_.empty()) {
+        return 0;
+    }
+    if (ended_ || (int)segments_.size() <= kLiveStartSegments) {
+        return segments_.front().sequence;
+    }
+    return segments_[segments_.size() - kLiveStartSegments].sequence;
+}
+
+std::string HlsPlaylist::ResolveUrl(const std::string& base_url, const std::string& reference) {
+    if (reference.find("://") != std::string::npos) {
+        return reference;
+    }
+    size_t scheme_end = base_url.find("://");
+    if (scheme_end == std::string::npos) {
+        return reference;
+    }
+    if (reference.compare(0, 2, "//") == 0) {
+        return base_url.substr(0, scheme_end + 1) + reference;
+    }
+    size_t host_end = base_url.find('/', scheme_end + 3);
+    if (host_end == std::string::npos) {
+        host_end = base_url.size();
+    }
+    if (!reference.empty() && reference[0] == '/') {
+        return base_url.substr(0, host_end) + reference;
+    }
+    // 相对路径：去掉基地址的查询参数和最后一级路径
+    size_t path_end = std::min(base_url.find('?', host_end), base_url.size());
+    size_t last_slash = base_url.rfind('/', path_end - 1);
+    if (last_slash == std::string::npos || last_slash < host_end) {
+        return base_url.substr(0, host_end) + "/" + reference;
+    }
+    return base_url.substr(0, last_slash + 1) + reference;
+}
+
+bool HlsPlaylist::IsPlaylist(const std::string& url, const std::string& content_type) {
+    std::string type = content_type;
+    std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+    if (type.find("mpegurl") != std::string::npos) {
+        return true;
+    }
+    std::string path = url.substr(0, url.find_first_of("?#"));
+    std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+    return path.size() >= 5 && path.compare(path.size() - 5, 5, ".m3u8") == 0;
+}
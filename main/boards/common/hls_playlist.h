@@ -0,0 +1,53 @@
+#ifndef HLS_PLAYLIST_H
+#define HLS_PLAYLIST_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * HLS（HTTP Live Streaming）.m3u8 播放列表解析。
+ *
+ * - 主播放列表（#EXT-X-STREAM-INF）只列出不同码率的子播放列表，用 SelectVariant() 选一个再加载
+ * - 媒体播放列表列出分段，直播列表没有 #EXT-X-ENDLIST，需要每隔约一个 target duration 重新加载，
+ *   用 media sequence 编号判断哪些分段是新的
+ * - 不支持加密分段（#EXT-X-KEY 的 METHOD 不为 NONE），Parse() 返回false
+ */
+class HlsPlaylist {
+public:
+    struct Segment {
+        int64_t sequence;
+        std::string url;    // 已解析为绝对地址
+        int duration_ms;
+    };
+
+    struct Variant {
+        std::string url;
+        uint32_t bandwidth;
+    };
+
+    bool Parse(const std::string& text, const std::string& base_url);
+
+    bool is_master() const { return !variants_.empty(); }
+    // 选择不超过 max_bandwidth 的最高码率，都超过时选最低码率
+    const Variant* SelectVariant(uint32_t max_bandwidth) const;
+
+    const std::vector<Segment>& segments() const { return segments_; }
+    int target_duration_ms() const { return target_duration_ms_; }
+    // 有 #EXT-X-ENDLIST，即点播列表，不会再增加分段
+    bool ended() const { return ended_; }
+    // 开始播放的分段编号：点播从头开始，直播从倒数第3个分段开始，离直播点近又留有缓冲余量
+    int64_t StartSequence() const;
+
+    static std::string ResolveUrl(const std::string& base_url, const std::string& reference);
+    // URL 路径以 .m3u8 结尾，或者 Content-Type 为 mpegurl
+    static bool IsPlaylist(const std::string& url, const std::string& content_type);
+
+private:
+    std::vector<Variant> variants_;
+    std::vector<Segment> segments_;
+    int target_duration_ms_ = 0;
+    bool ended_ = false;
+};
+
+#endif // HLS_PLAYLIST_H
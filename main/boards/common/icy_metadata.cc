@@ -0,0 +1,64 @@
+#include "icy_metadata.h"
+
+#include <esp_log.h>
+#include <http.h>
+
+#define TAG "IcyMetadata"
+
+// 从连接中读满 size 字节
+static bool ReadFully(Http* http, char* buffer, size_t size) {
+    while (size > 0) {
+        int n = http->Read(buffer, size);
+        if (n <= 0) {
+            return false;
+        }
+        buffer += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool IcyMetadataReader::ReadMetadata(Http* http, bool* title_changed) {
+    *title_changed = false;
+    unsigned char length_byte = 0;
+    if (!ReadFully(http, (char*)&length_byte, 1)) {
+        return false;
+    }
+    audio_remaining_ = metaint_;
+    if (length_byte == 0) {
+        // 标题没有变化时服务器只发送一个0字节
+        return true;
+    }
+
+    std::string metadata(length_byte * 16, '\0');
+    if (!ReadFully(http, &metadata[0], metadata.size())) {
+        return false;
+    }
+    metadata.resize(metadata.find_last_not_of('\0') + 1);
+    ESP_LOGD(TAG, "Metadata: %s", metadata.c_str());
+
+    std::string title = ParseStreamTitle(metadata);
+    if (!title.empty() && title != title_) {
+        title_ = title;
+        *title_changed = true;
+    }
+    return true;
+}
+
+std::string IcyMetadataReader::ParseStreamTitle(const std::string& metadata) {
+    static const char kKey[] = "StreamTitle='";
+    size_t start = metadata.find(kKey);
+    if (start == std::string::npos) {
+        return "";
+    }
+    start += sizeof(kKey) - 1;
+    // 标题中可能带有单引号，以 "';" 作为结束
+    size_t end = metadata.find("';", start);
+    if (end == std::string::npos) {
+        end = metadata.rfind('\'');
+        if (end == std::string::npos || end < start) {
+            end = metadata.size();
+        }
+    }
+    return metadata.substr(start, end - start);
+}
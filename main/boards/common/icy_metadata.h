@@ -0,0 +1,45 @@
+#ifndef ICY_METADATA_H
+#define ICY_METADATA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Http;
+
+/*
+ * ICY（Shoutcast/Icecast）电台流中插入的元数据。
+ *
+ * 请求头带 Icy-MetaData: 1 时，服务器在响应头 icy-metaint 中给出间隔，之后每隔 metaint 字节音频
+ * 插入一个元数据块：1字节长度（乘以16）加上 StreamTitle='...';StreamUrl='...'; 形式的文本（不足时补0）。
+ *
+ * 调用方把音频直接读入环形缓冲区，每次最多读 AudioBytesBeforeMetadata() 字节，读到元数据的位置时
+ * 调用 ReadMetadata() 把元数据块读进这里的小缓冲区，音频数据本身不需要移动或复制。
+ */
+class IcyMetadataReader {
+public:
+    // metaint 为0表示服务器没有插入元数据
+    explicit IcyMetadataReader(size_t metaint = 0) : metaint_(metaint), audio_remaining_(metaint) {}
+
+    bool enabled() const { return metaint_ > 0; }
+    // 下一个元数据块之前还有多少字节音频，为0时接下来是元数据块
+    size_t AudioBytesBeforeMetadata() const { return enabled() ? audio_remaining_ : SIZE_MAX; }
+    void OnAudio(size_t bytes) {
+        if (enabled()) {
+            audio_remaining_ -= bytes;
+        }
+    }
+    // 从连接读取一个元数据块，连接出错时返回false；StreamTitle 变化时 title_changed 为true
+    bool ReadMetadata(Http* http, bool* title_changed);
+    const std::string& title() const { return title_; }
+
+    // 从元数据文本中取出 StreamTitle，没有时返回空字符串
+    static std::string ParseStreamTitle(const std::string& metadata);
+
+private:
+    size_t metaint_;
+    size_t audio_remaining_;
+    std::string title_;
+};
+
+#endif // ICY_METADATA_H
@@ -0,0 +1,139 @@
+#include "jitter_buffer_controller.h"
+
+#include <esp_timer.h>
+#include <algorithm>
+#include <cstdlib>
+
+// 吞吐量每累计这么长的读取时间采样一次
+#define JITTER_WINDOW_US            (250 * 1000)
+// 平滑系数（1/8）与TCP RTT估计相同
+#define JITTER_EWMA_SHIFT           3
+// 未测得码率时按128kbps估算
+#define JITTER_DEFAULT_BITRATE      128000
+// 网络余量充足时的缓冲时间，以及还没有吞吐量数据时的缓冲时间
+#define JITTER_BASE_CUSHION_MS      500
+#define JITTER_UNKNOWN_CUSHION_MS   1500
+// 吞吐量不足时需要覆盖的时长：按差额补足这段时间内的缺口
+#define JITTER_DEFICIT_HORIZON_MS   30000
+// 吞吐量（扣除两倍偏差后）至少为码率的1.25倍才算余量充足
+#define JITTER_HEADROOM_PERCENT     125
+// 高水位对应的音频时长
+#define JITTER_HIGH_WATERMARK_MS    20000
+#define JITTER_MIN_START_BYTES      (8 * 1024)
+
+JitterBufferController::JitterBufferController(size_t capacity) : capacity_(capacity) {
+}
+
+void JitterBufferController::Reset() {
+    window_bytes_ = 0;
+    window_us_ = 0;
+    bitrate_bps_ = 0;
+    underrun_count_ = 0;
+    stall_us_ = 0;
+    start_time_us_ = esp_timer_get_time();
+    first_audio_us_ = -1;
+}
+
+void JitterBufferController::OnDownload(size_t bytes, int64_t elapsed_us) {
+    window_bytes_ += bytes;
+    window_us_ += elapsed_us;
+    if (window_us_ < JITTER_WINDOW_US) {
+        return;
+    }
+
+    int sample = (int)((int64_t)window_bytes_ * 8 * 1000000 / window_us_);
+    window_bytes_ = 0;
+    window_us_ = 0;
+
+    int mean = throughput_bps_.load();
+    if (mean == 0) {
+        throughput_bps_ = sample;
+        deviation_bps_ = sample / 4;
+        return;
+    }
+    int deviation = deviation_bps_.load();
+    deviation += (std::abs(sample - mean) - deviation) >> JITTER_EWMA_SHIFT;
+    mean += (sample - mean) >> JITTER_EWMA_SHIFT;
+    throughput_bps_ = mean;
+    deviation_bps_ = deviation;
+}
+
+void JitterBufferController::SetBitrate(int bitrate_bps) {
+    bitrate_bps_ = bitrate_bps;
+}
+
+void JitterBufferController::OnUnderrun() {
+    underrun_count_++;
+}
+
+void JitterBufferController::OnStallEnd(int64_t stall_us) {
+    stall_us_ += stall_us;
+}
+
+void JitterBufferController::OnFirstAudio() {
+    int64_t expected = -1;
+    first_audio_us_.compare_exchange_strong(expected, esp_timer_get_time());
+}
+
+int64_t JitterBufferController::GetCushionMs() const {
+    int bitrate = bitrate_bps_.load();
+    if (bitrate <= 0) {
+        bitrate = JITTER_DEFAULT_BITRATE;
+    }
+    int throughput = throughput_bps_.load();
+
+    int64_t cushion_ms;
+    if (throughput == 0) {
+        cushion_ms = JITTER_UNKNOWN_CUSHION_MS;
+    } else {
+        // 用扣除两倍偏差后的保守吞吐量判断余量
+        int64_t conservative = std::max(0, throughput - 2 * deviation_bps_.load());
+        int64_t required = (int64_t)bitrate * JITTER_HEADROOM_PERCENT / 100;
+        cushion_ms = JITTER_BASE_CUSHION_MS;
+        if (conservative < required) {
+            cushion_ms += JITTER_DEFICIT_HORIZON_MS * (required - conservative) / required;
+        }
+    }
+    // 每次欠载后多缓冲50%
+    return cushion_ms * (2 + underrun_count_.load()) / 2;
+}
+
+size_t JitterBufferController::GetStartWatermark() const {
+    int bitrate = bitrate_bps_.load();
+    if (bitrate <= 0) {
+        bitrate = JITTER_DEFAULT_BITRATE;
+    }
+    size_t bytes = (size_t)((int64_t)bitrate / 8 * GetCushionMs() / 1000);
+    return std::clamp<size_t>(bytes, JITTER_MIN_START_BYTES, capacity_ * 3 / 4);
+}
+
+// 低水位取起播水位的两倍和高水位的一半中较大者，保证恢复下载时仍有足够余量
+size_t JitterBufferController::GetLowWatermark() const {
+    return std::min(std::max(GetStartWatermark() * 2, GetHighWatermark() / 2), GetHighWatermark());
+}
+
+size_t JitterBufferController::GetHighWatermark() const {
+    int bitrate = bitrate_bps_.load();
+    if (bitrate <= 0) {
+        bitrate = JITTER_DEFAULT_BITRATE;
+    }
+    size_t bytes = (size_t)((int64_t)bitrate / 8 * JITTER_HIGH_WATERMARK_MS / 1000);
+    return std::min(std::max(bytes, GetStartWatermark() * 2), capacity_);
+}
+
+JitterBufferStats JitterBufferController::GetStats() const {
+    JitterBufferStats stats;
+    stats.throughput_kbps = throughput_bps_ / 1000;
+    stats.throughput_deviation_kbps = deviation_bps_ / 1000;
+    stats.bitrate_kbps = bitrate_bps_ / 1000;
+    stats.start_watermark = GetStartWatermark();
+    stats.low_watermark = GetLowWatermark();
+    stats.high_watermark = GetHighWatermark();
+    stats.underrun_count = underrun_count_;
+    stats.stall_ms = stall_us_ / 1000;
+    int64_t first_audio = first_audio_us_.load();
+    if (first_audio >= 0) {
+        stats.time_to_first_audio_ms = (first_audio - start_time_us_) / 1000;
+    }
+    return stats;
+}
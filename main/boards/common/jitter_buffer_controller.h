@@ -0,0 +1,68 @@
+#ifndef JITTER_BUFFER_CONTROLLER_H
+#define JITTER_BUFFER_CONTROLLER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 音乐流的缓冲统计
+struct JitterBufferStats {
+    int throughput_kbps = 0;            // 下载吞吐量（平滑后）
+    int throughput_deviation_kbps = 0;  // 吞吐量平均偏差
+    int bitrate_kbps = 0;               // MP3帧头中的码率，未知为0
+    size_t start_watermark = 0;
+    size_t low_watermark = 0;
+    size_t high_watermark = 0;
+    int underrun_count = 0;
+    int64_t stall_ms = 0;               // 欠载后等待重新缓冲的总时长
+    int64_t time_to_first_audio_ms = -1;  // 从开始播放到第一帧PCM送入混音器，-1表示还没有
+};
+
+/*
+ * 根据实时测得的下载吞吐量、抖动和码流码率计算环形缓冲区的水位：
+ *
+ * - 起播水位：开始（或欠载后重新开始）解码前需要缓冲的数据量。网络余量充足时只缓冲约0.5秒音频，
+ *   吞吐量接近或低于码率时按差额补足一段时间内的缺口；每次欠载后缓冲时间增加50%
+ * - 高/低水位：缓冲区数据达到高水位（约20秒音频，不超过缓冲区容量）后下载线程暂停，
+ *   直到播放消耗到低水位再继续，让网络模块成批收发而不是一直保持接收
+ *
+ * 下载线程调用 OnDownload()，播放线程调用 SetBitrate()/OnUnderrun()，水位可在任意线程读取。
+ */
+class JitterBufferController {
+public:
+    explicit JitterBufferController(size_t capacity);
+
+    // 新的播放开始时调用（切到预取的下一首时不调用，吞吐量估计继续沿用）
+    void Reset();
+
+    // bytes 为一次读取的字节数，elapsed_us 为读取耗时（不包括等待缓冲区空间的时间）
+    void OnDownload(size_t bytes, int64_t elapsed_us);
+    void SetBitrate(int bitrate_bps);
+    void OnUnderrun();
+    void OnStallEnd(int64_t stall_us);
+    void OnFirstAudio();
+
+    size_t GetStartWatermark() const;
+    size_t GetLowWatermark() const;
+    size_t GetHighWatermark() const;
+    JitterBufferStats GetStats() const;
+
+private:
+    size_t capacity_;
+
+    // 测量窗口（仅下载线程访问）
+    size_t window_bytes_ = 0;
+    int64_t window_us_ = 0;
+
+    std::atomic<int> throughput_bps_{0};
+    std::atomic<int> deviation_bps_{0};
+    std::atomic<int> bitrate_bps_{0};
+    std::atomic<int> underrun_count_{0};
+    std::atomic<int64_t> stall_us_{0};
+    std::atomic<int64_t> start_time_us_{0};
+    std::atomic<int64_t> first_audio_us_{-1};
+
+    int64_t GetCushionMs() const;
+};
+
+#endif // JITTER_BUFFER_CONTROLLER_H
@@ -0,0 +1,199 @@
+#include "lyric_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+// 解析非负十进制整数，digits 返回数字个数
+static bool ParseNumber(const char*& p, const char* end, int* value, int* digits = nullptr) {
+    int result = 0;
+    int count = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (count < 9) {
+            result = result * 10 + (*p - '0');
+        }
+        p++;
+        count++;
+    }
+    if (count == 0) {
+        return false;
+    }
+    *value = result;
+    if (digits != nullptr) {
+        *digits = count;
+    }
+    return true;
+}
+
+// 解析时间戳标签的内容（不含方括号）：mm:ss[.xxx] 或 mm:ss:xx
+static bool ParseTimestamp(const char* p, const char* end, int* time_ms) {
+    int minutes, seconds;
+    if (!ParseNumber(p, end, &minutes) || p == end || *p++ != ':' || !ParseNumber(p, end, &seconds)) {
+        return false;
+    }
+    int fraction_ms = 0;
+    if (p < end && (*p == '.' || *p == ':')) {
+        p++;
+        int fraction, digits;
+        if (!ParseNumber(p, end, &fraction, &digits)) {
+            return false;
+        }
+        // 只取前三位，按位数换算为毫秒
+        for (; digits > 3; digits--) {
+            fraction /= 10;
+        }
+        static const int kScale[] = {1, 100, 10, 1};
+        fraction_ms = fraction * kScale[digits];
+    }
+    if (p != end) {
+        return false;
+    }
+    *time_ms = (minutes * 60 + seconds) * 1000 + fraction_ms;
+    return true;
+}
+
+// 解析 offset 标签的值：可带正负号的毫秒数
+static bool ParseOffset(const char* p, const char* end, int* offset_ms) {
+    while (p < end && *p == ' ') {
+        p++;
+    }
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        p++;
+    }
+    int value;
+    if (!ParseNumber(p, end, &value)) {
+        return false;
+    }
+    *offset_ms = negative ? -value : value;
+    return true;
+}
+
+bool LyricIndex::Parse(const std::string& content) {
+    arena_.clear();
+    lines_.clear();
+    words_.clear();
+    offset_ms_ = 0;
+    arena_.reserve(content.size());
+
+    int line_times[16];
+    const char* p = content.data();
+    const char* content_end = p + content.size();
+    while (p < content_end) {
+        const char* line_end = static_cast<const char*>(memchr(p, '\n', content_end - p));
+        if (line_end == nullptr) {
+            line_end = content_end;
+        }
+        const char* next = line_end + (line_end < content_end ? 1 : 0);
+        if (line_end > p && line_end[-1] == '\r') {
+            line_end--;
+        }
+
+        // 行首连续的标签：时间戳或者元数据
+        int time_count = 0;
+        while (p < line_end && *p == '[') {
+            const char* close = static_cast<const char*>(memchr(p, ']', line_end - p));
+            if (close == nullptr) {
+                break;
+            }
+            int value;
+            if (ParseTimestamp(p + 1, close, &value)) {
+                if (time_count < (int)(sizeof(line_times) / sizeof(line_times[0]))) {
+                    line_times[time_count++] = value;
+                }
+            } else if (close - p > 8 && strncmp(p + 1, "offset:", 7) == 0) {
+                ParseOffset(p + 8, close, &offset_ms_);
+            }
+            p = close + 1;
+        }
+
+        if (time_count > 0) {
+            uint32_t text_offset = arena_.size();
+            uint32_t word_begin = words_.size();
+            // 去掉逐字时间戳，记录每个字的起始字节；时间相对本行第一个时间戳
+            while (p < line_end) {
+                const char* tag_end = *p == '<' ? static_cast<const char*>(memchr(p, '>', line_end - p)) : nullptr;
+                int word_time;
+                if (tag_end != nullptr && ParseTimestamp(p + 1, tag_end, &word_time)) {
+                    words_.push_back(Word{word_time - line_times[0], (uint16_t)(arena_.size() - text_offset)});
+                    p = tag_end + 1;
+                    continue;
+                }
+                const char* next_tag = static_cast<const char*>(memchr(p + 1, '<', line_end - p - 1));
+                if (next_tag == nullptr) {
+                    next_tag = line_end;
+                }
+                arena_.append(p, next_tag - p);
+                p = next_tag;
+            }
+            uint16_t text_length = arena_.size() - text_offset;
+            uint16_t word_count = words_.size() - word_begin;
+            arena_.push_back('\0');
+            for (int i = 0; i < time_count; i++) {
+                lines_.push_back(Line{line_times[i], text_offset, word_begin, word_count, text_length});
+            }
+        }
+        p = next;
+    }
+
+    // offset为正时歌词提前显示
+    if (offset_ms_ != 0) {
+        for (auto& line : lines_) {
+            line.time_ms = std::max(0, (int)line.time_ms - offset_ms_);
+        }
+    }
+    // 多时间戳的行打乱了顺序，稳定排序保证同一时间的行保持原来的先后
+    std::stable_sort(lines_.begin(), lines_.end(),
+                     [](const Line& a, const Line& b) { return a.time_ms < b.time_ms; });
+
+    arena_.shrink_to_fit();
+    lines_.shrink_to_fit();
+    words_.shrink_to_fit();
+    return !lines_.empty();
+}
+
+int LyricIndex::Find(int64_t time_ms) const {
+    auto it = std::upper_bound(lines_.begin(), lines_.end(), time_ms,
+                               [](int64_t time, const Line& line) { return time < line.time_ms; });
+    return (int)(it - lines_.begin()) - 1;
+}
+
+bool LyricIndex::GetWordProgress(int index, int64_t time_ms, LyricWordProgress* progress) const {
+    const Line& line = lines_[index];
+    if (line.word_count == 0) {
+        return false;
+    }
+    const Word* words = &words_[line.word_begin];
+    int64_t elapsed = time_ms - line.time_ms;
+
+    // 还没唱到第一个字
+    if (elapsed < words[0].offset_ms) {
+        *progress = LyricWordProgress();
+        return true;
+    }
+    int k = line.word_count - 1;
+    while (k > 0 && words[k].offset_ms > elapsed) {
+        k--;
+    }
+
+    progress->word_start = words[k].byte_offset;
+    int64_t end_ms;
+    if (k + 1 < line.word_count) {
+        progress->word_end = words[k + 1].byte_offset;
+        end_ms = words[k + 1].offset_ms;
+    } else {
+        // 最后一个字没有结束时间戳时，最多持续到下一行或1秒
+        progress->word_end = line.text_length;
+        int64_t next_line_ms = (size_t)index + 1 < lines_.size() ? lines_[index + 1].time_ms - line.time_ms
+                                                                 : words[k].offset_ms + 1000;
+        end_ms = std::min<int64_t>(next_line_ms, words[k].offset_ms + 1000);
+    }
+
+    int64_t duration = end_ms - words[k].offset_ms;
+    if (duration <= 0 || progress->word_end <= progress->word_start) {
+        progress->permille = 1000;
+    } else {
+        progress->permille = std::min<int64_t>((elapsed - words[k].offset_ms) * 1000 / duration, 1000);
+    }
+    return true;
+}
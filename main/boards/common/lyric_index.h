@@ -0,0 +1,67 @@
+#ifndef LYRIC_INDEX_H
+#define LYRIC_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 逐字歌词的演唱进度：当前字（词）为文本中 [word_start, word_end) 的字节，permille 为该字已唱的千分比
+struct LyricWordProgress {
+    size_t word_start = 0;
+    size_t word_end = 0;
+    int permille = 0;
+};
+
+/*
+ * LRC歌词索引：一次扫描解析整份歌词，所有文本连续存放在一块内存（arena）中，
+ * 另有一张按时间排序的 时间戳/文本偏移 表，按播放时间查询当前行为 O(log n)。
+ *
+ * - 支持一行多个时间戳（[00:12.00][01:30.00]副歌），多个时间戳共用同一段文本
+ * - 支持 [offset:+/-毫秒] 标签，正数表示歌词整体提前显示
+ * - 支持增强LRC的逐字时间戳：[00:12.00]<00:12.00>你<00:12.40>好<00:13.10>，尖括号标签从文本中去掉，
+ *   只记录每个字（词）在文本中的起始字节和相对本行的开始时间，行末的时间戳表示最后一个字的结束
+ * - 时间戳格式为 [mm:ss]、[mm:ss.x]、[mm:ss.xx]、[mm:ss.xxx] 或 [mm:ss:xx]
+ * - 其他标签（[ti:]、[ar:] 等）忽略
+ *
+ * 解析完成后只读，可以在多个线程中同时查询。
+ */
+class LyricIndex {
+public:
+    // 解析LRC文本，返回是否包含带时间戳的歌词行
+    bool Parse(const std::string& content);
+
+    bool empty() const { return lines_.empty(); }
+    size_t size() const { return lines_.size(); }
+    int offset_ms() const { return offset_ms_; }
+
+    // time_ms 时应该显示的行，早于第一行时返回-1
+    int Find(int64_t time_ms) const;
+    int64_t time_ms(int index) const { return lines_[index].time_ms; }
+    const char* text(int index) const { return arena_.data() + lines_[index].text_offset; }
+    bool has_word_timing(int index) const { return lines_[index].word_count > 0; }
+
+    // 第 index 行在 time_ms 时的逐字进度，该行没有逐字时间戳时返回false
+    bool GetWordProgress(int index, int64_t time_ms, LyricWordProgress* progress) const;
+
+private:
+    struct Line {
+        int32_t time_ms;
+        uint32_t text_offset;  // 在 arena_ 中的偏移，文本以'\0'结尾
+        uint32_t word_begin;   // 在 words_ 中的下标，多个时间戳的同一行共用
+        uint16_t word_count;
+        uint16_t text_length;
+    };
+
+    struct Word {
+        int32_t offset_ms;     // 相对本行开始的时间
+        uint16_t byte_offset;  // 在本行文本中的起始字节
+    };
+
+    std::string arena_;
+    std::vector<Line> lines_;
+    std::vector<Word> words_;
+    int offset_ms_ = 0;
+};
+
+#endif // LYRIC_INDEX_H
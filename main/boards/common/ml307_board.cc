@@ -131,6 +131,13 @@ std::string Ml307Board::GetDeviceStatusJson() {
      *         "type": "cellular",
      *         "carrier": "CHINA MOBILE",
      *         "csq": 10
+     *     },
+     *     "music": {
+     *         "playing": true,
+     *         "position_ms": 12000,
+     *         "throughput_kbps": 512,
+     *         "underruns": 0,
+     *         "ttfa_ms": 850
      *     }
      * }
      */
@@ -186,6 +193,13 @@ std::string Ml307Board::GetDeviceStatusJson() {
     }
     cJSON_AddItemToObject(root, "network", network);
 
+    // Music
+    auto music = board.GetMusic();
+    cJSON* music_stats = music ? music->GetStatsJson(false) : nullptr;
+    if (music_stats) {
+        cJSON_AddItemToObject(root, "music", music_stats);
+    }
+
     auto json_str = cJSON_PrintUnformatted(root);
     std::string json(json_str);
     cJSON_free(json_str);
@@ -0,0 +1,95 @@
+#include "mp3_audio_decoder.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "Mp3AudioDecoder"
+
+Mp3AudioDecoder::~Mp3AudioDecoder() {
+    if (decoder_ != nullptr) {
+        MP3FreeDecoder(decoder_);
+    }
+}
+
+bool Mp3AudioDecoder::Probe(const uint8_t* data, size_t size) {
+    // 11位同步字，版本不为保留值，层不为保留值
+    return size >= 4 && data[0] == 0xFF && (data[1] & 0xE0) == 0xE0 &&
+           ((data[1] >> 3) & 0x03) != 1 && ((data[1] >> 1) & 0x03) != 0;
+}
+
+bool Mp3AudioDecoder::Initialize() {
+    decoder_ = MP3InitDecoder();
+    if (decoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to initialize MP3 decoder");
+        return false;
+    }
+    return true;
+}
+
+void Mp3AudioDecoder::Reset() {
+    // Helix 没有单独的复位接口，重新创建以丢弃比特池
+    if (decoder_ != nullptr) {
+        MP3FreeDecoder(decoder_);
+    }
+    decoder_ = MP3InitDecoder();
+}
+
+AudioDecodeResult Mp3AudioDecoder::DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                               std::vector<int16_t>& pcm) {
+    *consumed = 0;
+    if (decoder_ == nullptr) {
+        return kAudioDecodeError;
+    }
+
+    // 找到帧同步，先跳过同步字之前的数据
+    int sync_offset = MP3FindSyncWord((unsigned char*)data, (int)size);
+    if (sync_offset < 0) {
+        ESP_LOGW(TAG, "No MP3 sync word found, skipping %u bytes", (unsigned int)size);
+        *consumed = size;
+        return kAudioDecodeSkipped;
+    }
+    if (sync_offset > 0) {
+        *consumed = sync_offset;
+        return kAudioDecodeSkipped;
+    }
+
+    if (pcm.size() < MAX_NCHAN * MAX_NGRAN * MAX_NSAMP) {
+        pcm.resize(MAX_NCHAN * MAX_NGRAN * MAX_NSAMP);
+    }
+    unsigned char* read_ptr = (unsigned char*)data;
+    int bytes_left = (int)size;
+    int result = MP3Decode(decoder_, &read_ptr, &bytes_left, pcm.data(), 0);
+    *consumed = size - bytes_left;
+
+    switch (result) {
+    case ERR_MP3_NONE: {
+        MP3FrameInfo info;
+        MP3GetLastFrameInfo(decoder_, &info);
+        if (info.samprate == 0 || info.nChans == 0) {
+            ESP_LOGW(TAG, "Invalid frame info: rate=%d, channels=%d, skipping", info.samprate, info.nChans);
+            pcm.clear();
+            return kAudioDecodeSkipped;
+        }
+        frame_info_.sample_rate = info.samprate;
+        frame_info_.channels = info.nChans;
+        frame_info_.bitrate = info.bitrate;
+        frame_info_.samples = info.outputSamps / info.nChans;
+        pcm.resize(info.outputSamps);
+        return kAudioDecodeOk;
+    }
+    case ERR_MP3_INDATA_UNDERFLOW:
+        // 数据不足一帧
+        return kAudioDecodeNeedMoreData;
+    case ERR_MP3_MAINDATA_UNDERFLOW:
+        // 主数据不足（比特池尚未填满），该帧已被消耗，继续解码下一帧
+        return kAudioDecodeSkipped;
+    case ERR_MP3_INVALID_FRAMEHEADER:
+        // 无效帧头，跳过一个字节重新同步
+        *consumed = 1;
+        return kAudioDecodeError;
+    default:
+        ESP_LOGW(TAG, "MP3 decode failed with error: %d, skipping data", result);
+        *consumed = std::min<size_t>(std::max<size_t>(*consumed, 1), 128);
+        return kAudioDecodeError;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef MP3_AUDIO_DECODER_H
+#define MP3_AUDIO_DECODER_H
+
+#include "audio_decoder.h"
+
+extern "C" {
+#include "mp3dec.h"
+}
+
+// Helix MP3解码器
+class Mp3AudioDecoder : public AudioDecoder {
+public:
+    ~Mp3AudioDecoder();
+
+    // 数据开头是否为MPEG音频帧头（Layer I/II/III）
+    static bool Probe(const uint8_t* data, size_t size);
+
+    AudioFormat format() const override { return kAudioFormatMp3; }
+    const char* name() const override { return "MP3"; }
+    size_t min_input_bytes() const override { return 4096; }
+    bool Initialize() override;
+    void Reset() override;
+    AudioDecodeResult DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                  std::vector<int16_t>& pcm) override;
+
+private:
+    HMP3Decoder decoder_ = nullptr;
+};
+
+#endif // MP3_AUDIO_DECODER_H
@@ -0,0 +1,186 @@
+#include "mp3_seek_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Layer III 码率表（kbps），[0] MPEG1，[1] MPEG2/2.5
+static const int kBitrateTable[2][15] = {
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+};
+static const int kSampleRateTable[3] = {44100, 48000, 32000};
+
+static uint32_t ReadBigEndian(const uint8_t* data, int bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+bool Mp3SeekIndex::Build(const uint8_t* frame, size_t size, size_t frame_offset, size_t file_length) {
+    Clear();
+    if (size < 4 || frame[0] != 0xFF || (frame[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+
+    // 解析帧头：版本、层、码率、采样率、声道模式
+    int version = (frame[1] >> 3) & 0x03;   // 3=MPEG1, 2=MPEG2, 0=MPEG2.5
+    int layer = (frame[1] >> 1) & 0x03;     // 1=Layer III
+    int bitrate_index = frame[2] >> 4;
+    int sample_rate_index = (frame[2] >> 2) & 0x03;
+    bool mono = (frame[3] >> 6) == 3;
+    if (version == 1 || layer != 1 || bitrate_index == 0 || bitrate_index == 15 || sample_rate_index == 3) {
+        return false;
+    }
+
+    bool mpeg1 = version == 3;
+    int sample_rate = kSampleRateTable[sample_rate_index] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+    int samples_per_frame = mpeg1 ? 1152 : 576;
+    int bitrate_kbps = kBitrateTable[mpeg1 ? 0 : 1][bitrate_index];
+
+    first_frame_offset_ = frame_offset;
+    if (file_length > frame_offset) {
+        audio_bytes_ = file_length - frame_offset;
+    }
+
+    // Xing/Info 头位于边信息之后
+    size_t xing_offset = 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+    if (size >= xing_offset + 8 &&
+        (memcmp(frame + xing_offset, "Xing", 4) == 0 || memcmp(frame + xing_offset, "Info", 4) == 0)) {
+        const uint8_t* p = frame + xing_offset + 4;
+        const uint8_t* end = frame + size;
+        uint32_t flags = ReadBigEndian(p, 4);
+        p += 4;
+        uint32_t frames = 0;
+        if ((flags & 0x01) && p + 4 <= end) {
+            frames = ReadBigEndian(p, 4);
+            p += 4;
+        }
+        if ((flags & 0x02) && p + 4 <= end) {
+            uint32_t bytes = ReadBigEndian(p, 4);
+            if (bytes > 0) {
+                audio_bytes_ = bytes;
+            }
+            p += 4;
+        }
+        if ((flags & 0x04) && p + 100 <= end) {
+            memcpy(xing_toc_, p, 100);
+            has_xing_toc_ = true;
+        }
+        if (frames > 0) {
+            duration_ms_ = (int64_t)frames * samples_per_frame * 1000 / sample_rate;
+            type_ = kTypeXing;
+            return true;
+        }
+    }
+
+    // VBRI 头固定位于帧头之后32字节
+    const size_t vbri_offset = 4 + 32;
+    if (size >= vbri_offset + 26 && memcmp(frame + vbri_offset, "VBRI", 4) == 0) {
+        const uint8_t* p = frame + vbri_offset;
+        uint32_t bytes = ReadBigEndian(p + 10, 4);
+        uint32_t frames = ReadBigEndian(p + 14, 4);
+        int entries = ReadBigEndian(p + 18, 2);
+        int scale = ReadBigEndian(p + 20, 2);
+        int entry_size = ReadBigEndian(p + 22, 2);
+        int frames_per_entry = ReadBigEndian(p + 24, 2);
+        if (frames > 0 && entry_size >= 1 && entry_size <= 4 &&
+            size >= vbri_offset + 26 + (size_t)entries * entry_size) {
+            if (bytes > 0) {
+                audio_bytes_ = bytes;
+            }
+            duration_ms_ = (int64_t)frames * samples_per_frame * 1000 / sample_rate;
+            vbri_entry_ms_ = (int64_t)frames_per_entry * samples_per_frame * 1000 / sample_rate;
+            // 把每段的长度累加为相对第一帧的偏移
+            uint32_t offset = 0;
+            vbri_offsets_.reserve(entries + 1);
+            vbri_offsets_.push_back(0);
+            for (int i = 0; i < entries; i++) {
+                offset += ReadBigEndian(p + 26 + i * entry_size, entry_size) * scale;
+                vbri_offsets_.push_back(offset);
+            }
+            type_ = kTypeVbri;
+            return true;
+        }
+    }
+
+    // 按 CBR 处理
+    bitrate_kbps_ = bitrate_kbps;
+    if (audio_bytes_ > 0) {
+        duration_ms_ = (int64_t)audio_bytes_ * 8 / bitrate_kbps_;
+    }
+    type_ = kTypeCbr;
+    return true;
+}
+
+void Mp3SeekIndex::Clear() {
+    type_ = kTypeNone;
+    first_frame_offset_ = 0;
+    audio_bytes_ = 0;
+    duration_ms_ = 0;
+    bitrate_kbps_ = 0;
+    has_xing_toc_ = false;
+    vbri_offsets_.clear();
+    vbri_entry_ms_ = 0;
+}
+
+size_t Mp3SeekIndex::GetByteOffset(int64_t position_ms) const {
+    if (type_ == kTypeNone || position_ms <= 0) {
+        return first_frame_offset_;
+    }
+    if (duration_ms_ > 0) {
+        position_ms = std::min(position_ms, duration_ms_);
+    }
+
+    size_t offset = 0;
+    switch (type_) {
+    case kTypeCbr:
+        offset = (size_t)(position_ms * bitrate_kbps_ / 8);
+        break;
+    case kTypeXing:
+        if (has_xing_toc_ && audio_bytes_ > 0) {
+            // TOC[i] 是第 i% 时长处的字节位置（以总字节数的1/256为单位），在相邻两项之间线性插值
+            double percent = 100.0 * position_ms / duration_ms_;
+            int index = std::min(99, (int)percent);
+            double a = xing_toc_[index];
+            double b = index < 99 ? xing_toc_[index + 1] : 256.0;
+            double fraction = a + (b - a) * (percent - index);
+            offset = (size_t)(fraction / 256.0 * audio_bytes_);
+        } else if (audio_bytes_ > 0) {
+            offset = (size_t)((double)position_ms / duration_ms_ * audio_bytes_);
+        }
+        break;
+    case kTypeVbri: {
+        size_t index = vbri_entry_ms_ > 0 ? (size_t)(position_ms / vbri_entry_ms_) : 0;
+        if (index + 1 >= vbri_offsets_.size()) {
+            offset = vbri_offsets_.back();
+        } else {
+            int64_t within = position_ms - (int64_t)index * vbri_entry_ms_;
+            offset = vbri_offsets_[index] +
+                     (size_t)((int64_t)(vbri_offsets_[index + 1] - vbri_offsets_[index]) * within / vbri_entry_ms_);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    if (audio_bytes_ > 0) {
+        offset = std::min(offset, audio_bytes_);
+    }
+    return first_frame_offset_ + offset;
+}
+
+const char* Mp3SeekIndex::type_name() const {
+    switch (type_) {
+    case kTypeCbr:
+        return "CBR";
+    case kTypeXing:
+        return "Xing";
+    case kTypeVbri:
+        return "VBRI";
+    default:
+        return "none";
+    }
+}
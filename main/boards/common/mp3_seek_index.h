@@ -0,0 +1,51 @@
+#ifndef MP3_SEEK_INDEX_H
+#define MP3_SEEK_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * MP3 时间 -> 字节偏移索引，由第一帧建立：
+ *
+ * - Xing/Info 头（LAME 等编码器写入）：总帧数、总字节数和100项百分比 TOC
+ * - VBRI 头（Fraunhofer 编码器写入）：总帧数、总字节数和按帧数分段的 TOC
+ * - 都没有时按第一帧的码率当作 CBR 计算
+ *
+ * 所有偏移都是源文件中的绝对偏移（包含 ID3 标签），可直接用于 HTTP Range 请求。
+ */
+class Mp3SeekIndex {
+public:
+    enum Type {
+        kTypeNone = 0,
+        kTypeCbr,
+        kTypeXing,
+        kTypeVbri,
+    };
+
+    // frame 指向第一帧帧头，frame_offset 为该帧在文件中的偏移，file_length 为文件总长度（未知为0）
+    bool Build(const uint8_t* frame, size_t size, size_t frame_offset, size_t file_length);
+    void Clear();
+
+    // 返回 position_ms 所在帧附近的文件偏移，解码器会从该处重新同步
+    size_t GetByteOffset(int64_t position_ms) const;
+    // 总时长（毫秒），无法确定时返回0
+    int64_t GetDurationMs() const { return duration_ms_; }
+
+    inline bool valid() const { return type_ != kTypeNone; }
+    inline Type type() const { return type_; }
+    const char* type_name() const;
+
+private:
+    Type type_ = kTypeNone;
+    size_t first_frame_offset_ = 0;
+    size_t audio_bytes_ = 0;      // 从第一帧开始的音频数据长度，0 表示未知
+    int64_t duration_ms_ = 0;
+    int bitrate_kbps_ = 0;        // CBR 时使用
+    uint8_t xing_toc_[100] = {};
+    bool has_xing_toc_ = false;
+    std::vector<uint32_t> vbri_offsets_;  // 每个 VBRI 分段起点相对第一帧的偏移
+    int64_t vbri_entry_ms_ = 0;           // 每个 VBRI 分段的时长
+};
+
+#endif // MP3_SEEK_INDEX_H
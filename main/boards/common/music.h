@@ -2,20 +2,59 @@
 #define MUSIC_H
 
 #include <string>
+#include <vector>
+
+struct cJSON;
+
+struct MusicTrack {
+    std::string song_name;
+    std::string artist_name;
+};
 
 class Music {
 public:
+    // 播放时显示频谱还是歌词
+    enum DisplayMode {
+        DISPLAY_MODE_SPECTRUM = 0,  // 默认显示频谱
+        DISPLAY_MODE_LYRICS = 1     // 显示歌词
+    };
+
     virtual ~Music() = default;  // 添加虚析构函数
     
     virtual bool Download(const std::string& song_name, const std::string& artist_name = "") = 0;
     virtual std::string GetDownloadResult() = 0;
+    // 播放网络电台：Shoutcast/Icecast 直播流（MP3/AAC）或 HLS .m3u8 播放列表，打断当前播放
+    virtual bool PlayRadio(const std::string& url, const std::string& name = "") = 0;
     
     // 新增流式播放相关方法
     virtual bool StartStreaming(const std::string& music_url) = 0;
     virtual bool StopStreaming() = 0;  // 停止流式播放
+    // 暂停时保留已缓冲的数据和下载连接，恢复后从暂停处继续，不需要重新缓冲
+    virtual bool Pause() = 0;
+    virtual bool Resume() = 0;
+    virtual bool IsPaused() const = 0;
     virtual size_t GetBufferSize() const = 0;
     virtual bool IsDownloading() const = 0;
     virtual int16_t* GetAudioData() = 0;
+
+    // 播放队列：当前曲目下载完成后会预取下一首，实现无缝切歌
+    virtual bool Enqueue(const std::string& song_name, const std::string& artist_name = "") = 0;
+    virtual bool Next() = 0;
+    virtual bool Previous() = 0;
+    virtual void Clear() = 0;  // 清空播放队列，不打断当前歌曲
+    virtual std::vector<MusicTrack> GetQueue() const = 0;
+    virtual int GetQueueIndex() const = 0;  // 当前曲目在队列中的位置，-1表示没有
+
+    // 播放位置（毫秒），总时长未知时 GetDuration() 返回0
+    virtual bool Seek(int64_t position_ms) = 0;
+    virtual int64_t GetDuration() const = 0;
+    virtual int64_t GetPosition() const = 0;
+
+    // 播放统计JSON（调用方释放，失败时返回nullptr），detailed 为false时只包含设备状态需要的概要
+    virtual cJSON* GetStatsJson(bool detailed) const = 0;
+
+    virtual void SetDisplayMode(DisplayMode mode) = 0;
+    virtual DisplayMode GetDisplayMode() const = 0;
 };
 
 #endif // MUSIC_H 
\ No newline at end of file
@@ -0,0 +1,451 @@
+#include "music_cache.h"
+
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <esp_vfs_fat.h>
+#include <mbedtls/sha256.h>
+#include <cJSON.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#define TAG "MusicCache"
+
+#define MUSIC_CACHE_PARTITION   "music"
+#define MUSIC_CACHE_BASE_PATH   "/music"
+#define MUSIC_CACHE_INDEX_PATH  MUSIC_CACHE_BASE_PATH "/cache/index.jsn"
+
+#ifndef CONFIG_MUSIC_CACHE_MAX_SIZE_KB
+#define CONFIG_MUSIC_CACHE_MAX_SIZE_KB 0
+#endif
+
+// 文件名只取键的前8个字符，兼容FAT短文件名
+static const size_t kFileNameLength = 8;
+
+std::string MusicCache::Normalize(const std::string& text) {
+    std::string result;
+    bool pending_space = false;
+    for (unsigned char c : text) {
+        if (std::isspace(c)) {
+            pending_space = !result.empty();
+            continue;
+        }
+        if (pending_space) {
+            result += ' ';
+            pending_space = false;
+        }
+        result += (char)std::tolower(c);
+    }
+    return result;
+}
+
+static size_t GetFileSize(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return 0;
+    }
+    return st.st_size;
+}
+
+static bool WriteFile(const std::string& path, const std::string& content) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = fwrite(content.data(), 1, content.size(), file) == content.size();
+    fclose(file);
+    if (!ok) {
+        unlink(path.c_str());
+    }
+    return ok;
+}
+
+static bool ReadFile(const std::string& path, std::string* content) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    content->clear();
+    char buffer[512];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content->append(buffer, n);
+    }
+    fclose(file);
+    return true;
+}
+
+MusicCache::MusicCache() {
+}
+
+MusicCache::~MusicCache() {
+    AbortAudio();
+    if (mounted_) {
+        if (lru_dirty_) {
+            SaveIndex();
+        }
+        esp_vfs_fat_spiflash_unmount_rw_wl(MUSIC_CACHE_BASE_PATH, wl_handle_);
+        mounted_ = false;
+    }
+}
+
+bool MusicCache::Initialize() {
+#if CONFIG_USE_MUSIC_CACHE
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mounted_) {
+        return true;
+    }
+
+    auto partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT,
+                                              MUSIC_CACHE_PARTITION);
+    if (partition == nullptr) {
+        ESP_LOGI(TAG, "No '%s' partition, music cache disabled", MUSIC_CACHE_PARTITION);
+        return false;
+    }
+
+    esp_vfs_fat_mount_config_t mount_config = {};
+    mount_config.max_files = 4;
+    mount_config.format_if_mount_failed = true;
+    mount_config.allocation_unit_size = CONFIG_WL_SECTOR_SIZE;
+    esp_err_t ret = esp_vfs_fat_spiflash_mount_rw_wl(MUSIC_CACHE_BASE_PATH, MUSIC_CACHE_PARTITION,
+                                                     &mount_config, &wl_handle_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to mount music cache partition: %s", esp_err_to_name(ret));
+        return false;
+    }
+    mounted_ = true;
+
+    // 预算不能超过分区大小（留出FAT和磨损均衡的开销）
+    budget_bytes_ = std::min<size_t>(CONFIG_MUSIC_CACHE_MAX_SIZE_KB * 1024, partition->size * 7 / 8);
+
+    if (mkdir(kDirectory, 0755) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "Failed to create %s: %s", kDirectory, strerror(errno));
+        esp_vfs_fat_spiflash_unmount_rw_wl(MUSIC_CACHE_BASE_PATH, wl_handle_);
+        mounted_ = false;
+        return false;
+    }
+    LoadIndex();
+    RemoveOrphanFiles();
+    EvictFor(0);
+    ESP_LOGI(TAG, "Music cache mounted: %u entries, %u/%u bytes", (unsigned int)entries_.size(),
+             (unsigned int)used_bytes_, (unsigned int)budget_bytes_);
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string MusicCache::MakeKey(const std::string& song_name, const std::string& artist_name) {
+    std::string input = Normalize(song_name) + "\x1f" + Normalize(artist_name);
+    unsigned char hash[32];
+    mbedtls_sha256((const unsigned char*)input.data(), input.size(), hash, 0);
+
+    static const char hex[] = "0123456789abcdef";
+    std::string key;
+    key.reserve(64);
+    for (unsigned char byte : hash) {
+        key += hex[byte >> 4];
+        key += hex[byte & 0x0F];
+    }
+    return key;
+}
+
+std::string MusicCache::GetPath(const std::string& key, const char* extension) const {
+    return std::string(kDirectory) + "/" + key.substr(0, kFileNameLength) + extension;
+}
+
+std::string MusicCache::GetAudioPath(const std::string& key) const {
+    return GetPath(key, ".mp3");
+}
+
+std::string MusicCache::GetLyricPath(const std::string& key) const {
+    return GetPath(key, ".lrc");
+}
+
+int MusicCache::FindEntry(const std::string& key) const {
+    for (size_t i = 0; i < entries_.size(); i++) {
+        if (entries_[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool MusicCache::Lookup(const std::string& key, Entry* entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!mounted_) {
+        return false;
+    }
+    int index = FindEntry(key);
+    if (index < 0) {
+        return false;
+    }
+    // 文件可能在断电时损坏或丢失
+    if (GetFileSize(GetAudioPath(key)) == 0) {
+        ESP_LOGW(TAG, "Cached audio missing for %s, dropping entry", entries_[index].song_name.c_str());
+        RemoveEntry(index);
+        SaveIndex();
+        return false;
+    }
+    // 命中只更新内存中的LRU顺序，等缓存内容变化（提交、淘汰、删除）时随索引一起写回，避免每次播放都写闪存
+    entries_[index].last_used = ++use_counter_;
+    lru_dirty_ = true;
+    *entry = entries_[index];
+    return true;
+}
+
+bool MusicCache::ReadMetadata(const std::string& key, std::string* metadata) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mounted_ && ReadFile(GetPath(key, ".jsn"), metadata);
+}
+
+bool MusicCache::BeginAudio(const std::string& key, size_t expected_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!mounted_ || writer_file_ != nullptr) {
+        return false;
+    }
+    if (expected_size > budget_bytes_) {
+        ESP_LOGI(TAG, "Track too large to cache: %u bytes", (unsigned int)expected_size);
+        return false;
+    }
+
+    // 同名文件（同一首歌或者前缀冲突的另一首）先移出索引
+    for (int i = entries_.size() - 1; i >= 0; i--) {
+        if (entries_[i].key.compare(0, kFileNameLength, key, 0, kFileNameLength) == 0) {
+            RemoveEntry(i);
+        }
+    }
+    EvictFor(expected_size);
+    SaveIndex();
+
+    writer_file_ = fopen(GetPath(key, ".tmp").c_str(), "wb");
+    if (writer_file_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create cache file for %s", key.c_str());
+        return false;
+    }
+    writer_key_ = key;
+    writer_size_ = 0;
+    return true;
+}
+
+bool MusicCache::AppendAudio(const void* data, size_t size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (writer_file_ == nullptr) {
+        return false;
+    }
+    if (used_bytes_ + writer_size_ + size > budget_bytes_ && !EvictFor(writer_size_ + size)) {
+        ESP_LOGW(TAG, "Cache budget exceeded, stop caching current track");
+        lock.unlock();
+        AbortAudio();
+        return false;
+    }
+    if (fwrite(data, 1, size, writer_file_) != size) {
+        ESP_LOGE(TAG, "Failed to write cache file, stop caching current track");
+        lock.unlock();
+        AbortAudio();
+        return false;
+    }
+    writer_size_ += size;
+    return true;
+}
+
+bool MusicCache::CommitAudio(const std::string& song_name, const std::string& artist_name, const std::string& metadata) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (writer_file_ == nullptr) {
+        return false;
+    }
+    fclose(writer_file_);
+    writer_file_ = nullptr;
+
+    std::string key = writer_key_;
+    std::string audio_path = GetAudioPath(key);
+    unlink(audio_path.c_str());
+    if (rename(GetPath(key, ".tmp").c_str(), audio_path.c_str()) != 0) {
+        ESP_LOGE(TAG, "Failed to commit cache file for %s", song_name.c_str());
+        unlink(GetPath(key, ".tmp").c_str());
+        return false;
+    }
+    WriteFile(GetPath(key, ".jsn"), metadata);
+
+    Entry entry;
+    entry.key = key;
+    entry.song_name = song_name;
+    entry.artist_name = artist_name;
+    size_t lyric_size = GetFileSize(GetLyricPath(key));
+    entry.has_lyrics = lyric_size > 0;
+    entry.size = writer_size_ + lyric_size + metadata.size();
+    entry.last_used = ++use_counter_;
+    writer_key_.clear();
+    writer_size_ = 0;
+
+    EvictFor(entry.size);
+    entries_.push_back(entry);
+    used_bytes_ += entry.size;
+    SaveIndex();
+    ESP_LOGI(TAG, "Cached %s (%u bytes), total %u/%u bytes", song_name.c_str(), (unsigned int)entry.size,
+             (unsigned int)used_bytes_, (unsigned int)budget_bytes_);
+    return true;
+}
+
+void MusicCache::AbortAudio() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (writer_file_ == nullptr) {
+        return;
+    }
+    fclose(writer_file_);
+    writer_file_ = nullptr;
+    unlink(GetPath(writer_key_, ".tmp").c_str());
+    // 先于音频写入的歌词不再有对应的条目
+    if (FindEntry(writer_key_) < 0) {
+        unlink(GetLyricPath(writer_key_).c_str());
+    }
+    writer_key_.clear();
+    writer_size_ = 0;
+}
+
+bool MusicCache::StoreLyrics(const std::string& key, const std::string& content) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!mounted_ || content.empty()) {
+        return false;
+    }
+    int index = FindEntry(key);
+    // 既没有条目也不在写入中的歌曲不缓存歌词（比如从中间开始播放、超出预算）
+    if (index < 0 && key != writer_key_) {
+        return false;
+    }
+    if (!WriteFile(GetLyricPath(key), content)) {
+        return false;
+    }
+    if (index >= 0 && !entries_[index].has_lyrics) {
+        entries_[index].has_lyrics = true;
+        entries_[index].size += content.size();
+        used_bytes_ += content.size();
+        SaveIndex();
+    }
+    return true;
+}
+
+void MusicCache::RemoveEntry(int index) {
+    const std::string& key = entries_[index].key;
+    unlink(GetAudioPath(key).c_str());
+    unlink(GetLyricPath(key).c_str());
+    unlink(GetPath(key, ".jsn").c_str());
+    used_bytes_ -= std::min(used_bytes_, entries_[index].size);
+    entries_.erase(entries_.begin() + index);
+}
+
+// 淘汰最久未使用的条目，直到能再放下 bytes 字节（包括写入中的数据）
+bool MusicCache::EvictFor(size_t bytes) {
+    bool evicted = false;
+    while (!entries_.empty() && used_bytes_ + bytes > budget_bytes_) {
+        auto oldest = std::min_element(entries_.begin(), entries_.end(),
+            [](const Entry& a, const Entry& b) { return a.last_used < b.last_used; });
+        ESP_LOGI(TAG, "Evicting %s (%u bytes)", oldest->song_name.c_str(), (unsigned int)oldest->size);
+        RemoveEntry(oldest - entries_.begin());
+        evicted = true;
+    }
+    if (evicted) {
+        SaveIndex();
+    }
+    return used_bytes_ + bytes <= budget_bytes_;
+}
+
+void MusicCache::LoadIndex() {
+    entries_.clear();
+    used_bytes_ = 0;
+    use_counter_ = 0;
+
+    std::string content;
+    if (!ReadFile(MUSIC_CACHE_INDEX_PATH, &content)) {
+        return;
+    }
+    cJSON* root = cJSON_Parse(content.c_str());
+    if (!cJSON_IsArray(root)) {
+        ESP_LOGW(TAG, "Invalid cache index, starting empty");
+        cJSON_Delete(root);
+        return;
+    }
+    cJSON* item;
+    cJSON_ArrayForEach(item, root) {
+        cJSON* key = cJSON_GetObjectItem(item, "key");
+        cJSON* song = cJSON_GetObjectItem(item, "song");
+        cJSON* artist = cJSON_GetObjectItem(item, "artist");
+        cJSON* size = cJSON_GetObjectItem(item, "size");
+        cJSON* lyrics = cJSON_GetObjectItem(item, "lyrics");
+        cJSON* used = cJSON_GetObjectItem(item, "used");
+        if (!cJSON_IsString(key) || !cJSON_IsNumber(size)) {
+            continue;
+        }
+        Entry entry;
+        entry.key = key->valuestring;
+        entry.song_name = cJSON_IsString(song) ? song->valuestring : "";
+        entry.artist_name = cJSON_IsString(artist) ? artist->valuestring : "";
+        entry.size = size->valueint;
+        entry.has_lyrics = cJSON_IsTrue(lyrics);
+        entry.last_used = cJSON_IsNumber(used) ? (uint32_t)used->valuedouble : 0;
+        use_counter_ = std::max(use_counter_, entry.last_used);
+        used_bytes_ += entry.size;
+        entries_.push_back(entry);
+    }
+    cJSON_Delete(root);
+}
+
+void MusicCache::SaveIndex() {
+    lru_dirty_ = false;
+    cJSON* root = cJSON_CreateArray();
+    for (const auto& entry : entries_) {
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "key", entry.key.c_str());
+        cJSON_AddStringToObject(item, "song", entry.song_name.c_str());
+        cJSON_AddStringToObject(item, "artist", entry.artist_name.c_str());
+        cJSON_AddNumberToObject(item, "size", entry.size);
+        cJSON_AddBoolToObject(item, "lyrics", entry.has_lyrics);
+        cJSON_AddNumberToObject(item, "used", entry.last_used);
+        cJSON_AddItemToArray(root, item);
+    }
+    char* json = cJSON_PrintUnformatted(root);
+    // 先写临时文件再替换，断电时最多丢失最近一次修改
+    std::string temp_path = std::string(kDirectory) + "/index.tmp";
+    if (WriteFile(temp_path, json)) {
+        unlink(MUSIC_CACHE_INDEX_PATH);
+        rename(temp_path.c_str(), MUSIC_CACHE_INDEX_PATH);
+    }
+    cJSON_free(json);
+    cJSON_Delete(root);
+}
+
+// 删除缓存目录中不属于任何条目的文件（断电时未提交的临时文件、被淘汰但没删掉的文件）
+void MusicCache::RemoveOrphanFiles() {
+    DIR* dir = opendir(kDirectory);
+    if (dir == nullptr) {
+        return;
+    }
+    std::vector<std::string> orphans;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != nullptr) {
+        std::string name = ent->d_name;
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name == "index.jsn" || name[0] == '.') {
+            continue;
+        }
+        bool owned = false;
+        for (const auto& entry : entries_) {
+            if (name.compare(0, kFileNameLength, entry.key, 0, kFileNameLength) == 0) {
+                owned = true;
+                break;
+            }
+        }
+        if (!owned) {
+            orphans.push_back(std::string(kDirectory) + "/" + ent->d_name);
+        }
+    }
+    closedir(dir);
+    for (const auto& path : orphans) {
+        ESP_LOGI(TAG, "Removing orphan cache file %s", path.c_str());
+        unlink(path.c_str());
+    }
+}
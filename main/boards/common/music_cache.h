@@ -0,0 +1,93 @@
+#ifndef MUSIC_CACHE_H
+#define MUSIC_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <wear_levelling.h>
+
+/*
+ * 歌曲缓存：把播放过的歌曲保存在 music 数据分区（FAT + 磨损均衡）上，重复播放时不访问网络。
+ *
+ * - 以规范化后的歌名和歌手的 SHA-256 作为键，每首歌保存音频、歌词和元数据（接口返回的JSON）三个文件
+ * - 总占用超过 CONFIG_MUSIC_CACHE_MAX_SIZE_KB 时按最近最少使用（LRU）淘汰
+ * - 音频在下载线程中边下载边写入临时文件，完整下载后才提交到索引，中途停止的下载不会留下半首歌
+ *
+ * 所有文件都在分区的 cache 子目录（kDirectory）中，启动时只清理该目录，分区的其他位置可以放别的文件。
+ * 分区表中没有 music 分区或者未启用 CONFIG_USE_MUSIC_CACHE 时，所有操作都是空操作。
+ */
+class MusicCache {
+public:
+    struct Entry {
+        std::string key;          // SHA-256 十六进制字符串
+        std::string song_name;
+        std::string artist_name;
+        size_t size = 0;          // 音频、歌词和元数据的总字节数
+        bool has_lyrics = false;
+        uint32_t last_used = 0;   // LRU 计数，越大越新
+    };
+
+    MusicCache();
+    ~MusicCache();
+
+    MusicCache(const MusicCache&) = delete;
+    MusicCache& operator=(const MusicCache&) = delete;
+
+    // 8.3短文件名，不依赖FAT长文件名支持
+    static constexpr const char kDirectory[] = "/music/cache";
+
+    // 挂载分区并加载索引
+    bool Initialize();
+    inline bool enabled() const { return mounted_; }
+
+    static std::string MakeKey(const std::string& song_name, const std::string& artist_name);
+    // 去掉首尾空白、合并连续空白、ASCII转小写，使"Song  A"和"song a"视为同一首歌
+    static std::string Normalize(const std::string& text);
+
+    // 命中时更新LRU顺序
+    bool Lookup(const std::string& key, Entry* entry);
+    std::string GetAudioPath(const std::string& key) const;
+    std::string GetLyricPath(const std::string& key) const;
+    bool ReadMetadata(const std::string& key, std::string* metadata);
+
+    // 边下载边写入（同一时间只有一个写入者）：BeginAudio -> AppendAudio... -> CommitAudio 或 AbortAudio
+    bool BeginAudio(const std::string& key, size_t expected_size);
+    bool AppendAudio(const void* data, size_t size);
+    bool CommitAudio(const std::string& song_name, const std::string& artist_name, const std::string& metadata);
+    void AbortAudio();
+
+    // 歌词可能先于音频下载完成，先写文件，音频提交时再计入条目
+    bool StoreLyrics(const std::string& key, const std::string& content);
+
+    size_t used_bytes() const { return used_bytes_; }
+    size_t budget_bytes() const { return budget_bytes_; }
+
+private:
+    std::mutex mutex_;
+    bool mounted_ = false;
+    wl_handle_t wl_handle_ = WL_INVALID_HANDLE;
+    size_t budget_bytes_ = 0;
+    size_t used_bytes_ = 0;
+    uint32_t use_counter_ = 0;
+    bool lru_dirty_ = false;  // 内存中的LRU顺序比索引文件新
+    std::vector<Entry> entries_;
+
+    // 写入中的音频
+    FILE* writer_file_ = nullptr;
+    std::string writer_key_;
+    size_t writer_size_ = 0;
+
+    std::string GetPath(const std::string& key, const char* extension) const;
+    int FindEntry(const std::string& key) const;
+    void RemoveEntry(int index);
+    bool EvictFor(size_t bytes);
+    void LoadIndex();
+    void SaveIndex();
+    void RemoveOrphanFiles();
+};
+
+#endif // MUSIC_CACHE_H
@@ -0,0 +1,47 @@
+#include "music_cancel_token.h"
+
+#include <chrono>
+
+void MusicCancelToken::Cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cancelled_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    for (auto& callback : callbacks_) {
+        callback.second();
+    }
+    callbacks_.clear();
+    cv_.notify_all();
+}
+
+int MusicCancelToken::Register(std::function<void()> callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!cancelled_.load(std::memory_order_relaxed)) {
+            int id = next_id_++;
+            callbacks_.emplace_back(id, std::move(callback));
+            return id;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void MusicCancelToken::Unregister(int id) {
+    if (id == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = callbacks_.begin(); it != callbacks_.end(); ++it) {
+        if (it->first == id) {
+            callbacks_.erase(it);
+            break;
+        }
+    }
+}
+
+bool MusicCancelToken::WaitFor(int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return !cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                         [this] { return cancelled_.load(std::memory_order_relaxed); });
+}
@@ -0,0 +1,47 @@
+#ifndef MUSIC_CANCEL_TOKEN_H
+#define MUSIC_CANCEL_TOKEN_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*
+ * 协作式取消令牌，一次播放的下载、播放和歌词线程共用同一个令牌：
+ *
+ * - Cancel() 置位取消标志，并执行已注册的回调，例如中断阻塞在网络读取上的连接
+ * - 线程在循环中检查 cancelled()，需要等待时用 WaitFor() 代替 sleep，取消时立即返回
+ *
+ * 这样停止播放时所有等待者都会被立即唤醒，调用方可以直接 join() 线程，不需要轮询等待或 detach()。
+ * 令牌在每次开始播放时新建（由 shared_ptr 共享），已取消的令牌不会被重置。
+ *
+ * 回调在持有令牌内部锁时执行，回调中不能注册或注销回调。
+ */
+class MusicCancelToken {
+public:
+    MusicCancelToken() = default;
+    MusicCancelToken(const MusicCancelToken&) = delete;
+    MusicCancelToken& operator=(const MusicCancelToken&) = delete;
+
+    void Cancel();
+    bool cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+    // 注册取消时执行的回调，返回注销用的id；令牌已取消时在当前线程立即执行回调并返回0
+    int Register(std::function<void()> callback);
+    // 注销回调，返回后保证回调不会再执行，也不在执行中
+    void Unregister(int id);
+
+    // 最多等待 timeout_ms 毫秒，被取消时立即返回false
+    bool WaitFor(int timeout_ms);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::atomic<bool> cancelled_{false};
+    std::vector<std::pair<int, std::function<void()>>> callbacks_;
+    int next_id_ = 1;
+};
+
+#endif // MUSIC_CANCEL_TOKEN_H
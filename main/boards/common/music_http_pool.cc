@@ -0,0 +1,752 @@
+#include "music_http_pool.h"
+#include "music_cancel_token.h"
+#include "board.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <tcp.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#define TAG "MusicHttpPool"
+
+// 接收回调的流量控制：未读数据达到 kMaxPendingBytes 后，每收到一块数据最多等待 kMaxReceiveBlockMs
+// 让读取方取走数据。接收任务因此被拖慢，网络栈/模组的接收窗口随之收紧，服务器放慢发送；
+// 等待有上限，读取方长时间不读（暂停播放）时不会一直占住接收任务，超时后继续缓存，
+// 只有未读数据超过 kMaxStalledBytes 才丢弃后续数据并标记连接溢出（最后的手段，读完缓存后返回错误）
+static const size_t kMaxPendingBytes = 32 * 1024;
+static const size_t kMaxStalledBytes = 128 * 1024;
+static const int kMaxReceiveBlockMs = 200;
+// 最多跟随的重定向次数
+static const int kMaxRedirects = 5;
+// 响应头的最大长度
+static const size_t kMaxHeaderBytes = 8 * 1024;
+// 关闭时为了复用连接最多读掉的剩余响应体
+static const size_t kMaxDrainBytes = 4 * 1024;
+static const int kDefaultTimeoutMs = 10000;
+
+struct MusicHttpConnection {
+    int id = 0;
+    bool ssl = false;
+    std::string host;
+    int port = 0;
+    std::unique_ptr<Tcp> tcp;
+    int64_t last_used_us = 0;
+    int requests = 0;
+
+    // 以下由 mutex 保护，接收任务写入，请求线程读取
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string pending;        // 已收到的数据，pending_offset 之前的部分已被读取
+    size_t pending_offset = 0;
+    bool disconnected = false;
+    bool discarding = false;    // 连接即将销毁，接收任务丢弃后续数据
+    bool aborted = false;       // 请求被取消，读取立即失败，连接不再复用
+    bool overflowed = false;    // 未读数据超过 kMaxStalledBytes，后续数据已丢弃，连接不再复用
+
+    bool Matches(bool ssl, const std::string& host, int port) const {
+        return this->ssl == ssl && this->port == port && this->host == host;
+    }
+
+    // 空闲连接可以复用的条件：仍然连接、没有多余数据、空闲时间不长
+    bool Reusable() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !disconnected && !aborted && !overflowed && Unread() == 0 && tcp->connected() &&
+               esp_timer_get_time() - last_used_us < MusicHttpPool::kMaxIdleMs * 1000LL;
+    }
+
+    // 以下三个函数需要持有 mutex
+    size_t Unread() const { return pending.size() - pending_offset; }
+
+    // 读取只移动偏移，不搬移剩余数据；追加前已读部分超过一半时才整理一次
+    void Append(const std::string& data) {
+        if (pending_offset > 0 && pending_offset * 2 >= pending.size()) {
+            pending.erase(0, pending_offset);
+            pending_offset = 0;
+        }
+        pending.append(data);
+    }
+
+    void Consume(size_t size) {
+        pending_offset += size;
+        if (pending_offset == pending.size()) {
+            pending.clear();
+            pending_offset = 0;
+        }
+    }
+
+    ~MusicHttpConnection() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            discarding = true;
+        }
+        cv.notify_all();
+        if (tcp) {
+            tcp->Disconnect();
+        }
+    }
+};
+
+// 解析 http(s)://host[:port][/path]
+static bool ParseUrl(const std::string& url, bool* ssl, std::string* host, int* port, std::string* path) {
+    size_t host_start;
+    if (url.compare(0, 7, "http://") == 0) {
+        *ssl = false;
+        *port = 80;
+        host_start = 7;
+    } else if (url.compare(0, 8, "https://") == 0) {
+        *ssl = true;
+        *port = 443;
+        host_start = 8;
+    } else {
+        return false;
+    }
+
+    size_t path_start = url.find_first_of("/?", host_start);
+    std::string authority = url.substr(host_start, path_start == std::string::npos ? std::string::npos
+                                                                                   : path_start - host_start);
+    size_t colon = authority.rfind(':');
+    if (colon != std::string::npos) {
+        *port = atoi(authority.c_str() + colon + 1);
+        authority.resize(colon);
+    }
+    if (authority.empty() || *port <= 0) {
+        return false;
+    }
+    *host = authority;
+
+    if (path_start == std::string::npos) {
+        *path = "/";
+    } else if (url[path_start] == '?') {
+        *path = "/" + url.substr(path_start);
+    } else {
+        *path = url.substr(path_start);
+    }
+    return true;
+}
+
+// 把重定向的 Location 解析为完整URL：完整URL、//host/path、/path 或相对于当前目录的路径
+static std::string ResolveLocation(const std::string& base, const std::string& location) {
+    if (location.find("://") != std::string::npos) {
+        return location;
+    }
+    size_t scheme_end = base.find("://");
+    if (scheme_end == std::string::npos) {
+        return location;
+    }
+    if (location.compare(0, 2, "//") == 0) {
+        return base.substr(0, scheme_end + 1) + location;
+    }
+    size_t path_start = base.find_first_of("/?", scheme_end + 3);
+    std::string origin = base.substr(0, path_start);
+    if (!location.empty() && location[0] == '/') {
+        return origin + location;
+    }
+    std::string path = "/";
+    if (path_start != std::string::npos && base[path_start] == '/') {
+        path = base.substr(path_start, base.find('?', path_start) - path_start);
+    }
+    return origin + path.substr(0, path.rfind('/') + 1) + location;
+}
+
+static std::string ToLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+static std::string Trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+/*
+ * 基于 Tcp 的 HTTP/1.1 客户端，支持 Content-Length、chunked 和读到连接关闭三种响应体
+ */
+class PooledHttp : public Http {
+public:
+    PooledHttp(MusicHttpPool* pool, MusicCancelToken* cancel);
+    ~PooledHttp() override;
+
+    void SetTimeout(int timeout_ms) override { timeout_ms_ = timeout_ms; }
+    void SetHeader(const std::string& key, const std::string& value) override { headers_[key] = value; }
+    void SetContent(std::string&& content) override { content_ = std::move(content); }
+    bool Open(const std::string& method, const std::string& url) override;
+    void Close() override;
+    int Read(char* buffer, size_t buffer_size) override;
+    int Write(const char* buffer, size_t buffer_size) override;
+    int GetStatusCode() override { return status_code_; }
+    std::string GetResponseHeader(const std::string& key) const override;
+    size_t GetBodyLength() override { return content_length_ > 0 ? content_length_ : 0; }
+    std::string ReadAll() override;
+
+private:
+    MusicHttpPool* pool_;
+    MusicCancelToken* cancel_;
+    int cancel_id_ = 0;
+    // connection_ 只由请求线程修改，修改时持有 abort_mutex_，Abort() 在取消线程中读取
+    std::mutex abort_mutex_;
+    std::atomic<bool> aborted_{false};
+    std::unique_ptr<MusicHttpConnection> connection_;
+    int timeout_ms_ = kDefaultTimeoutMs;
+    std::map<std::string, std::string> headers_;
+    std::string content_;
+
+    // 响应状态
+    int status_code_ = -1;
+    std::map<std::string, std::string> response_headers_;  // 键为小写
+    int64_t content_length_ = -1;   // -1 表示未知
+    int64_t body_read_ = 0;
+    bool chunked_ = false;
+    size_t chunk_remaining_ = 0;
+    bool body_done_ = false;
+    bool keep_alive_ = false;
+
+    std::string BuildRequest(const std::string& method, const std::string& host, int port, bool ssl,
+                             const std::string& path) const;
+    bool Request(const std::string& method, const std::string& url);
+    bool ReadResponseHead(const std::string& method);
+    bool ReadLine(std::string* line);
+    int Receive(char* buffer, size_t size);
+    int ReadChunked(char* buffer, size_t buffer_size);
+    void SetConnection(std::unique_ptr<MusicHttpConnection> connection);
+    std::unique_ptr<MusicHttpConnection> TakeConnection();
+    void Abort();
+};
+
+PooledHttp::PooledHttp(MusicHttpPool* pool, MusicCancelToken* cancel) : pool_(pool), cancel_(cancel) {
+    if (cancel_ != nullptr) {
+        cancel_id_ = cancel_->Register([this]() { Abort(); });
+    }
+}
+
+PooledHttp::~PooledHttp() {
+    if (cancel_ != nullptr) {
+        cancel_->Unregister(cancel_id_);
+    }
+    Close();
+}
+
+void PooledHttp::SetConnection(std::unique_ptr<MusicHttpConnection> connection) {
+    std::lock_guard<std::mutex> lock(abort_mutex_);
+    connection_ = std::move(connection);
+    if (connection_ && aborted_) {
+        std::lock_guard<std::mutex> connection_lock(connection_->mutex);
+        connection_->aborted = true;
+    }
+}
+
+std::unique_ptr<MusicHttpConnection> PooledHttp::TakeConnection() {
+    std::lock_guard<std::mutex> lock(abort_mutex_);
+    return std::move(connection_);
+}
+
+// 在取消线程中调用：唤醒阻塞在读取上的请求线程，之后的读取和 Open() 都立即失败
+void PooledHttp::Abort() {
+    std::lock_guard<std::mutex> lock(abort_mutex_);
+    aborted_ = true;
+    if (connection_) {
+        {
+            std::lock_guard<std::mutex> connection_lock(connection_->mutex);
+            connection_->aborted = true;
+        }
+        connection_->cv.notify_all();
+    }
+}
+
+std::string PooledHttp::BuildRequest(const std::string& method, const std::string& host, int port, bool ssl,
+                                     const std::string& path) const {
+    std::string request = method + " " + path + " HTTP/1.1\r\n";
+    request += "Host: " + host;
+    if (port != (ssl ? 443 : 80)) {
+        request += ":" + std::to_string(port);
+    }
+    request += "\r\n";
+    bool has_connection = false;
+    for (const auto& header : headers_) {
+        request += header.first + ": " + header.second + "\r\n";
+        if (ToLower(header.first) == "connection") {
+            has_connection = true;
+        }
+    }
+    if (!has_connection) {
+        request += "Connection: keep-alive\r\n";
+    }
+    if (!content_.empty() || method == "POST" || method == "PUT") {
+        request += "Content-Length: " + std::to_string(content_.size()) + "\r\n";
+    }
+    request += "\r\n";
+    request += content_;
+    return request;
+}
+
+// 发起请求并跟随 301/302/303/307/308 重定向，重定向次数过多时返回最后一个3xx响应
+bool PooledHttp::Open(const std::string& method, const std::string& url) {
+    std::string current_method = method;
+    std::string current_url = url;
+    for (int redirects = 0;; redirects++) {
+        if (!Request(current_method, current_url)) {
+            return false;
+        }
+        bool redirect = status_code_ == 301 || status_code_ == 302 || status_code_ == 303 || status_code_ == 307 ||
+                        status_code_ == 308;
+        std::string location = GetResponseHeader("Location");
+        if (!redirect || location.empty()) {
+            return true;
+        }
+        if (redirects >= kMaxRedirects) {
+            ESP_LOGE(TAG, "Too many redirects: %s", url.c_str());
+            return true;
+        }
+        current_url = ResolveLocation(current_url, location);
+        ESP_LOGI(TAG, "Redirected (%d) to %s", status_code_, current_url.c_str());
+        // 303 以及 POST 的 301/302 改用 GET 且不带请求体，其他情况保持原方法
+        if (status_code_ == 303 || ((status_code_ == 301 || status_code_ == 302) && current_method == "POST")) {
+            current_method = "GET";
+            content_.clear();
+        }
+    }
+}
+
+bool PooledHttp::Request(const std::string& method, const std::string& url) {
+    Close();
+
+    bool ssl;
+    int port;
+    std::string host, path;
+    if (!ParseUrl(url, &ssl, &host, &port, &path)) {
+        ESP_LOGE(TAG, "Invalid URL: %s", url.c_str());
+        return false;
+    }
+    std::string request = BuildRequest(method, host, port, ssl, path);
+
+    // 复用的空闲连接可能刚好被服务器关闭，此时换一条新连接重试一次
+    for (int attempt = 0; attempt < 2 && !aborted_; attempt++) {
+        bool reused = false;
+        SetConnection(pool_->Acquire(ssl, host, port, timeout_ms_, &reused));
+        if (!connection_) {
+            return false;
+        }
+        if (connection_->tcp->Send(request) >= 0 && ReadResponseHead(method)) {
+            connection_->requests++;
+            return true;
+        }
+        pool_->Release(TakeConnection(), false);
+        if (!reused || aborted_) {
+            break;
+        }
+        ESP_LOGW(TAG, "Reused connection to %s was closed by server, reconnecting", host.c_str());
+    }
+    ESP_LOGE(TAG, "Failed to request %s", url.c_str());
+    return false;
+}
+
+void PooledHttp::Close() {
+    if (!connection_) {
+        return;
+    }
+    // 剩余响应体很短时读掉，使连接可以复用（例如错误状态码的响应）
+    if (keep_alive_ && !body_done_ && !chunked_ && content_length_ >= 0 &&
+        content_length_ - body_read_ <= (int64_t)kMaxDrainBytes) {
+        char discard[256];
+        while (Read(discard, sizeof(discard)) > 0) {
+        }
+    }
+    connection_->last_used_us = esp_timer_get_time();
+    pool_->Release(TakeConnection(), keep_alive_ && body_done_ && !aborted_);
+}
+
+// 从连接读取数据，返回读到的字节数，连接已关闭返回0，超时或接收缓存溢出返回-1
+int PooledHttp::Receive(char* buffer, size_t size) {
+    auto& connection = *connection_;
+    std::unique_lock<std::mutex> lock(connection.mutex);
+    if (!connection.cv.wait_for(lock, std::chrono::milliseconds(timeout_ms_), [&connection] {
+            return connection.Unread() > 0 || connection.disconnected || connection.aborted || connection.overflowed;
+        })) {
+        return -1;
+    }
+    if (connection.aborted) {
+        return -1;
+    }
+    size_t unread = connection.Unread();
+    if (unread == 0) {
+        if (connection.overflowed) {
+            ESP_LOGW(TAG, "Connection #%d dropped data after %u unread bytes", connection.id,
+                     (unsigned int)kMaxStalledBytes);
+            return -1;
+        }
+        return 0;
+    }
+    size_t n = std::min(size, unread);
+    memcpy(buffer, connection.pending.data() + connection.pending_offset, n);
+    connection.Consume(n);
+    lock.unlock();
+    if (unread >= kMaxPendingBytes) {
+        // 唤醒等待空间的接收回调
+        connection.cv.notify_all();
+    }
+    return n;
+}
+
+bool PooledHttp::ReadLine(std::string* line) {
+    auto& connection = *connection_;
+    std::unique_lock<std::mutex> lock(connection.mutex);
+    size_t end = std::string::npos;
+    if (!connection.cv.wait_for(lock, std::chrono::milliseconds(timeout_ms_), [&connection, &end] {
+            end = connection.pending.find("\r\n", connection.pending_offset);
+            return end != std::string::npos || connection.disconnected || connection.aborted ||
+                   connection.overflowed || connection.Unread() >= kMaxHeaderBytes;
+        })) {
+        return false;
+    }
+    if (connection.aborted) {
+        return false;
+    }
+    if (end == std::string::npos) {
+        return false;
+    }
+    line->assign(connection.pending, connection.pending_offset, end - connection.pending_offset);
+    connection.Consume(end + 2 - connection.pending_offset);
+    return true;
+}
+
+bool PooledHttp::ReadResponseHead(const std::string& method) {
+    status_code_ = -1;
+    response_headers_.clear();
+    content_length_ = -1;
+    body_read_ = 0;
+    chunked_ = false;
+    chunk_remaining_ = 0;
+    body_done_ = false;
+    keep_alive_ = false;
+
+    std::string line;
+    bool http10 = false;
+    do {
+        // 状态行：HTTP/1.1 200 OK，跳过 100 Continue；Shoutcast 电台返回 ICY 200 OK，按 HTTP/1.0 处理
+        if (!ReadLine(&line)) {
+            return false;
+        }
+        bool icy = line.compare(0, 4, "ICY ") == 0;
+        if (!icy && line.compare(0, 5, "HTTP/") != 0) {
+            return false;
+        }
+        http10 = icy || line.compare(0, 8, "HTTP/1.0") == 0;
+        size_t space = line.find(' ');
+        if (space == std::string::npos) {
+            return false;
+        }
+        status_code_ = atoi(line.c_str() + space + 1);
+
+        response_headers_.clear();
+        size_t header_bytes = 0;
+        while (true) {
+            if (!ReadLine(&line)) {
+                return false;
+            }
+            if (line.empty()) {
+                break;
+            }
+            header_bytes += line.size();
+            if (header_bytes > kMaxHeaderBytes) {
+                ESP_LOGE(TAG, "Response header too large");
+                return false;
+            }
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                response_headers_[ToLower(Trim(line.substr(0, colon)))] = Trim(line.substr(colon + 1));
+            }
+        }
+    } while (status_code_ == 100);
+
+    std::string connection = ToLower(GetResponseHeader("Connection"));
+    keep_alive_ = http10 ? connection == "keep-alive" : connection != "close";
+    chunked_ = ToLower(GetResponseHeader("Transfer-Encoding")).find("chunked") != std::string::npos;
+    std::string content_length = GetResponseHeader("Content-Length");
+    if (!chunked_ && !content_length.empty()) {
+        content_length_ = strtoll(content_length.c_str(), nullptr, 10);
+    }
+
+    if (method == "HEAD" || status_code_ == 204 || status_code_ == 304 || (status_code_ >= 100 && status_code_ < 200)) {
+        content_length_ = 0;
+        chunked_ = false;
+    }
+    if (content_length_ == 0) {
+        body_done_ = true;
+    } else if (!chunked_ && content_length_ < 0) {
+        // 没有长度信息，响应体读到连接关闭为止
+        keep_alive_ = false;
+    }
+    return true;
+}
+
+int PooledHttp::ReadChunked(char* buffer, size_t buffer_size) {
+    std::string line;
+    if (chunk_remaining_ == 0) {
+        // 块头：十六进制长度，可能带扩展参数
+        if (!ReadLine(&line)) {
+            return -1;
+        }
+        chunk_remaining_ = strtoul(line.c_str(), nullptr, 16);
+        if (chunk_remaining_ == 0) {
+            // 最后一块，跳过trailer直到空行
+            do {
+                if (!ReadLine(&line)) {
+                    return -1;
+                }
+            } while (!line.empty());
+            body_done_ = true;
+            return 0;
+        }
+    }
+
+    int n = Receive(buffer, std::min(buffer_size, chunk_remaining_));
+    if (n <= 0) {
+        return -1;
+    }
+    chunk_remaining_ -= n;
+    if (chunk_remaining_ == 0 && (!ReadLine(&line) || !line.empty())) {
+        return -1;
+    }
+    return n;
+}
+
+int PooledHttp::Read(char* buffer, size_t buffer_size) {
+    if (!connection_) {
+        return -1;
+    }
+    if (body_done_ || buffer_size == 0) {
+        return 0;
+    }
+
+    int n;
+    if (chunked_) {
+        n = ReadChunked(buffer, buffer_size);
+    } else if (content_length_ >= 0) {
+        n = Receive(buffer, std::min<int64_t>(buffer_size, content_length_ - body_read_));
+        if (n == 0) {
+            // 连接在响应体读完之前关闭
+            n = -1;
+        }
+    } else {
+        n = Receive(buffer, buffer_size);
+        if (n == 0) {
+            body_done_ = true;
+        }
+    }
+
+    if (n > 0) {
+        body_read_ += n;
+        if (content_length_ >= 0 && body_read_ >= content_length_) {
+            body_done_ = true;
+        }
+    } else if (n < 0) {
+        keep_alive_ = false;
+    }
+    return n;
+}
+
+int PooledHttp::Write(const char* buffer, size_t buffer_size) {
+    if (!connection_) {
+        return -1;
+    }
+    return connection_->tcp->Send(std::string(buffer, buffer_size));
+}
+
+std::string PooledHttp::GetResponseHeader(const std::string& key) const {
+    auto it = response_headers_.find(ToLower(key));
+    return it == response_headers_.end() ? "" : it->second;
+}
+
+std::string PooledHttp::ReadAll() {
+    std::string body;
+    if (content_length_ > 0) {
+        body.reserve(content_length_);
+    }
+    char buffer[1024];
+    int n;
+    while ((n = Read(buffer, sizeof(buffer))) > 0) {
+        body.append(buffer, n);
+    }
+    return body;
+}
+
+MusicHttpPool::MusicHttpPool() {
+}
+
+MusicHttpPool::~MusicHttpPool() {
+    Clear();
+}
+
+std::unique_ptr<Http> MusicHttpPool::CreateHttp(MusicCancelToken* cancel) {
+    return std::make_unique<PooledHttp>(this, cancel);
+}
+
+void MusicHttpPool::Clear() {
+    std::vector<std::unique_ptr<MusicHttpConnection>> idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle.swap(idle_);
+    }
+    for (auto& connection : idle) {
+        int id = connection->id;
+        connection.reset();
+        FreeId(id);
+    }
+}
+
+void MusicHttpPool::FreeId(int id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        used_ids_ &= ~(1u << (id - kBaseConnectId));
+    }
+    cv_.notify_all();
+}
+
+std::unique_ptr<MusicHttpConnection> MusicHttpPool::Acquire(bool ssl, const std::string& host, int port,
+                                                            int timeout_ms, bool* reused) {
+    *reused = false;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // 优先复用同一主机的空闲连接，顺便清理已失效的连接
+        std::vector<std::unique_ptr<MusicHttpConnection>> stale;
+        std::unique_ptr<MusicHttpConnection> found;
+        for (auto it = idle_.begin(); it != idle_.end();) {
+            if (!(*it)->Reusable()) {
+                stale.push_back(std::move(*it));
+                it = idle_.erase(it);
+            } else if (!found && (*it)->Matches(ssl, host, port)) {
+                found = std::move(*it);
+                it = idle_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (!stale.empty()) {
+            lock.unlock();
+            for (auto& connection : stale) {
+                int id = connection->id;
+                connection.reset();
+                FreeId(id);
+            }
+            lock.lock();
+        }
+        if (found) {
+            *reused = true;
+            reuse_count_++;
+            ESP_LOGI(TAG, "Reusing connection #%d to %s:%d (request %d)", found->id, host.c_str(), port,
+                     found->requests + 1);
+            return found;
+        }
+
+        // 分配新的 connect id，没有空闲id时淘汰其他主机的空闲连接
+        int id = -1;
+        for (int i = 0; i < kMaxConnections; i++) {
+            if (!(used_ids_ & (1u << i))) {
+                id = kBaseConnectId + i;
+                used_ids_ |= 1u << i;
+                break;
+            }
+        }
+        if (id < 0 && !idle_.empty()) {
+            auto evicted = std::move(idle_.front());
+            idle_.erase(idle_.begin());
+            id = evicted->id;
+            lock.unlock();
+            evicted.reset();
+            lock.lock();
+        }
+        if (id >= 0) {
+            lock.unlock();
+            auto connection = Connect(id, ssl, host, port);
+            if (!connection) {
+                FreeId(id);
+            }
+            return connection;
+        }
+
+        // 所有连接都在使用中，等待归还
+        if (cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+            ESP_LOGE(TAG, "No free connection for %s:%d", host.c_str(), port);
+            return nullptr;
+        }
+    }
+}
+
+std::unique_ptr<MusicHttpConnection> MusicHttpPool::Connect(int id, bool ssl, const std::string& host, int port) {
+    auto network = Board::GetInstance().GetNetwork();
+    auto connection = std::make_unique<MusicHttpConnection>();
+    connection->id = id;
+    connection->ssl = ssl;
+    connection->host = host;
+    connection->port = port;
+    connection->tcp = ssl ? network->CreateSsl(id) : network->CreateTcp(id);
+    if (!connection->tcp) {
+        ESP_LOGE(TAG, "Failed to create connection #%d", id);
+        return nullptr;
+    }
+
+    auto raw = connection.get();
+    // 在网络/模组的接收任务中调用，只做有上限的等待，见 kMaxPendingBytes
+    raw->tcp->OnStream([raw](const std::string& data) {
+        {
+            std::unique_lock<std::mutex> lock(raw->mutex);
+            if (raw->Unread() >= kMaxPendingBytes) {
+                raw->cv.wait_for(lock, std::chrono::milliseconds(kMaxReceiveBlockMs), [raw] {
+                    return raw->Unread() < kMaxPendingBytes || raw->discarding || raw->aborted;
+                });
+            }
+            if (raw->discarding || raw->aborted || raw->overflowed) {
+                return;
+            }
+            if (raw->Unread() + data.size() > kMaxStalledBytes) {
+                raw->overflowed = true;
+            } else {
+                raw->Append(data);
+            }
+        }
+        raw->cv.notify_all();
+    });
+    raw->tcp->OnDisconnected([raw]() {
+        {
+            std::lock_guard<std::mutex> lock(raw->mutex);
+            raw->disconnected = true;
+        }
+        raw->cv.notify_all();
+    });
+
+    int64_t start_us = esp_timer_get_time();
+    if (!raw->tcp->Connect(host, port)) {
+        ESP_LOGE(TAG, "Failed to connect to %s:%d", host.c_str(), port);
+        return nullptr;
+    }
+    connect_count_++;
+    ESP_LOGI(TAG, "Opened connection #%d to %s:%d in %d ms", id, host.c_str(), port,
+             (int)((esp_timer_get_time() - start_us) / 1000));
+    return connection;
+}
+
+void MusicHttpPool::Release(std::unique_ptr<MusicHttpConnection> connection, bool reusable) {
+    if (!connection) {
+        return;
+    }
+    if (reusable && connection->Reusable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle_.push_back(std::move(connection));
+        }
+        cv_.notify_all();
+        return;
+    }
+    int id = connection->id;
+    connection.reset();
+    FreeId(id);
+}
@@ -0,0 +1,70 @@
+#ifndef MUSIC_HTTP_POOL_H
+#define MUSIC_HTTP_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <http.h>
+
+struct MusicHttpConnection;
+class MusicCancelToken;
+
+/*
+ * 音乐接口的HTTP/1.1 keep-alive连接池，按 主机+端口 复用TCP连接：
+ *
+ * - CreateHttp() 返回的Http对象用法与 NetworkInterface::CreateHttp() 相同，
+ *   Open() 时优先取同一主机上的空闲连接，没有时新建
+ * - Close() 时若响应体已读完且服务器没有要求关闭连接，连接放回池中，否则断开
+ * - 元数据和歌词请求依次复用同一条连接；音频流在下载期间独占一条连接，读完后同样放回池中
+ * - 传入取消令牌时，令牌取消后阻塞的 Read() 立即返回-1，连接断开而不放回池中
+ * - Open() 自动跟随 3xx 重定向，重定向到其他主机时换用该主机的连接
+ * - 未读数据较多时接收回调做有上限的等待，拖慢接收形成背压；长时间不读取导致缓存溢出时 Read() 返回-1，
+ *   调用方需要重新连接（可以用Range请求续传）
+ *
+ * 4G网络下每次TCP握手需要150~400ms，复用连接直接缩短起播和取歌词的时间。
+ * 同时存在的连接数不超过 kMaxConnections，使用独立的 connect id，不与协议层的连接冲突。
+ */
+class MusicHttpPool {
+public:
+    MusicHttpPool();
+    ~MusicHttpPool();
+
+    MusicHttpPool(const MusicHttpPool&) = delete;
+    MusicHttpPool& operator=(const MusicHttpPool&) = delete;
+
+    std::unique_ptr<Http> CreateHttp(MusicCancelToken* cancel = nullptr);
+    // 断开所有空闲连接
+    void Clear();
+
+    int connect_count() const { return connect_count_.load(); }
+    int reuse_count() const { return reuse_count_.load(); }
+
+    static constexpr int kBaseConnectId = 3;       // 0~2 已被 OTA/MQTT、WebSocket、UDP 使用
+    static constexpr int kMaxConnections = 3;
+    static constexpr int kMaxIdleMs = 30000;       // 空闲太久的连接可能已被运营商NAT回收，不再复用
+
+private:
+    friend class PooledHttp;
+
+    // 取一条到 host:port 的连接，reused 表示是否为复用的空闲连接；连接数已满时最多等待 timeout_ms
+    std::unique_ptr<MusicHttpConnection> Acquire(bool ssl, const std::string& host, int port, int timeout_ms,
+                                                 bool* reused);
+    // 归还连接，reusable 为false时直接断开
+    void Release(std::unique_ptr<MusicHttpConnection> connection, bool reusable);
+    std::unique_ptr<MusicHttpConnection> Connect(int id, bool ssl, const std::string& host, int port);
+    void FreeId(int id);
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<MusicHttpConnection>> idle_;
+    uint32_t used_ids_ = 0;  // 已分配的 connect id（包括空闲和使用中的连接），按位表示
+    std::atomic<int> connect_count_{0};
+    std::atomic<int> reuse_count_{0};
+};
+
+#endif // MUSIC_HTTP_POOL_H
@@ -0,0 +1,490 @@
+#include "music_library.h"
+#include "music_cache.h"
+#include "mp3_seek_index.h"
+
+#include <esp_log.h>
+#include <esp_pthread.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+#include "mp3dec.h"
+}
+
+#define TAG "MusicLibrary"
+
+#ifndef CONFIG_MUSIC_LIBRARY_PATH
+#define CONFIG_MUSIC_LIBRARY_PATH "/sdcard/music"
+#endif
+
+#define MUSIC_LIBRARY_INDEX_NAME "library.idx"
+
+static const char kIndexMagic[4] = {'M', 'L', 'I', 'B'};
+static const uint32_t kIndexVersion = 1;
+static const int kMaxDepth = 4;
+// 前缀匹配至少需要的字节数（2个汉字），避免"a"之类的请求随便命中一首
+static const size_t kMinPrefixLength = 6;
+
+struct IndexHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t fingerprint;   // 所有音乐文件路径的 FNV-1a 哈希
+    uint32_t count;
+    uint32_t strings_size;
+};
+
+static bool IsMusicFile(const std::string& name) {
+    static const char* kExtensions[] = {".mp3", ".aac", ".flac", ".ogg", ".opus"};
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos) {
+        return false;
+    }
+    std::string extension = name.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    for (const char* candidate : kExtensions) {
+        if (extension == candidate) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t Fnv1a(uint32_t hash, const std::string& text) {
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 16777619u;
+    }
+    return (hash ^ 0xFF) * 16777619u;
+}
+
+static uint32_t ReadSyncsafe(const uint8_t* data) {
+    return ((data[0] & 0x7F) << 21) | ((data[1] & 0x7F) << 14) | ((data[2] & 0x7F) << 7) | (data[3] & 0x7F);
+}
+
+static void AppendUtf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += (char)code_point;
+    } else if (code_point < 0x800) {
+        out += (char)(0xC0 | (code_point >> 6));
+        out += (char)(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += (char)(0xE0 | (code_point >> 12));
+        out += (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out += (char)(0x80 | (code_point & 0x3F));
+    } else {
+        out += (char)(0xF0 | (code_point >> 18));
+        out += (char)(0x80 | ((code_point >> 12) & 0x3F));
+        out += (char)(0x80 | ((code_point >> 6) & 0x3F));
+        out += (char)(0x80 | (code_point & 0x3F));
+    }
+}
+
+// ID3 文本帧转为UTF-8：第一个字节是编码，0=ISO-8859-1，1=带BOM的UTF-16，2=UTF-16BE，3=UTF-8
+static std::string DecodeId3Text(const uint8_t* data, size_t size) {
+    std::string text;
+    if (size < 1) {
+        return text;
+    }
+    uint8_t encoding = data[0];
+    data++;
+    size--;
+    if (encoding == 1 || encoding == 2) {
+        bool big_endian = encoding == 2;
+        if (encoding == 1 && size >= 2) {
+            big_endian = data[0] == 0xFE && data[1] == 0xFF;
+            data += 2;
+            size -= 2;
+        }
+        for (size_t i = 0; i + 1 < size; i += 2) {
+            uint32_t unit = big_endian ? (data[i] << 8) | data[i + 1] : data[i] | (data[i + 1] << 8);
+            if (unit == 0) {
+                break;
+            }
+            if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < size) {
+                uint32_t low = big_endian ? (data[i + 2] << 8) | data[i + 3] : data[i + 2] | (data[i + 3] << 8);
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            }
+            AppendUtf8(text, unit);
+        }
+    } else {
+        for (size_t i = 0; i < size && data[i] != 0; i++) {
+            if (encoding == 3) {
+                text += (char)data[i];
+            } else {
+                AppendUtf8(text, data[i]);
+            }
+        }
+    }
+    return text;
+}
+
+// 读取文件开头的 ID3v2 标签中的标题和歌手，返回标签的总长度（没有标签时为0）
+static size_t ReadId3Tag(FILE* file, std::string* title, std::string* artist) {
+    uint8_t header[10];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) || memcmp(header, "ID3", 3) != 0) {
+        return 0;
+    }
+    int version = header[3];
+    size_t tag_end = ReadSyncsafe(header + 6) + 10;
+    size_t tag_size = tag_end + ((header[5] & 0x10) ? 10 : 0);  // 可能带有10字节的尾部
+    size_t position = 10;
+    if (version >= 3 && (header[5] & 0x40)) {
+        // 扩展头
+        uint8_t size_bytes[4];
+        if (fread(size_bytes, 1, 4, file) != 4) {
+            return tag_size;
+        }
+        size_t extended_size = version == 4 ? ReadSyncsafe(size_bytes)
+                                            : (size_bytes[0] << 24) | (size_bytes[1] << 16) | (size_bytes[2] << 8) | size_bytes[3];
+        position += version == 4 ? extended_size : extended_size + 4;
+    }
+
+    // ID3v2.2 的帧ID和长度都是3字节
+    size_t frame_header_size = version == 2 ? 6 : 10;
+    const char* title_id = version == 2 ? "TT2" : "TIT2";
+    const char* artist_id = version == 2 ? "TP1" : "TPE1";
+    size_t id_length = version == 2 ? 3 : 4;
+    while (position + frame_header_size <= tag_end && (title->empty() || artist->empty())) {
+        uint8_t frame[10];
+        if (fseek(file, position, SEEK_SET) != 0 || fread(frame, 1, frame_header_size, file) != frame_header_size) {
+            break;
+        }
+        if (frame[0] == 0) {
+            break;  // 填充区
+        }
+        size_t frame_size;
+        if (version == 2) {
+            frame_size = (frame[3] << 16) | (frame[4] << 8) | frame[5];
+        } else if (version == 4) {
+            frame_size = ReadSyncsafe(frame + 4);
+        } else {
+            frame_size = (frame[4] << 24) | (frame[5] << 16) | (frame[6] << 8) | frame[7];
+        }
+        position += frame_header_size;
+        if (frame_size == 0 || position + frame_size > tag_end) {
+            break;
+        }
+        std::string* target = nullptr;
+        if (memcmp(frame, title_id, id_length) == 0) {
+            target = title;
+        } else if (memcmp(frame, artist_id, id_length) == 0) {
+            target = artist;
+        }
+        if (target != nullptr && frame_size <= 512) {
+            uint8_t text[512];
+            if (fread(text, 1, frame_size, file) == frame_size) {
+                *target = DecodeId3Text(text, frame_size);
+            }
+        }
+        position += frame_size;
+    }
+    return tag_size;
+}
+
+// 从音频数据开头计算时长：MP3 用第一帧的 Xing/VBRI 头或码率，FLAC 用 STREAMINFO
+static uint32_t ReadDuration(FILE* file, size_t audio_offset, size_t file_size, size_t* first_frame_offset) {
+    uint8_t data[2048];
+    if (fseek(file, audio_offset, SEEK_SET) != 0) {
+        return 0;
+    }
+    size_t size = fread(data, 1, sizeof(data), file);
+    if (size >= 42 && memcmp(data, "fLaC", 4) == 0 && (data[4] & 0x7F) == 0) {
+        const uint8_t* info = data + 8;
+        uint32_t sample_rate = (info[10] << 12) | (info[11] << 4) | (info[12] >> 4);
+        uint64_t total_samples = ((uint64_t)(info[13] & 0x0F) << 32) | ((uint32_t)info[14] << 24) |
+                                 (info[15] << 16) | (info[16] << 8) | info[17];
+        return sample_rate > 0 ? (uint32_t)(total_samples * 1000 / sample_rate) : 0;
+    }
+    if (size >= 4 && (memcmp(data, "OggS", 4) == 0 || (data[0] == 0xFF && (data[1] & 0xF6) == 0xF0))) {
+        return 0;  // Ogg 和 AAC 的时长需要读到文件末尾才能知道
+    }
+    int sync_offset = MP3FindSyncWord(data, (int)size);
+    if (sync_offset < 0) {
+        return 0;
+    }
+    *first_frame_offset = audio_offset + sync_offset;
+    Mp3SeekIndex index;
+    if (!index.Build(data + sync_offset, size - sync_offset, audio_offset + sync_offset, file_size)) {
+        return 0;
+    }
+    return (uint32_t)index.GetDurationMs();
+}
+
+// 没有标签时从文件名 "歌手 - 歌名.mp3" 中取出歌名和歌手
+static void ParseFileName(const std::string& path, std::string* title, std::string* artist) {
+    std::string name = path.substr(path.rfind('/') + 1);
+    name = name.substr(0, name.rfind('.'));
+    size_t separator = name.find(" - ");
+    if (separator == std::string::npos) {
+        if (title->empty()) {
+            *title = name;
+        }
+        return;
+    }
+    if (artist->empty()) {
+        *artist = name.substr(0, separator);
+    }
+    if (title->empty()) {
+        *title = name.substr(separator + 3);
+    }
+}
+
+static uint32_t AddString(std::string& strings, const std::string& text) {
+    uint32_t offset = strings.size();
+    strings.append(text);
+    strings.push_back('\0');
+    return offset;
+}
+
+MusicLibrary::MusicLibrary() {
+}
+
+MusicLibrary::~MusicLibrary() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MusicLibrary::Start() {
+#if CONFIG_USE_MUSIC_LIBRARY
+    if (thread_.joinable()) {
+        return;
+    }
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size = 6144;
+    cfg.prio = 2;  // 扫描不影响播放
+    cfg.thread_name = "music_library";
+    esp_pthread_set_cfg(&cfg);
+    thread_ = std::thread(&MusicLibrary::Run, this);
+#endif
+}
+
+void MusicLibrary::Run() {
+    struct stat st;
+    if (stat(CONFIG_MUSIC_LIBRARY_PATH, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        ESP_LOGI(TAG, "%s not found, local library disabled", CONFIG_MUSIC_LIBRARY_PATH);
+        return;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    std::vector<std::string> files;
+    CollectFiles(CONFIG_MUSIC_LIBRARY_PATH, 0, files);
+    if (stop_) {
+        return;
+    }
+    std::sort(files.begin(), files.end());
+    uint32_t fingerprint = 2166136261u;
+    for (const auto& file : files) {
+        fingerprint = Fnv1a(fingerprint, file);
+    }
+
+    if (LoadIndex(fingerprint)) {
+        ESP_LOGI(TAG, "Loaded library index: %u tracks in %d ms", (unsigned int)records_.size(),
+                 (int)((esp_timer_get_time() - start_us) / 1000));
+        return;
+    }
+    Scan(files, fingerprint);
+    if (!stop_) {
+        ESP_LOGI(TAG, "Scanned %u files into library index in %d ms", (unsigned int)files.size(),
+                 (int)((esp_timer_get_time() - start_us) / 1000));
+    }
+}
+
+void MusicLibrary::CollectFiles(const std::string& path, int depth, std::vector<std::string>& files) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    std::vector<std::string> subdirectories;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != nullptr && !stop_) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        std::string child = path + "/" + ent->d_name;
+        if (ent->d_type == DT_DIR) {
+            // 曲库放在 music 分区时跳过歌曲缓存目录
+            if (depth + 1 < kMaxDepth && child != MusicCache::kDirectory) {
+                subdirectories.push_back(child);
+            }
+        } else if (IsMusicFile(ent->d_name)) {
+            files.push_back(child);
+        }
+    }
+    closedir(dir);
+    // 同一时间只打开一个目录，FAT 的 max_files 很小
+    for (const auto& subdirectory : subdirectories) {
+        CollectFiles(subdirectory, depth + 1, files);
+    }
+}
+
+bool MusicLibrary::LoadIndex(uint32_t fingerprint) {
+    FILE* file = fopen(CONFIG_MUSIC_LIBRARY_PATH "/" MUSIC_LIBRARY_INDEX_NAME, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    IndexHeader header;
+    std::vector<Record> records;
+    std::string strings;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, kIndexMagic, 4) == 0 &&
+              header.version == kIndexVersion && header.fingerprint == fingerprint;
+    if (ok) {
+        records.resize(header.count);
+        strings.resize(header.strings_size);
+        ok = fread(records.data(), sizeof(Record), records.size(), file) == records.size() &&
+             fread(&strings[0], 1, strings.size(), file) == strings.size();
+    }
+    fclose(file);
+    if (!ok) {
+        ESP_LOGI(TAG, "Library index missing or outdated, rescanning");
+        return false;
+    }
+    // 防止损坏的索引越界
+    for (const auto& record : records) {
+        if (record.key >= strings.size() || record.title >= strings.size() || record.artist >= strings.size() ||
+            record.path >= strings.size()) {
+            ESP_LOGW(TAG, "Library index corrupted, rescanning");
+            return false;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.swap(records);
+    strings_.swap(strings);
+    return true;
+}
+
+void MusicLibrary::Scan(const std::vector<std::string>& files, uint32_t fingerprint) {
+    std::vector<Record> records;
+    std::string strings;
+    records.reserve(files.size());
+
+    for (const auto& path : files) {
+        if (stop_) {
+            return;
+        }
+        FILE* file = fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            continue;
+        }
+        fseek(file, 0, SEEK_END);
+        size_t file_size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        std::string title, artist;
+        size_t audio_offset = ReadId3Tag(file, &title, &artist);
+        size_t first_frame_offset = audio_offset;
+        uint32_t duration_ms = ReadDuration(file, audio_offset, file_size, &first_frame_offset);
+        fclose(file);
+        ParseFileName(path, &title, &artist);
+
+        Record record;
+        record.key = AddString(strings, MusicCache::Normalize(title));
+        record.title = AddString(strings, title);
+        record.artist = AddString(strings, artist);
+        record.path = AddString(strings, path);
+        record.duration_ms = duration_ms;
+        record.audio_offset = first_frame_offset;
+        record.file_size = file_size;
+        records.push_back(record);
+        ESP_LOGD(TAG, "%s: %s / %s, %u ms", path.c_str(), title.c_str(), artist.c_str(), (unsigned int)duration_ms);
+    }
+
+    const char* pool = strings.c_str();
+    std::sort(records.begin(), records.end(), [pool](const Record& a, const Record& b) {
+        return strcmp(pool + a.key, pool + b.key) < 0;
+    });
+
+    // 先写临时文件，写完再替换，断电时不会留下半个索引
+    IndexHeader header;
+    memcpy(header.magic, kIndexMagic, 4);
+    header.version = kIndexVersion;
+    header.fingerprint = fingerprint;
+    header.count = records.size();
+    header.strings_size = strings.size();
+    const char* index_path = CONFIG_MUSIC_LIBRARY_PATH "/" MUSIC_LIBRARY_INDEX_NAME;
+    const char* temp_path = CONFIG_MUSIC_LIBRARY_PATH "/library.tmp";
+    FILE* file = fopen(temp_path, "wb");
+    if (file != nullptr) {
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(records.data(), sizeof(Record), records.size(), file) == records.size() &&
+                  fwrite(strings.data(), 1, strings.size(), file) == strings.size();
+        fclose(file);
+        unlink(index_path);
+        if (!ok || rename(temp_path, index_path) != 0) {
+            ESP_LOGW(TAG, "Failed to write library index");
+            unlink(temp_path);
+        }
+    } else {
+        ESP_LOGW(TAG, "Library directory is read-only, index kept in memory");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.swap(records);
+    strings_.swap(strings);
+}
+
+bool MusicLibrary::Lookup(const std::string& title, const std::string& artist, Entry* entry) {
+    std::string key = MusicCache::Normalize(title);
+    std::string artist_key = MusicCache::Normalize(artist);
+    if (key.empty()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto less = [this](const Record& record, const std::string& value) {
+        return strcmp(GetString(record.key), value.c_str()) < 0;
+    };
+
+    // 有序表中以 key 为前缀的记录是连续的一段，完全匹配排在最前面
+    const Record* found = nullptr;
+    for (auto it = std::lower_bound(records_.begin(), records_.end(), key, less); it != records_.end(); ++it) {
+        const char* record_key = GetString(it->key);
+        if (strncmp(record_key, key.c_str(), key.size()) != 0) {
+            break;
+        }
+        if (record_key[key.size()] != '\0' && key.size() < kMinPrefixLength) {
+            break;
+        }
+        // 没有歌手信息的文件只按歌名匹配
+        if (!artist_key.empty()) {
+            std::string record_artist = MusicCache::Normalize(GetString(it->artist));
+            if (!record_artist.empty() && record_artist.find(artist_key) == std::string::npos &&
+                artist_key.find(record_artist) == std::string::npos) {
+                continue;
+            }
+        }
+        found = &*it;
+        break;
+    }
+    if (found == nullptr) {
+        return false;
+    }
+
+    entry->title = GetString(found->title);
+    entry->artist = GetString(found->artist);
+    entry->path = GetString(found->path);
+    entry->duration_ms = found->duration_ms;
+    entry->audio_offset = found->audio_offset;
+    entry->file_size = found->file_size;
+
+    // 同名的 .lrc 歌词
+    entry->lyric_path = entry->path.substr(0, entry->path.rfind('.')) + ".lrc";
+    struct stat st;
+    if (stat(entry->lyric_path.c_str(), &st) != 0) {
+        entry->lyric_path.clear();
+    }
+    return true;
+}
+
+size_t MusicLibrary::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_.size();
+}
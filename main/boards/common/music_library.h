@@ -0,0 +1,73 @@
+#ifndef MUSIC_LIBRARY_H
+#define MUSIC_LIBRARY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * 本地曲库：SD卡或闪存目录（CONFIG_MUSIC_LIBRARY_PATH）中的音乐文件，不需要网络即可点播。
+ *
+ * - 启动时在后台线程中扫描一次目录（含子目录），读取每个文件的标题、歌手（ID3v2 标签，没有时取
+ *   "歌手 - 歌名" 形式的文件名）、时长和音频数据的起始偏移，写入目录下的紧凑索引文件 library.idx
+ * - 索引按规范化后的标题排序，查找时二分定位，支持前缀匹配；之后启动时只读取文件名比较指纹，
+ *   目录内容没有变化时直接加载索引，不再打开每个文件
+ * - 音频偏移跳过文件开头的 ID3 标签（可能带有很大的封面图片），播放时直接从音频数据开始读取
+ *
+ * 目录不存在（没有插SD卡或未挂载）或者未启用 CONFIG_USE_MUSIC_LIBRARY 时查找总是失败。
+ */
+class MusicLibrary {
+public:
+    struct Entry {
+        std::string title;
+        std::string artist;
+        std::string path;
+        std::string lyric_path;     // 同名 .lrc 文件，没有时为空
+        uint32_t duration_ms = 0;   // 未知为0
+        uint32_t audio_offset = 0;  // 音频数据（第一帧）在文件中的偏移
+        uint32_t file_size = 0;
+    };
+
+    MusicLibrary();
+    ~MusicLibrary();
+
+    MusicLibrary(const MusicLibrary&) = delete;
+    MusicLibrary& operator=(const MusicLibrary&) = delete;
+
+    // 在后台线程中加载索引，目录有变化时重新扫描
+    void Start();
+
+    // 按歌名查找，完全匹配优先，其次是以 title 开头的歌名；artist 不为空时歌手也要匹配
+    bool Lookup(const std::string& title, const std::string& artist, Entry* entry);
+    size_t size();
+
+private:
+    // 索引文件中的一条记录，字符串都是字符串池中的偏移
+    struct Record {
+        uint32_t key;           // 规范化后的标题，排序和查找用
+        uint32_t title;
+        uint32_t artist;
+        uint32_t path;
+        uint32_t duration_ms;
+        uint32_t audio_offset;
+        uint32_t file_size;
+    };
+
+    std::mutex mutex_;
+    std::vector<Record> records_;
+    std::string strings_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+
+    void Run();
+    void CollectFiles(const std::string& path, int depth, std::vector<std::string>& files);
+    bool LoadIndex(uint32_t fingerprint);
+    void Scan(const std::vector<std::string>& files, uint32_t fingerprint);
+    const char* GetString(uint32_t offset) const { return strings_.c_str() + offset; }
+};
+
+#endif // MUSIC_LIBRARY_H
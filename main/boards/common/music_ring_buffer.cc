@@ -0,0 +1,239 @@
+#include "music_ring_buffer.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "MusicRingBuffer"
+
+#define RB_EVENT_DATA   (1 << 0)
+#define RB_EVENT_SPACE  (1 << 1)
+
+static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+static TickType_t TimeoutToTicks(int timeout_ms) {
+    return timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+}
+
+MusicRingBuffer::MusicRingBuffer(size_t capacity, size_t mirror_size) {
+    event_group_ = xEventGroupCreate();
+
+    size_t rounded = RoundUpToPowerOfTwo(capacity);
+    mirror_size = std::min(mirror_size, rounded);
+    buffer_ = (uint8_t*)heap_caps_malloc(rounded + mirror_size, MALLOC_CAP_SPIRAM);
+    if (buffer_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate ring buffer: %u bytes", (unsigned int)rounded);
+        return;
+    }
+    capacity_ = rounded;
+    mask_ = rounded - 1;
+    mirror_size_ = mirror_size;
+    ESP_LOGI(TAG, "Ring buffer allocated: %u bytes (+%u mirror)", (unsigned int)capacity_, (unsigned int)mirror_size_);
+}
+
+MusicRingBuffer::~MusicRingBuffer() {
+    if (buffer_ != nullptr) {
+        heap_caps_free(buffer_);
+        buffer_ = nullptr;
+    }
+    if (event_group_ != nullptr) {
+        vEventGroupDelete(event_group_);
+    }
+}
+
+size_t MusicRingBuffer::Size() const {
+    size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    size_t read_pos = read_pos_.load(std::memory_order_acquire);
+    return write_pos - read_pos;
+}
+
+size_t MusicRingBuffer::Write(const uint8_t* data, size_t size) {
+    size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    size_t read_pos = read_pos_.load(std::memory_order_acquire);
+    size = std::min(size, capacity_ - (write_pos - read_pos));
+    if (size == 0) {
+        return 0;
+    }
+
+    // 在环形边界处拆成两段拷贝
+    size_t offset = write_pos & mask_;
+    size_t first = std::min(size, capacity_ - offset);
+    memcpy(buffer_ + offset, data, first);
+    if (size > first) {
+        memcpy(buffer_, data + first, size - first);
+    }
+
+    write_pos_.store(write_pos + size);
+    NotifyDataAvailable();
+    return size;
+}
+
+uint8_t* MusicRingBuffer::GetWriteSpan(size_t* size) {
+    size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    size_t read_pos = read_pos_.load(std::memory_order_acquire);
+    size_t offset = write_pos & mask_;
+    *size = std::min(capacity_ - (write_pos - read_pos), capacity_ - offset);
+    return buffer_ + offset;
+}
+
+void MusicRingBuffer::CommitWrite(size_t size) {
+    if (size == 0) {
+        return;
+    }
+    write_pos_.store(write_pos_.load(std::memory_order_relaxed) + size);
+    NotifyDataAvailable();
+}
+
+uint8_t* MusicRingBuffer::GetReadSpan(size_t* size, size_t min_contiguous) {
+    size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    size_t available = write_pos - read_pos;
+    size_t offset = read_pos & mask_;
+    size_t contiguous = std::min(available, capacity_ - offset);
+
+    // 跨越边界：把缓冲区开头已提交的数据复制到尾部镜像区，生产者在我们读完之前不会改写这部分
+    min_contiguous = std::min(min_contiguous, mirror_size_);
+    if (contiguous < min_contiguous && available > contiguous) {
+        size_t head = std::min(available, min_contiguous) - contiguous;
+        size_t lap = read_pos / capacity_;
+        if (mirror_lap_ != lap) {
+            mirror_lap_ = lap;
+            mirror_filled_ = 0;
+        }
+        if (head > mirror_filled_) {
+            memcpy(buffer_ + capacity_ + mirror_filled_, buffer_ + mirror_filled_, head - mirror_filled_);
+            mirror_filled_ = head;
+        }
+        contiguous += head;
+    }
+
+    *size = contiguous;
+    return buffer_ + offset;
+}
+
+size_t MusicRingBuffer::Read(uint8_t* dest, size_t size) {
+    size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    size = std::min(size, write_pos - read_pos);
+    if (size == 0) {
+        return 0;
+    }
+
+    size_t offset = read_pos & mask_;
+    size_t first = std::min(size, capacity_ - offset);
+    memcpy(dest, buffer_ + offset, first);
+    if (size > first) {
+        memcpy(dest + first, buffer_, size - first);
+    }
+
+    read_pos_.store(read_pos + size);
+    NotifySpaceAvailable();
+    return size;
+}
+
+size_t MusicRingBuffer::Skip(size_t size) {
+    size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    size = std::min(size, write_pos - read_pos);
+    if (size == 0) {
+        return 0;
+    }
+
+    read_pos_.store(read_pos + size);
+    NotifySpaceAvailable();
+    return size;
+}
+
+bool MusicRingBuffer::WaitForData(size_t bytes, int timeout_ms) {
+    bytes = std::max<size_t>(1, std::min(bytes, capacity_));
+    while (Size() < bytes) {
+        if (closed_ || stopped_) {
+            return false;
+        }
+
+        // 先登记等待阈值再复查条件，保证生产者要么看到登记，要么我们看到新数据
+        xEventGroupClearBits(event_group_, RB_EVENT_DATA);
+        data_wanted_.store(bytes);
+        if (Size() >= bytes || closed_ || stopped_) {
+            data_wanted_.store(0);
+            continue;
+        }
+
+        EventBits_t bits = xEventGroupWaitBits(event_group_, RB_EVENT_DATA, pdTRUE, pdFALSE,
+                                               TimeoutToTicks(timeout_ms));
+        data_wanted_.store(0);
+        if (!(bits & RB_EVENT_DATA)) {
+            return Size() >= bytes;
+        }
+    }
+    return true;
+}
+
+bool MusicRingBuffer::WaitForSpace(size_t bytes, int timeout_ms) {
+    bytes = std::max<size_t>(1, std::min(bytes, capacity_));
+    while (Space() < bytes) {
+        if (stopped_) {
+            return false;
+        }
+
+        xEventGroupClearBits(event_group_, RB_EVENT_SPACE);
+        space_wanted_.store(bytes);
+        if (Space() >= bytes || stopped_) {
+            space_wanted_.store(0);
+            continue;
+        }
+
+        EventBits_t bits = xEventGroupWaitBits(event_group_, RB_EVENT_SPACE, pdTRUE, pdFALSE,
+                                               TimeoutToTicks(timeout_ms));
+        space_wanted_.store(0);
+        if (!(bits & RB_EVENT_SPACE)) {
+            return Space() >= bytes;
+        }
+    }
+    return !stopped_;
+}
+
+void MusicRingBuffer::Close() {
+    closed_ = true;
+    xEventGroupSetBits(event_group_, RB_EVENT_DATA | RB_EVENT_SPACE);
+}
+
+void MusicRingBuffer::Stop() {
+    stopped_ = true;
+    xEventGroupSetBits(event_group_, RB_EVENT_DATA | RB_EVENT_SPACE);
+}
+
+void MusicRingBuffer::Reset(size_t stream_offset) {
+    read_pos_.store(0);
+    write_pos_.store(0);
+    mirror_lap_ = 0;
+    mirror_filled_ = 0;
+    closed_ = false;
+    stopped_ = false;
+    stream_offset_ = stream_offset;
+    stream_length_.store(0);
+    data_wanted_.store(0);
+    space_wanted_.store(0);
+    xEventGroupClearBits(event_group_, RB_EVENT_DATA | RB_EVENT_SPACE);
+}
+
+void MusicRingBuffer::NotifyDataAvailable() {
+    size_t wanted = data_wanted_.load();
+    if (wanted != 0 && Size() >= wanted) {
+        xEventGroupSetBits(event_group_, RB_EVENT_DATA);
+    }
+}
+
+void MusicRingBuffer::NotifySpaceAvailable() {
+    size_t wanted = space_wanted_.load();
+    if (wanted != 0 && Space() >= wanted) {
+        xEventGroupSetBits(event_group_, RB_EVENT_SPACE);
+    }
+}
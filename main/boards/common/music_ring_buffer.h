@@ -0,0 +1,91 @@
+#ifndef MUSIC_RING_BUFFER_H
+#define MUSIC_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+/*
+ * 单生产者/单消费者字节环形缓冲区，用于音乐下载线程 -> 解码线程的数据交接。
+ *
+ * - 缓冲区在构造时一次性分配（优先PSRAM），播放过程中不再 malloc/free
+ * - Write()/Read() 只使用原子读写指针，不加锁，不阻塞
+ * - WaitForData()/WaitForSpace() 只在需要等待时才进入阻塞，
+ *   对端仅在等待条件满足时才发送唤醒信号，避免每块数据一次的互斥锁交接
+ * - Close() 表示生产者已写完（EOF），Stop() 表示中止，两者都会唤醒所有等待者
+ *
+ * 零拷贝接口：生产者通过 GetWriteSpan()/CommitWrite() 直接把网络数据读进缓冲区，
+ * 消费者通过 GetReadSpan()/CommitRead() 直接在缓冲区上解码。缓冲区尾部多分配了
+ * mirror_size 字节的镜像区，读区跨越环形边界时只把开头的少量数据复制到镜像区，
+ * 保证解码器始终能拿到至少 mirror_size 字节的连续数据。
+ */
+class MusicRingBuffer {
+public:
+    explicit MusicRingBuffer(size_t capacity, size_t mirror_size = 4096);
+    ~MusicRingBuffer();
+
+    MusicRingBuffer(const MusicRingBuffer&) = delete;
+    MusicRingBuffer& operator=(const MusicRingBuffer&) = delete;
+
+    // 生产者接口（仅下载线程调用）
+    size_t Write(const uint8_t* data, size_t size);
+    uint8_t* GetWriteSpan(size_t* size);
+    void CommitWrite(size_t size);
+    bool WaitForSpace(size_t bytes, int timeout_ms = -1);
+    void Close();
+
+    // 消费者接口（仅播放线程调用）
+    size_t Read(uint8_t* dest, size_t size);
+    // min_contiguous 最大为 mirror_size，返回的连续长度为 min(Size(), max(min_contiguous, 到边界的长度))
+    uint8_t* GetReadSpan(size_t* size, size_t min_contiguous = 0);
+    void CommitRead(size_t size) { Skip(size); }
+    size_t Skip(size_t size);
+    bool WaitForData(size_t bytes, int timeout_ms = -1);
+
+    // 控制接口（任意线程）
+    void Stop();
+    // 仅在生产者和消费者线程都已退出时调用，stream_offset 为下一次写入的数据在源文件中的偏移
+    void Reset(size_t stream_offset = 0);
+
+    // 源文件信息：总长度由生产者在拿到响应头后设置（未知为0），读位置换算为源文件偏移
+    void SetStreamLength(size_t length) { stream_length_.store(length); }
+    size_t stream_length() const { return stream_length_.load(); }
+    size_t ReadPosition() const { return stream_offset_ + read_pos_.load(std::memory_order_relaxed); }
+
+    size_t Size() const;
+    size_t Space() const { return capacity_ - Size(); }
+    inline size_t capacity() const { return capacity_; }
+    inline bool valid() const { return buffer_ != nullptr; }
+    inline bool closed() const { return closed_.load(); }
+    inline bool stopped() const { return stopped_.load(); }
+
+private:
+    uint8_t* buffer_ = nullptr;
+    size_t capacity_ = 0;
+    size_t mask_ = 0;
+    size_t mirror_size_ = 0;
+    // 镜像区中已复制的数据：所属圈数和字节数，避免同一圈重复复制
+    size_t mirror_lap_ = 0;
+    size_t mirror_filled_ = 0;
+
+    // 读写位置单调递增，取模由 mask_ 完成（容量为2的幂）
+    std::atomic<size_t> read_pos_{0};
+    std::atomic<size_t> write_pos_{0};
+    std::atomic<bool> closed_{false};
+    std::atomic<bool> stopped_{false};
+    size_t stream_offset_ = 0;
+    std::atomic<size_t> stream_length_{0};
+
+    // 等待方登记的阈值，0 表示没有等待者
+    std::atomic<size_t> data_wanted_{0};
+    std::atomic<size_t> space_wanted_{0};
+    EventGroupHandle_t event_group_ = nullptr;
+
+    void NotifyDataAvailable();
+    void NotifySpaceAvailable();
+};
+
+#endif // MUSIC_RING_BUFFER_H
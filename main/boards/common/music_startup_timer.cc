@@ -0,0 +1,66 @@
+#include "music_startup_timer.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "MusicStartup"
+
+MusicStartupTimer::MusicStartupTimer() {
+    for (auto& stage : stage_us_) {
+        stage = 0;
+    }
+}
+
+void MusicStartupTimer::Begin() {
+    for (auto& stage : stage_us_) {
+        stage = 0;
+    }
+    start_us_ = esp_timer_get_time();
+}
+
+void MusicStartupTimer::Mark(MusicStartupStage stage) {
+    int64_t start_us = start_us_.load();
+    if (start_us == 0) {
+        return;
+    }
+    int64_t expected = 0;
+    int64_t now_us = esp_timer_get_time();
+    if (!stage_us_[stage].compare_exchange_strong(expected, now_us)) {
+        return;
+    }
+
+    int elapsed_ms = (now_us - start_us) / 1000;
+    if (stage != kStartupStageFirstAudio) {
+        ESP_LOGI(TAG, "%s: %d ms", StageName(stage), elapsed_ms);
+        return;
+    }
+
+    // 第一帧音频时汇总一次起播各阶段的耗时
+    MusicStartupStats stats = GetStats();
+    ESP_LOGI(TAG, "Time to first audio: %d ms (metadata %lld, stream open %lld, first byte %lld, buffered %lld)",
+             elapsed_ms, stats.stage_ms[kStartupStageMetadata], stats.stage_ms[kStartupStageStreamOpen],
+             stats.stage_ms[kStartupStageFirstByte], stats.stage_ms[kStartupStageBuffered]);
+}
+
+MusicStartupStats MusicStartupTimer::GetStats() const {
+    MusicStartupStats stats;
+    int64_t start_us = start_us_.load();
+    for (int i = 0; i < kStartupStageCount; i++) {
+        int64_t stage_us = stage_us_[i].load();
+        stats.stage_ms[i] = (start_us == 0 || stage_us == 0) ? -1 : (stage_us - start_us) / 1000;
+    }
+    return stats;
+}
+
+const char* MusicStartupTimer::StageName(MusicStartupStage stage) {
+    switch (stage) {
+        case kStartupStageMetadata: return "metadata";
+        case kStartupStageStreamOpen: return "stream open";
+        case kStartupStageFirstByte: return "first byte";
+        case kStartupStageBuffered: return "buffered";
+        case kStartupStageFirstAudio: return "first audio";
+        case kStartupStageLyricsFetched: return "lyrics fetched";
+        case kStartupStageLyricsParsed: return "lyrics parsed";
+        default: return "unknown";
+    }
+}
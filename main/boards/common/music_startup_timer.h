@@ -0,0 +1,43 @@
+#ifndef MUSIC_STARTUP_TIMER_H
+#define MUSIC_STARTUP_TIMER_H
+
+#include <atomic>
+#include <cstdint>
+
+// 起播过程的各个阶段，按通常到达的先后排列
+enum MusicStartupStage {
+    kStartupStageMetadata,        // 元数据解析完成，工具调用返回
+    kStartupStageStreamOpen,      // 音频流的响应头到达（或打开缓存文件）
+    kStartupStageFirstByte,       // 第一块音频数据写入环形缓冲区
+    kStartupStageBuffered,        // 缓冲区达到起播水位
+    kStartupStageFirstAudio,      // 第一帧PCM送入音频服务
+    kStartupStageLyricsFetched,   // 歌词下载完成
+    kStartupStageLyricsParsed,    // 歌词解析完成，可以显示
+    kStartupStageCount,
+};
+
+// 各阶段距离播放请求的时间（毫秒），-1 表示还没有到达
+struct MusicStartupStats {
+    int64_t stage_ms[kStartupStageCount];
+};
+
+/*
+ * 记录从收到播放请求到各阶段完成的时间（time-to-first-audio），用于定位起播慢在哪一步。
+ * Begin() 在播放请求的线程调用，Mark() 可以在任意线程调用，每个阶段只记录第一次。
+ */
+class MusicStartupTimer {
+public:
+    MusicStartupTimer();
+
+    void Begin();
+    void Mark(MusicStartupStage stage);
+    MusicStartupStats GetStats() const;
+
+    static const char* StageName(MusicStartupStage stage);
+
+private:
+    std::atomic<int64_t> start_us_{0};
+    std::atomic<int64_t> stage_us_[kStartupStageCount];
+};
+
+#endif // MUSIC_STARTUP_TIMER_H
@@ -0,0 +1,113 @@
+#include "music_stats.h"
+
+#include <cJSON.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
+
+#include <algorithm>
+
+MusicStats::MusicStats() {
+    Reset();
+}
+
+void MusicStats::Reset() {
+    downloaded_bytes_ = 0;
+    decoded_frames_ = 0;
+    decode_us_total_ = 0;
+    decode_us_max_ = 0;
+    for (auto& bucket : decode_time_histogram_) {
+        bucket = 0;
+    }
+    decode_errors_ = 0;
+    resync_count_ = 0;
+    dropped_bytes_ = 0;
+    resyncing_ = false;
+    for (auto& bucket : fill_histogram_) {
+        bucket = 0;
+    }
+    for (auto& sample : fill_history_) {
+        sample = 0;
+    }
+    fill_history_count_ = 0;
+    last_fill_sample_us_ = 0;
+}
+
+void MusicStats::OnDownload(size_t bytes) {
+    downloaded_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void MusicStats::OnDecode(int64_t cycles) {
+    if (cycles < 0) {
+        return;
+    }
+    uint32_t us = (uint32_t)(cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    decoded_frames_.fetch_add(1, std::memory_order_relaxed);
+    decode_us_total_.fetch_add(us, std::memory_order_relaxed);
+    if (us > decode_us_max_.load(std::memory_order_relaxed)) {
+        decode_us_max_.store(us, std::memory_order_relaxed);
+    }
+
+    int bucket = 0;
+    for (uint32_t limit = 250; bucket < kDecodeTimeBuckets - 1 && us >= limit; limit <<= 1) {
+        bucket++;
+    }
+    decode_time_histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void MusicStats::OnDecodeError(size_t dropped_bytes) {
+    decode_errors_.fetch_add(1, std::memory_order_relaxed);
+    dropped_bytes_.fetch_add(dropped_bytes, std::memory_order_relaxed);
+    if (!resyncing_) {
+        resyncing_ = true;
+        resync_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MusicStats::OnBufferFill(size_t size, size_t capacity) {
+    if (capacity == 0) {
+        return;
+    }
+    int percent = (int)std::min<size_t>(size * 100 / capacity, 100);
+    fill_histogram_[std::min(percent / 10, kFillBuckets - 1)].fetch_add(1, std::memory_order_relaxed);
+
+    int64_t now_us = esp_timer_get_time();
+    if (now_us - last_fill_sample_us_ >= 1000000) {
+        last_fill_sample_us_ = now_us;
+        uint32_t count = fill_history_count_.load(std::memory_order_relaxed);
+        fill_history_[count % kFillHistorySeconds].store(percent, std::memory_order_relaxed);
+        fill_history_count_.store(count + 1, std::memory_order_relaxed);
+    }
+}
+
+static cJSON* CreateHistogram(const std::atomic<uint32_t>* buckets, int count) {
+    cJSON* array = cJSON_CreateArray();
+    for (int i = 0; i < count; i++) {
+        cJSON_AddItemToArray(array, cJSON_CreateNumber(buckets[i].load(std::memory_order_relaxed)));
+    }
+    return array;
+}
+
+void MusicStats::AddToJson(cJSON* json) const {
+    cJSON_AddNumberToObject(json, "downloaded_bytes", (double)downloaded_bytes_.load());
+
+    cJSON* decode = cJSON_AddObjectToObject(json, "decode");
+    uint32_t frames = decoded_frames_.load();
+    cJSON_AddNumberToObject(decode, "frames", frames);
+    cJSON_AddNumberToObject(decode, "avg_us", frames > 0 ? (double)(decode_us_total_.load() / frames) : 0);
+    cJSON_AddNumberToObject(decode, "max_us", decode_us_max_.load());
+    // 各档上限：250us, 500us, 1ms, 2ms, 4ms, 8ms, 16ms, 更长
+    cJSON_AddItemToObject(decode, "histogram_us", CreateHistogram(decode_time_histogram_, kDecodeTimeBuckets));
+    cJSON_AddNumberToObject(decode, "errors", decode_errors_.load());
+    cJSON_AddNumberToObject(decode, "resyncs", resync_count_.load());
+    cJSON_AddNumberToObject(decode, "dropped_bytes", (double)dropped_bytes_.load());
+
+    cJSON* buffer = cJSON_AddObjectToObject(json, "buffer_fill");
+    cJSON_AddItemToObject(buffer, "histogram", CreateHistogram(fill_histogram_, kFillBuckets));
+    // 最近每秒的填充百分比，按时间先后排列
+    cJSON* history = cJSON_AddArrayToObject(buffer, "recent_percent");
+    uint32_t count = fill_history_count_.load();
+    uint32_t first = count > kFillHistorySeconds ? count - kFillHistorySeconds : 0;
+    for (uint32_t i = first; i < count; i++) {
+        cJSON_AddItemToArray(history, cJSON_CreateNumber(fill_history_[i % kFillHistorySeconds].load()));
+    }
+}
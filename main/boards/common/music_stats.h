@@ -0,0 +1,60 @@
+#ifndef MUSIC_STATS_H
+#define MUSIC_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+struct cJSON;
+
+/*
+ * 音乐播放的运行统计，用于在现场区分卡顿来自网络、解码还是I2S输出：
+ *
+ * - 下载：网络读取的总字节数（吞吐量和欠载次数由 JitterBufferController 统计）
+ * - 解码：每帧解码耗时按CPU周期计数，换算为微秒后计入按2的幂分桶的直方图，另记录最大值和平均值
+ * - 重新同步：连续的解码错误算作一次重新同步，错误和丢弃尾部数据时跳过的字节计入 dropped_bytes
+ * - 缓冲区：每帧记录一次填充比例的直方图，另外每秒采样一次，保留最近 kFillHistorySeconds 秒的曲线
+ *
+ * 所有计数都是原子变量，播放线程和下载线程各自更新，读取时不加锁，开销可以常开。
+ */
+class MusicStats {
+public:
+    static constexpr int kDecodeTimeBuckets = 8;    // <250us, <500us, ... <16ms, >=16ms
+    static constexpr int kFillBuckets = 10;         // 每10%一档
+    static constexpr int kFillHistorySeconds = 30;
+
+    MusicStats();
+
+    // 新的播放开始时调用（无缝切到下一首时不调用）
+    void Reset();
+
+    void OnDownload(size_t bytes);
+    // cycles 为 DecodeFrame() 的CPU周期数，解码期间线程被迁移到另一个核时为负，不计入
+    void OnDecode(int64_t cycles);
+    // 解码错误，dropped_bytes 为解码器跳过的字节数；上一帧解码成功时算作一次新的重新同步
+    void OnDecodeError(size_t dropped_bytes);
+    void OnDecodeOk() { resyncing_ = false; }
+    void OnDroppedBytes(size_t bytes) { dropped_bytes_ += bytes; }
+    void OnBufferFill(size_t size, size_t capacity);
+
+    // 把统计结果添加到 json 对象中
+    void AddToJson(cJSON* json) const;
+
+private:
+    std::atomic<uint64_t> downloaded_bytes_{0};
+    std::atomic<uint32_t> decoded_frames_{0};
+    std::atomic<uint64_t> decode_us_total_{0};
+    std::atomic<uint32_t> decode_us_max_{0};
+    std::atomic<uint32_t> decode_time_histogram_[kDecodeTimeBuckets];
+    std::atomic<uint32_t> decode_errors_{0};
+    std::atomic<uint32_t> resync_count_{0};
+    std::atomic<uint64_t> dropped_bytes_{0};
+    bool resyncing_ = false;  // 仅播放线程访问
+
+    std::atomic<uint32_t> fill_histogram_[kFillBuckets];
+    std::atomic<uint8_t> fill_history_[kFillHistorySeconds];
+    std::atomic<uint32_t> fill_history_count_{0};
+    int64_t last_fill_sample_us_ = 0;  // 仅播放线程访问
+};
+
+#endif // MUSIC_STATS_H
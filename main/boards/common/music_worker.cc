@@ -0,0 +1,70 @@
+#include "music_worker.h"
+
+#include <esp_log.h>
+#include <esp_pthread.h>
+#include <esp_timer.h>
+
+#define TAG "MusicWorker"
+
+MusicWorker::MusicWorker(size_t max_pending) : max_pending_(max_pending) {
+}
+
+MusicWorker::~MusicWorker() {
+    Stop();
+}
+
+bool MusicWorker::Post(const char* name, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        if (tasks_.size() >= max_pending_) {
+            ESP_LOGW(TAG, "Queue full, dropping task: %s", name);
+            return false;
+        }
+        tasks_.push_back(Task{name, std::move(task)});
+
+        if (!thread_.joinable()) {
+            esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+            cfg.stack_size = 8192;
+            cfg.prio = 4;  // 低于音频流线程
+            cfg.thread_name = "music_worker";
+            esp_pthread_set_cfg(&cfg);
+            thread_ = std::thread(&MusicWorker::Run, this);
+        }
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void MusicWorker::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        tasks_.clear();
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void MusicWorker::Run() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (stopping_) {
+                break;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+
+        int64_t start_us = esp_timer_get_time();
+        task.run();
+        ESP_LOGD(TAG, "Task %s finished in %d ms", task.name, (int)((esp_timer_get_time() - start_us) / 1000));
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef MUSIC_WORKER_H
+#define MUSIC_WORKER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/*
+ * 音乐播放器的后台工作线程，按提交顺序执行启动音频流、下载和解析歌词等耗时步骤，
+ * 使MCP工具调用在元数据解析完成后就能返回。
+ *
+ * 队列长度有上限，队列已满时 Post() 返回false；线程在第一次提交任务时创建。
+ * 任务需要自己检查是否已经过期（例如期间又切了歌）。
+ */
+class MusicWorker {
+public:
+    explicit MusicWorker(size_t max_pending = 4);
+    ~MusicWorker();
+
+    MusicWorker(const MusicWorker&) = delete;
+    MusicWorker& operator=(const MusicWorker&) = delete;
+
+    bool Post(const char* name, std::function<void()> task);
+    // 丢弃尚未执行的任务，等待正在执行的任务结束后退出线程
+    void Stop();
+
+private:
+    struct Task {
+        const char* name;
+        std::function<void()> run;
+    };
+
+    void Run();
+
+    size_t max_pending_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Task> tasks_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif // MUSIC_WORKER_H
@@ -0,0 +1,172 @@
+#include "ogg_opus_audio_decoder.h"
+
+#include <esp_log.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "OggOpusAudioDecoder"
+
+#define OGG_PAGE_HEADER_SIZE 27
+#define OGG_HEADER_TYPE_CONTINUED 0x01
+#define OGG_HEADER_TYPE_BOS 0x02
+#define OPUS_SAMPLE_RATE 48000
+// Opus包最长120ms
+#define OPUS_MAX_PACKET_DURATION_MS 120
+
+OggOpusAudioDecoder::OggOpusAudioDecoder(int output_sample_rate) : sample_rate_(OPUS_SAMPLE_RATE) {
+    switch (output_sample_rate) {
+    case 8000:
+    case 12000:
+    case 16000:
+    case 24000:
+        sample_rate_ = output_sample_rate;
+        break;
+    default:
+        break;
+    }
+}
+
+bool OggOpusAudioDecoder::Probe(const uint8_t* data, size_t size) {
+    if (size < OGG_PAGE_HEADER_SIZE || memcmp(data, "OggS", 4) != 0) {
+        return false;
+    }
+    // 第一页只包含 OpusHead 包
+    size_t payload = OGG_PAGE_HEADER_SIZE + data[26];
+    return size >= payload + 8 && memcmp(data + payload, "OpusHead", 8) == 0;
+}
+
+bool OggOpusAudioDecoder::Initialize() {
+    opus_decoder_ = std::make_unique<OpusDecoderWrapper>(sample_rate_, 1, OPUS_MAX_PACKET_DURATION_MS);
+    return true;
+}
+
+void OggOpusAudioDecoder::Reset() {
+    in_page_ = false;
+    segment_count_ = 0;
+    segment_index_ = 0;
+    packet_.clear();
+    if (opus_decoder_) {
+        opus_decoder_->ResetState();
+    }
+}
+
+AudioDecodeResult OggOpusAudioDecoder::ParsePageHeader(const uint8_t* data, size_t size, size_t* consumed) {
+    if (size < OGG_PAGE_HEADER_SIZE) {
+        return kAudioDecodeNeedMoreData;
+    }
+    if (memcmp(data, "OggS", 4) != 0) {
+        // 丢失同步，跳到下一个页头，未拼完的包作废
+        packet_.clear();
+        size_t offset = 1;
+        while (offset + 4 <= size && memcmp(data + offset, "OggS", 4) != 0) {
+            offset++;
+        }
+        *consumed = offset;
+        return kAudioDecodeError;
+    }
+
+    size_t segment_count = data[26];
+    if (size < OGG_PAGE_HEADER_SIZE + segment_count) {
+        return kAudioDecodeNeedMoreData;
+    }
+    uint8_t header_type = data[5];
+    if (header_type & OGG_HEADER_TYPE_BOS) {
+        // 新的逻辑流（串联的下一首），重新解析头部
+        header_state_ = kExpectOpusHead;
+    }
+    if (!(header_type & OGG_HEADER_TYPE_CONTINUED)) {
+        packet_.clear();
+    }
+    memcpy(segments_, data + OGG_PAGE_HEADER_SIZE, segment_count);
+    segment_count_ = segment_count;
+    segment_index_ = 0;
+    in_page_ = segment_count > 0;
+    *consumed = OGG_PAGE_HEADER_SIZE + segment_count;
+    return kAudioDecodeSkipped;
+}
+
+AudioDecodeResult OggOpusAudioDecoder::DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                                   std::vector<int16_t>& pcm) {
+    *consumed = 0;
+    if (!opus_decoder_) {
+        return kAudioDecodeError;
+    }
+    if (!in_page_) {
+        return ParsePageHeader(data, size, consumed);
+    }
+
+    // 拼接分段，长度小于255的分段表示包结束
+    size_t offset = 0;
+    bool discard = header_state_ == kExpectOpusTags;
+    while (segment_index_ < segment_count_) {
+        size_t length = segments_[segment_index_];
+        if (offset + length > size) {
+            *consumed = offset;
+            return offset > 0 ? kAudioDecodeSkipped : kAudioDecodeNeedMoreData;
+        }
+        if (!discard) {
+            packet_.insert(packet_.end(), data + offset, data + offset + length);
+        }
+        offset += length;
+        segment_index_++;
+        if (length < 255) {
+            in_page_ = segment_index_ < segment_count_;
+            *consumed = offset;
+            return DecodePacket(pcm);
+        }
+    }
+
+    // 包延续到下一页
+    in_page_ = false;
+    *consumed = offset;
+    return kAudioDecodeSkipped;
+}
+
+AudioDecodeResult OggOpusAudioDecoder::DecodePacket(std::vector<int16_t>& pcm) {
+    std::vector<uint8_t> packet = std::move(packet_);
+    packet_.clear();
+
+    switch (header_state_) {
+    case kExpectOpusHead:
+        if (packet.size() < 19 || memcmp(packet.data(), "OpusHead", 8) != 0) {
+            ESP_LOGW(TAG, "Not an Opus stream");
+            return kAudioDecodeError;
+        }
+        // pre-skip 以48kHz样本计
+        pre_skip_remaining_ = (packet[10] | (packet[11] << 8)) * (sample_rate_ / 1000) / (OPUS_SAMPLE_RATE / 1000);
+        header_state_ = kExpectOpusTags;
+        opus_decoder_->ResetState();
+        ESP_LOGI(TAG, "Opus stream: %d channels, input rate %lu, decoding at %d Hz", packet[9],
+                (unsigned long)(packet[12] | (packet[13] << 8) | (packet[14] << 16) | ((uint32_t)packet[15] << 24)),
+                sample_rate_);
+        return kAudioDecodeSkipped;
+    case kExpectOpusTags:
+        header_state_ = kAudioPackets;
+        return kAudioDecodeSkipped;
+    default:
+        break;
+    }
+
+    if (packet.empty()) {
+        return kAudioDecodeSkipped;
+    }
+    size_t packet_size = packet.size();
+    if (!opus_decoder_->Decode(std::move(packet), pcm)) {
+        ESP_LOGW(TAG, "Failed to decode Opus packet (%u bytes)", (unsigned int)packet_size);
+        return kAudioDecodeError;
+    }
+    size_t samples = pcm.size();
+    if (pre_skip_remaining_ > 0) {
+        size_t skip = std::min<size_t>(pre_skip_remaining_, pcm.size());
+        pcm.erase(pcm.begin(), pcm.begin() + skip);
+        pre_skip_remaining_ -= skip;
+    }
+
+    frame_info_.sample_rate = sample_rate_;
+    frame_info_.channels = 1;
+    frame_info_.samples = pcm.size();
+    if (samples > 0) {
+        frame_info_.bitrate = (int)((int64_t)packet_size * 8 * sample_rate_ / samples);
+    }
+    return kAudioDecodeOk;
+}
@@ -0,0 +1,53 @@
+#ifndef OGG_OPUS_AUDIO_DECODER_H
+#define OGG_OPUS_AUDIO_DECODER_H
+
+#include "audio_decoder.h"
+
+#include <opus_decoder.h>
+
+/*
+ * Ogg/Opus解码器：按页解析Ogg封装，把分段拼成Opus包后交给 OpusDecoderWrapper 解码。
+ *
+ * 每次最多消耗一个页头或一个包的分段（每段不超过255字节），所以不要求整页数据连续；
+ * OpusTags（可能包含封面图片）直接丢弃，不缓存。输出单声道，并去掉 OpusHead 中的 pre-skip 样本。
+ *
+ * 与TTS一样，codec的输出采样率是Opus支持的采样率（8/12/16/24/48kHz）时直接按该采样率解码，不再重采样。
+ */
+class OggOpusAudioDecoder : public AudioDecoder {
+public:
+    explicit OggOpusAudioDecoder(int output_sample_rate = 0);
+
+    static bool Probe(const uint8_t* data, size_t size);
+
+    AudioFormat format() const override { return kAudioFormatOggOpus; }
+    const char* name() const override { return "Ogg/Opus"; }
+    size_t min_input_bytes() const override { return 4096; }
+    bool Initialize() override;
+    void Reset() override;
+    AudioDecodeResult DecodeFrame(const uint8_t* data, size_t size, size_t* consumed,
+                                  std::vector<int16_t>& pcm) override;
+
+private:
+    enum HeaderState {
+        kExpectOpusHead,
+        kExpectOpusTags,
+        kAudioPackets,
+    };
+
+    std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
+    int sample_rate_;
+    HeaderState header_state_ = kExpectOpusHead;
+    int pre_skip_remaining_ = 0;
+
+    // 当前页的分段表
+    bool in_page_ = false;
+    uint8_t segments_[255];
+    int segment_count_ = 0;
+    int segment_index_ = 0;
+    std::vector<uint8_t> packet_;
+
+    AudioDecodeResult ParsePageHeader(const uint8_t* data, size_t size, size_t* consumed);
+    AudioDecodeResult DecodePacket(std::vector<int16_t>& pcm);
+};
+
+#endif // OGG_OPUS_AUDIO_DECODER_H
@@ -197,6 +197,13 @@ std::string WifiBoard::GetDeviceStatusJson() {
      *     },
      *     "chip": {
      *         "temperature": 25
+     *     },
+     *     "music": {
+     *         "playing": true,
+     *         "position_ms": 12000,
+     *         "throughput_kbps": 512,
+     *         "underruns": 0,
+     *         "ttfa_ms": 850
      *     }
      * }
      */
@@ -249,6 +256,13 @@ std::string WifiBoard::GetDeviceStatusJson() {
     }
     cJSON_AddItemToObject(root, "network", network);
 
+    // Music
+    auto music = board.GetMusic();
+    cJSON* music_stats = music ? music->GetStatsJson(false) : nullptr;
+    if (music_stats) {
+        cJSON_AddItemToObject(root, "music", music_stats);
+    }
+
     // Chip
     float esp32temp = 0.0f;
     if (board.GetTemperature(esp32temp)) {
@@ -263,6 +263,11 @@ void Display::SetChatMessage(const char* role, const char* content) {
     lv_label_set_text(chat_message_label_, content);
 }
 
+// 默认实现：歌词作为聊天消息显示，不支持逐字高亮
+void Display::SetLyric(const char* text, bool karaoke) {
+    SetChatMessage("lyric", text);
+}
+
 void Display::SetMusicInfo(const char* song_name) {
     // 默认实现：对于非微信模式，将歌名显示在聊天消息标签中
     DisplayLockGuard lock(this);
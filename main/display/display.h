@@ -26,6 +26,10 @@ public:
     virtual void SetEmotion(const char* emotion);
     virtual void SetChatMessage(const char* role, const char* content);
     virtual void SetMusicInfo(const char* song_name);
+    // 歌词显示：karaoke 为true时该行带逐字时间，随后用 SetLyricProgress() 更新演唱进度
+    virtual void SetLyric(const char* text, bool karaoke = false);
+    // 当前字为 text 中 [word_start, word_end) 的字节，permille 为该字已唱的千分比
+    virtual void SetLyricProgress(size_t word_start, size_t word_end, int permille) {}
     virtual void SetIcon(const char* icon);
     virtual void SetPreviewImage(const lv_img_dsc_t* image);
     virtual void SetTheme(const std::string& theme_name);
@@ -410,6 +410,11 @@ void LcdDisplay::SetupUI() {
     // We'll create chat messages dynamically in SetChatMessage
     chat_message_label_ = nullptr;
 
+    // 歌词固定显示在聊天区域下方，不随聊天消息滚动
+    lyric_view_ = std::make_unique<LyricView>(container_, fonts_.text_font, LV_HOR_RES);
+    lyric_view_->SetColors(current_theme_.text, current_theme_.system_text);
+    lv_obj_add_flag(lyric_view_->obj(), LV_OBJ_FLAG_HIDDEN);
+
     /* Status bar */
     lv_obj_set_flex_flow(status_bar_, LV_FLEX_FLOW_ROW);
     lv_obj_set_style_pad_all(status_bar_, 0, 0);
@@ -818,6 +823,11 @@ void LcdDisplay::SetupUI() {
     lv_obj_set_style_text_align(chat_message_label_, LV_TEXT_ALIGN_CENTER, 0); // 设置文本居中对齐
     lv_obj_set_style_text_color(chat_message_label_, current_theme_.text, 0);
 
+    // 歌词显示在歌名下方
+    lyric_view_ = std::make_unique<LyricView>(content_, fonts_.text_font, LV_HOR_RES * 0.9);
+    lyric_view_->SetColors(current_theme_.text, current_theme_.system_text);
+    lv_obj_add_flag(lyric_view_->obj(), LV_OBJ_FLAG_HIDDEN);
+
     /* Status bar */
     lv_obj_set_flex_flow(status_bar_, LV_FLEX_FLOW_ROW);
     lv_obj_set_style_pad_all(status_bar_, 0, 0);
@@ -997,6 +1007,29 @@ void LcdDisplay::SetMusicInfo(const char* song_name) {
 #endif
 }
 
+void LcdDisplay::SetLyric(const char* text, bool karaoke) {
+    DisplayLockGuard lock(this);
+    if (lyric_view_ == nullptr) {
+        Display::SetLyric(text, karaoke);
+        return;
+    }
+
+    if (text == nullptr || text[0] == '\0') {
+        lv_obj_add_flag(lyric_view_->obj(), LV_OBJ_FLAG_HIDDEN);
+        lyric_view_->SetText("", false);
+        return;
+    }
+    lv_obj_clear_flag(lyric_view_->obj(), LV_OBJ_FLAG_HIDDEN);
+    lyric_view_->SetText(text, karaoke);
+}
+
+void LcdDisplay::SetLyricProgress(size_t word_start, size_t word_end, int permille) {
+    DisplayLockGuard lock(this);
+    if (lyric_view_ != nullptr) {
+        lyric_view_->SetProgress(word_start, word_end, permille);
+    }
+}
+
 void LcdDisplay::SetTheme(const std::string& theme_name) {
     DisplayLockGuard lock(this);
     
@@ -1188,6 +1221,10 @@ void LcdDisplay::SetTheme(const std::string& theme_name) {
         lv_obj_set_style_bg_color(low_battery_popup_, current_theme_.low_battery, 0);
     }
 
+    if (lyric_view_ != nullptr) {
+        lyric_view_->SetColors(current_theme_.text, current_theme_.system_text);
+    }
+
     // No errors occurred. Save theme to settings
     Display::SetTheme(theme_name);
 }
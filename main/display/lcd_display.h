@@ -2,12 +2,14 @@
 #define LCD_DISPLAY_H
 
 #include "display.h"
+#include "lyric_view.h"
 
 #include <esp_lcd_panel_io.h>
 #include <esp_lcd_panel_ops.h>
 #include <font_emoji.h>
 
 #include <atomic>
+#include <memory>
 #include <vector>
 #include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
@@ -39,6 +41,7 @@ protected:
     lv_obj_t* container_ = nullptr;
     lv_obj_t* side_bar_ = nullptr;
     lv_obj_t* preview_image_ = nullptr;
+    std::unique_ptr<LyricView> lyric_view_;
 
     DisplayFonts fonts_;
     ThemeColors current_theme_;
@@ -103,6 +106,8 @@ public:
     virtual void SetEmotion(const char* emotion) override;
     virtual void SetIcon(const char* icon) override;
     virtual void SetMusicInfo(const char* song_name) override;
+    virtual void SetLyric(const char* text, bool karaoke = false) override;
+    virtual void SetLyricProgress(size_t word_start, size_t word_end, int permille) override;
     virtual void SetPreviewImage(const lv_img_dsc_t* img_dsc) override;
 #if CONFIG_USE_WECHAT_MESSAGE_STYLE
     virtual void SetChatMessage(const char* role, const char* content) override; 
@@ -0,0 +1,154 @@
+#include "lyric_view.h"
+
+#include <algorithm>
+#include <climits>
+
+// 已唱部分超过文本末尾，整行显示为已唱
+static const int32_t kSplitAll = INT32_MAX / 2;
+
+static bool IntersectArea(lv_area_t* result, const lv_area_t& a, const lv_area_t& b) {
+    result->x1 = std::max(a.x1, b.x1);
+    result->y1 = std::max(a.y1, b.y1);
+    result->x2 = std::min(a.x2, b.x2);
+    result->y2 = std::min(a.y2, b.y2);
+    return result->x1 <= result->x2 && result->y1 <= result->y2;
+}
+
+LyricView::LyricView(lv_obj_t* parent, const lv_font_t* font, int32_t width) {
+    row_ = lv_obj_create(parent);
+    lv_obj_remove_style_all(row_);
+    lv_obj_set_size(row_, width, LV_SIZE_CONTENT);
+    lv_obj_clear_flag(row_, LV_OBJ_FLAG_SCROLLABLE);
+
+    unsung_label_ = CreateLabel(font);
+    sung_label_ = CreateLabel(font);
+    line_height_ = lv_font_get_line_height(font);
+    split_y_ = kSplitAll;
+}
+
+lv_obj_t* LyricView::CreateLabel(const lv_font_t* font) {
+    lv_obj_t* label = lv_label_create(row_);
+    lv_obj_set_width(label, lv_pct(100));
+    lv_obj_set_style_text_font(label, font, 0);
+    lv_obj_set_style_text_align(label, LV_TEXT_ALIGN_CENTER, 0);
+    lv_label_set_long_mode(label, LV_LABEL_LONG_WRAP);
+    lv_label_set_text(label, "");
+    lv_obj_add_event_cb(label, DrawEventCallback, LV_EVENT_DRAW_MAIN_BEGIN, this);
+    lv_obj_add_event_cb(label, DrawEventCallback, LV_EVENT_DRAW_MAIN_END, this);
+    return label;
+}
+
+void LyricView::SetColors(lv_color_t sung, lv_color_t unsung) {
+    lv_obj_set_style_text_color(sung_label_, sung, 0);
+    lv_obj_set_style_text_color(unsung_label_, unsung, 0);
+}
+
+void LyricView::SetText(const char* text, bool karaoke) {
+    lv_label_set_text(unsung_label_, text);
+    lv_label_set_text(sung_label_, text);
+    split_x_ = 0;
+    split_y_ = karaoke ? 0 : kSplitAll;
+    // 立即完成布局，后续计算字的位置需要标签的实际尺寸
+    lv_obj_update_layout(row_);
+}
+
+// 文本中第 byte_offset 个字节处的字在标签内容区中的位置
+void LyricView::GetBytePosition(size_t byte_offset, lv_point_t* pos) {
+    const char* text = lv_label_get_text(sung_label_);
+    uint32_t char_id = lv_text_encoded_get_char_id(text, byte_offset);
+    lv_label_get_letter_pos(sung_label_, char_id, pos);
+}
+
+void LyricView::SetProgress(size_t word_start, size_t word_end, int permille) {
+    if (split_y_ == kSplitAll) {
+        return;
+    }
+    lv_point_t start, end;
+    GetBytePosition(word_start, &start);
+    GetBytePosition(word_end, &end);
+
+    // 当前字在同一行时按进度插值，跨行时（自动换行）前半段停在行首
+    lv_point_t split = start;
+    if (start.y == end.y) {
+        split.x = start.x + (end.x - start.x) * std::clamp(permille, 0, 1000) / 1000;
+    } else if (permille >= 500) {
+        split = end;
+    }
+    MoveSplit(split.x, split.y);
+}
+
+// 移动分界点，只重绘新旧分界点之间的区域
+void LyricView::MoveSplit(int32_t x, int32_t y) {
+    if (x == split_x_ && y == split_y_) {
+        return;
+    }
+    lv_area_t coords;
+    lv_obj_get_content_coords(sung_label_, &coords);
+    lv_area_t dirty;
+    if (y == split_y_) {
+        dirty.x1 = coords.x1 + std::min(x, split_x_);
+        dirty.x2 = coords.x1 + std::max(x, split_x_) - 1;
+        dirty.y1 = coords.y1 + y;
+        dirty.y2 = dirty.y1 + line_height_ - 1;
+    } else {
+        dirty.x1 = coords.x1;
+        dirty.x2 = coords.x2;
+        dirty.y1 = coords.y1 + std::min(y, split_y_);
+        dirty.y2 = coords.y1 + std::max(y, split_y_) + line_height_ - 1;
+    }
+    split_x_ = x;
+    split_y_ = y;
+    lv_obj_invalidate_area(sung_label_, &dirty);
+}
+
+// 标签需要绘制的两块区域：整行部分（已唱为分界行之前的行，未唱为之后的行）和分界行中的一段
+void LyricView::GetClipAreas(lv_obj_t* label, const lv_area_t& clip, lv_area_t* rows, lv_area_t* split_row) {
+    lv_area_t coords;
+    lv_obj_get_content_coords(label, &coords);
+    int32_t row_top = split_y_ == kSplitAll ? kSplitAll : coords.y1 + split_y_;
+    int32_t row_bottom = split_y_ == kSplitAll ? kSplitAll : row_top + line_height_ - 1;
+    int32_t split_x = coords.x1 + split_x_;
+
+    *rows = clip;
+    *split_row = clip;
+    split_row->y1 = row_top;
+    split_row->y2 = row_bottom;
+    if (label == sung_label_) {
+        rows->y2 = row_top - 1;
+        split_row->x2 = split_x - 1;
+    } else {
+        rows->y1 = row_bottom + 1;
+        split_row->x1 = split_x;
+    }
+}
+
+// 标签自身绘制前把裁剪区缩小到整行部分，绘制后再按分界行的那一段裁剪绘制一次
+void LyricView::DrawEventCallback(lv_event_t* e) {
+    auto view = static_cast<LyricView*>(lv_event_get_user_data(e));
+    auto label = static_cast<lv_obj_t*>(lv_event_get_target(e));
+    lv_layer_t* layer = lv_event_get_layer(e);
+
+    if (lv_event_get_code(e) == LV_EVENT_DRAW_MAIN_BEGIN) {
+        view->saved_clip_ = layer->_clip_area;
+        lv_area_t rows, split_row;
+        view->GetClipAreas(label, view->saved_clip_, &rows, &split_row);
+        if (!IntersectArea(&layer->_clip_area, rows, view->saved_clip_)) {
+            layer->_clip_area = {0, 0, -1, -1};
+        }
+        return;
+    }
+
+    lv_area_t rows, split_row, clip;
+    view->GetClipAreas(label, view->saved_clip_, &rows, &split_row);
+    if (IntersectArea(&clip, split_row, view->saved_clip_)) {
+        layer->_clip_area = clip;
+        lv_draw_label_dsc_t dsc;
+        lv_draw_label_dsc_init(&dsc);
+        lv_obj_init_draw_label_dsc(label, LV_PART_MAIN, &dsc);
+        dsc.text = lv_label_get_text(label);
+        lv_area_t coords;
+        lv_obj_get_content_coords(label, &coords);
+        lv_draw_label(layer, &dsc, &coords);
+    }
+    layer->_clip_area = view->saved_clip_;
+}
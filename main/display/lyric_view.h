@@ -0,0 +1,42 @@
+#ifndef LYRIC_VIEW_H
+#define LYRIC_VIEW_H
+
+#include <lvgl.h>
+
+#include <cstddef>
+
+/*
+ * 逐字高亮（卡拉OK）歌词控件：两个重叠的标签显示同一行歌词，sung_label_ 只绘制已唱的部分，
+ * unsung_label_ 只绘制未唱的部分。换行时才设置文本；更新进度时标签的文本和尺寸都不变，
+ * 只重绘分界点移动经过的那一段字形区域。
+ *
+ * 分界点由 (split_x_, split_y_) 表示：split_y_ 所在行中 x < split_x_ 的部分以及之前的行为已唱。
+ * 所有方法都需要在持有显示锁时调用。
+ */
+class LyricView {
+public:
+    LyricView(lv_obj_t* parent, const lv_font_t* font, int32_t width);
+
+    lv_obj_t* obj() const { return row_; }
+    void SetColors(lv_color_t sung, lv_color_t unsung);
+    // karaoke 为false时整行按已唱的颜色显示
+    void SetText(const char* text, bool karaoke);
+    void SetProgress(size_t word_start, size_t word_end, int permille);
+
+private:
+    lv_obj_t* row_ = nullptr;
+    lv_obj_t* unsung_label_ = nullptr;
+    lv_obj_t* sung_label_ = nullptr;
+    int32_t line_height_ = 0;
+    int32_t split_x_ = 0;
+    int32_t split_y_ = 0;
+    lv_area_t saved_clip_;
+
+    lv_obj_t* CreateLabel(const lv_font_t* font);
+    void GetBytePosition(size_t byte_offset, lv_point_t* pos);
+    void MoveSplit(int32_t x, int32_t y);
+    void GetClipAreas(lv_obj_t* label, const lv_area_t& clip, lv_area_t* rows, lv_area_t* split_row);
+    static void DrawEventCallback(lv_event_t* e);
+};
+
+#endif // LYRIC_VIEW_H
@@ -14,7 +14,6 @@
 #include "application.h"
 #include "display.h"
 #include "board.h"
-#include "boards/common/esp32_music.h"
 #include "message_pusher.h"
  
  #define TAG "MCP"
@@ -118,7 +117,7 @@ void McpServer::AddCommonTools() {
      auto music = board.GetMusic();
      if (music) {
          AddTool("self.music.play_song",
-             "播放指定的歌曲。当用户要求播放音乐时使用此工具，会自动获取歌曲详情并开始流式播放。\n"
+             "播放指定的歌曲。当用户要求播放音乐时使用此工具，优先播放本地曲库中的歌曲，否则自动获取歌曲详情并开始流式播放。\n"
              "参数:\n"
              "  `song_name`: 要播放的歌曲名称（必需）。\n"
              "  `artist_name`: 要播放的歌曲艺术家名称（可选，默认为空字符串）。\n"
@@ -140,6 +139,194 @@ void McpServer::AddCommonTools() {
                  return "{\"success\": true, \"message\": \"音乐开始播放\"}";
              });
  
+        AddTool("self.music.play_radio",
+            "播放网络电台。当用户要求收听电台、广播或者给出电台的直播地址时使用此工具，会打断当前播放。\n"
+            "支持 Shoutcast/Icecast 直播流（MP3/AAC）和 HLS（.m3u8）播放列表，直播流不支持跳转。\n"
+            "参数:\n"
+            "  `url`: 电台的直播流地址（必需）。\n"
+            "  `name`: 电台名称，用于显示（可选）。\n"
+            "返回:\n"
+            "  播放状态信息。",
+            PropertyList({
+                Property("url", kPropertyTypeString),
+                Property("name", kPropertyTypeString, "")
+            }),
+            [music](const PropertyList& properties) -> ReturnValue {
+                auto url = properties["url"].value<std::string>();
+                auto name = properties["name"].value<std::string>();
+                if (!music->PlayRadio(url, name)) {
+                    return "{\"success\": false, \"message\": \"电台地址无效\"}";
+                }
+                return "{\"success\": true, \"message\": \"电台开始播放\"}";
+            });
+
+        AddTool("self.music.enqueue",
+            "把歌曲添加到播放队列末尾。当用户说'下一首播放xxx'、'把xxx加到列表'时使用此工具；当前没有播放时会立刻开始播放。\n"
+            "当前歌曲播放完后会无缝切换到队列中的下一首。\n"
+            "参数:\n"
+            "  `song_name`: 要添加的歌曲名称（必需）。\n"
+            "  `artist_name`: 歌曲艺术家名称（可选，默认为空字符串）。\n"
+            "返回:\n"
+            "  添加结果信息。",
+            PropertyList({
+                Property("song_name", kPropertyTypeString),//歌曲名称（必需）
+                Property("artist_name", kPropertyTypeString, "")//艺术家名称（可选，默认为空字符串）
+            }),
+            [music](const PropertyList& properties) -> ReturnValue {
+                auto song_name = properties["song_name"].value<std::string>();
+                auto artist_name = properties["artist_name"].value<std::string>();
+
+                if (!music->Enqueue(song_name, artist_name)) {
+                    return "{\"success\": false, \"message\": \"获取音乐资源失败\"}";
+                }
+                return "{\"success\": true, \"message\": \"已添加到播放列表\"}";
+            });
+
+        AddTool("self.music.pause",
+            "暂停当前播放的歌曲。当用户说'暂停'、'先停一下'时使用此工具，之后可以用 `self.music.resume` 从暂停处继续播放。",
+            PropertyList(),
+            [music](const PropertyList& properties) -> ReturnValue {
+                if (!music->Pause()) {
+                    return "{\"success\": false, \"message\": \"当前没有正在播放的歌曲\"}";
+                }
+                return "{\"success\": true, \"message\": \"已暂停\"}";
+            });
+
+        AddTool("self.music.resume",
+            "继续播放已暂停的歌曲。当用户说'继续播放'、'接着放'时使用此工具。",
+            PropertyList(),
+            [music](const PropertyList& properties) -> ReturnValue {
+                if (!music->Resume()) {
+                    return "{\"success\": false, \"message\": \"没有暂停的歌曲\"}";
+                }
+                return "{\"success\": true, \"message\": \"继续播放\"}";
+            });
+
+        AddTool("self.music.next",
+            "播放队列中的下一首歌曲。当用户说'下一首'、'切歌'时使用此工具。",
+            PropertyList(),
+            [music](const PropertyList& properties) -> ReturnValue {
+                if (!music->Next()) {
+                    return "{\"success\": false, \"message\": \"已经是最后一首了\"}";
+                }
+                return "{\"success\": true, \"message\": \"开始播放下一首\"}";
+            });
+
+        AddTool("self.music.previous",
+            "播放队列中的上一首歌曲。当用户说'上一首'时使用此工具。",
+            PropertyList(),
+            [music](const PropertyList& properties) -> ReturnValue {
+                if (!music->Previous()) {
+                    return "{\"success\": false, \"message\": \"已经是第一首了\"}";
+                }
+                return "{\"success\": true, \"message\": \"开始播放上一首\"}";
+            });
+
+        AddTool("self.music.clear_queue",
+            "清空播放队列，当前正在播放的歌曲会继续播放完。",
+            PropertyList(),
+            [music](const PropertyList& properties) -> ReturnValue {
+                music->Clear();
+                return "{\"success\": true, \"message\": \"播放列表已清空\"}";
+            });
+
+        AddTool("self.music.get_queue",
+            "获取当前的播放队列。当用户询问播放列表、接下来播放什么时使用此工具。\n"
+            "返回:\n"
+            "  `current`: 当前播放歌曲在队列中的序号（从0开始，-1表示没有），`tracks`: 队列中的歌曲列表。",
+            PropertyList(),
+            [music](const PropertyList& properties) -> ReturnValue {
+                auto queue = music->GetQueue();
+                cJSON* json = cJSON_CreateObject();
+                cJSON_AddNumberToObject(json, "current", music->GetQueueIndex());
+                cJSON* tracks = cJSON_AddArrayToObject(json, "tracks");
+                for (const auto& track : queue) {
+                    cJSON* item = cJSON_CreateObject();
+                    cJSON_AddStringToObject(item, "song_name", track.song_name.c_str());
+                    cJSON_AddStringToObject(item, "artist_name", track.artist_name.c_str());
+                    cJSON_AddItemToArray(tracks, item);
+                }
+                char* str = cJSON_PrintUnformatted(json);
+                std::string result(str);
+                cJSON_free(str);
+                cJSON_Delete(json);
+                return result;
+            });
+
+        AddTool("self.music.seek",
+            "跳转当前歌曲的播放位置。比如用户说'快进30秒'、'后退10秒'、'从第1分钟开始播放'时使用此工具。\n"
+            "参数:\n"
+            "  `seconds`: 目标位置或偏移量（秒）。\n"
+            "  `relative`: 为true时 `seconds` 是相对当前位置的偏移（负数表示后退），为false时是从歌曲开头算起的位置。\n"
+            "返回:\n"
+            "  跳转后的位置和歌曲总时长（秒，0表示未知）。",
+            PropertyList({
+                Property("seconds", kPropertyTypeInteger, 0, -3600, 3600),
+                Property("relative", kPropertyTypeBoolean, false)
+            }),
+            [music](const PropertyList& properties) -> ReturnValue {
+                int64_t position_ms = properties["seconds"].value<int>() * 1000LL;
+                if (properties["relative"].value<bool>()) {
+                    position_ms += music->GetPosition();
+                }
+                if (!music->Seek(position_ms)) {
+                    return "{\"success\": false, \"message\": \"当前歌曲不支持跳转或位置超出范围\"}";
+                }
+                return "{\"success\": true, \"position\": " + std::to_string(std::max<int64_t>(0, position_ms) / 1000) +
+                       ", \"duration\": " + std::to_string(music->GetDuration() / 1000) + "}";
+            });
+
+        AddTool("self.music.set_equalizer",
+            "设置音乐的均衡器音效。当用户说'低音重一点'、'人声清楚一点'、'恢复原声'时使用此工具，设置会保存。\n"
+            "参数:\n"
+            "  `preset`: 'flat'（原声）、'bass'（低音增强）、'vocal'（人声）、'treble'（高音增强）或 'speaker'（小音箱补偿）。\n"
+            "返回:\n"
+            "  设置结果信息。",
+            PropertyList({
+                Property("preset", kPropertyTypeString)
+            }),
+            [](const PropertyList& properties) -> ReturnValue {
+                auto name = properties["preset"].value<std::string>();
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                MusicEqPreset preset = MusicDsp::PresetFromName(name.c_str());
+                if (preset == kMusicEqPresetCount) {
+                    return "{\"success\": false, \"message\": \"无效的音效，请使用 'flat'、'bass'、'vocal'、'treble' 或 'speaker'\"}";
+                }
+                Application::GetInstance().GetAudioService().SetMusicEqPreset(preset);
+                return "{\"success\": true, \"message\": \"音效已设置\"}";
+            });
+
+        AddTool("self.music.set_loudness_normalization",
+            "开启或关闭音乐响度均衡。开启后不同歌曲的音量自动调整到接近的响度，用户抱怨歌曲忽大忽小时开启，"
+            "想听原始动态时关闭。设置会保存。",
+            PropertyList({
+                Property("enabled", kPropertyTypeBoolean)
+            }),
+            [](const PropertyList& properties) -> ReturnValue {
+                bool enabled = properties["enabled"].value<bool>();
+                Application::GetInstance().GetAudioService().SetMusicNormalization(enabled);
+                return enabled ? "{\"success\": true, \"message\": \"已开启响度均衡\"}"
+                               : "{\"success\": true, \"message\": \"已关闭响度均衡\"}";
+            });
+
+        AddTool("self.music.get_stats",
+            "获取音乐播放的运行统计，用于排查播放卡顿。当用户询问播放为什么卡、网络是否够快时使用此工具。\n"
+            "返回:\n"
+            "  下载吞吐量、缓冲区填充、欠载次数、每帧解码耗时直方图、重新同步和丢弃的字节数、起播各阶段耗时、\n"
+            "  均衡器和响度均衡的状态及每帧CPU周期数等。",
+            PropertyList(),
+            [music](const PropertyList& properties) -> ReturnValue {
+                cJSON* json = music->GetStatsJson(true);
+                if (json == nullptr) {
+                    return "{\"success\": false, \"message\": \"获取统计失败\"}";
+                }
+                char* str = cJSON_PrintUnformatted(json);
+                std::string result(str);
+                cJSON_free(str);
+                cJSON_Delete(json);
+                return result;
+            });
+
         AddTool("self.music.set_display_mode",
             "设置音乐播放时的显示模式。可以选择显示频谱或歌词，比如用户说'打开频谱'或者'显示频谱'，'打开歌词'或者'显示歌词'就设置对应的显示模式。\n"
             "参数:\n"
@@ -157,13 +344,11 @@ void McpServer::AddCommonTools() {
                 
                 if (mode_str == "spectrum" || mode_str == "频谱") {
                     // 设置为频谱显示模式
-                    auto esp32_music = static_cast<Esp32Music*>(music);
-                    esp32_music->SetDisplayMode(Esp32Music::DISPLAY_MODE_SPECTRUM);
+                    music->SetDisplayMode(Music::DISPLAY_MODE_SPECTRUM);
                     return "{\"success\": true, \"message\": \"已切换到频谱显示模式\"}";
                 } else if (mode_str == "lyrics" || mode_str == "歌词") {
                     // 设置为歌词显示模式
-                    auto esp32_music = static_cast<Esp32Music*>(music);
-                    esp32_music->SetDisplayMode(Esp32Music::DISPLAY_MODE_LYRICS);
+                    music->SetDisplayMode(Music::DISPLAY_MODE_LYRICS);
                     return "{\"success\": true, \"message\": \"已切换到歌词显示模式\"}";
                 } else {
                     return "{\"success\": false, \"message\": \"无效的显示模式，请使用 'spectrum' 或 'lyrics'\"}";
@@ -0,0 +1,213 @@
+// 主机端重采样基准测试：比较 PolyphaseResampler、两种线性插值实现和 OpusResampler(silk)
+// 的每样本耗时与 THD+N。
+#include "polyphase_resampler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#if HAVE_OPUS_SILK
+extern "C" {
+#include "resampler_structs.h"
+int silk_resampler_init(silk_resampler_state_struct* S, int Fs_Hz_in, int Fs_Hz_out, int forEnc);
+int silk_resampler(silk_resampler_state_struct* S, int16_t out[], const int16_t in[], int inLen);
+}
+#endif
+
+static const int kFrameMs = 26;           // 与一帧MP3(1152样本@44.1k)接近
+static const int kDurationMs = 4000;
+static const double kToneHz = 1000.0;
+static const double kToneAmplitude = 0.5;
+
+// 一个被测的流式重采样器：输入一帧，输出追加到 out
+using ResampleFn = std::function<void(const std::vector<int16_t>& in, std::vector<int16_t>& out)>;
+using FactoryFn = std::function<bool(int in_rate, int out_rate, ResampleFn* fn)>;
+
+// 旧版 Application::AddAudioData 的上采样：只支持整数倍，降采样改为切换I2S时钟（此处视为不支持）
+static bool MakeLegacyLinear(int in_rate, int out_rate, ResampleFn* fn) {
+    if (in_rate >= out_rate) {
+        return false;
+    }
+    *fn = [in_rate, out_rate](const std::vector<int16_t>& pcm_data, std::vector<int16_t>& out) {
+        float upsample_ratio = out_rate / static_cast<float>(in_rate);
+        for (size_t i = 0; i < pcm_data.size(); ++i) {
+            out.push_back(pcm_data[i]);
+            int interpolation_count = static_cast<int>(upsample_ratio) - 1;
+            if (interpolation_count > 0 && i + 1 < pcm_data.size()) {
+                int16_t current = pcm_data[i];
+                int16_t next = pcm_data[i + 1];
+                for (int j = 1; j <= interpolation_count; ++j) {
+                    float t = static_cast<float>(j) / (interpolation_count + 1);
+                    out.push_back(static_cast<int16_t>(current + (next - current) * t));
+                }
+            } else if (interpolation_count > 0) {
+                for (int j = 1; j <= interpolation_count; ++j) {
+                    out.push_back(pcm_data[i]);
+                }
+            }
+        }
+    };
+    return true;
+}
+
+// AudioService 混音器接入后使用的Q16流式线性插值（任意比例，无抗混叠滤波）
+static bool MakeStreamingLinear(int in_rate, int out_rate, ResampleFn* fn) {
+    struct State {
+        uint64_t position = 0;
+        int16_t last_sample = 0;
+    };
+    auto state = std::make_shared<State>();
+    *fn = [state, in_rate, out_rate](const std::vector<int16_t>& input, std::vector<int16_t>& output) {
+        uint64_t step = ((uint64_t)in_rate << 16) / out_rate;
+        uint64_t end = (uint64_t)input.size() << 16;
+        uint64_t position = state->position;
+        while (position < end) {
+            size_t index = position >> 16;
+            int32_t s0 = index == 0 ? state->last_sample : input[index - 1];
+            int32_t s1 = input[index];
+            int64_t frac = position & 0xFFFF;
+            output.push_back((int16_t)(s0 + (((s1 - s0) * frac) >> 16)));
+            position += step;
+        }
+        state->position = position - end;
+        state->last_sample = input.back();
+    };
+    return true;
+}
+
+static bool MakePolyphase(int in_rate, int out_rate, ResampleFn* fn) {
+    auto resampler = std::make_shared<PolyphaseResampler>();
+    if (!resampler->Configure(in_rate, out_rate)) {
+        return false;
+    }
+    *fn = [resampler](const std::vector<int16_t>& in, std::vector<int16_t>& out) {
+        size_t offset = out.size();
+        out.resize(offset + resampler->GetOutputSamples(in.size()));
+        int produced = resampler->Process(in.data(), in.size(), out.data() + offset);
+        out.resize(offset + produced);
+    };
+    return true;
+}
+
+#if HAVE_OPUS_SILK
+// 与 OpusResampler::Configure 相同：输出16k时走编码器路径，否则走解码器路径
+static bool MakeOpusSilk(int in_rate, int out_rate, ResampleFn* fn) {
+    auto state = std::make_shared<silk_resampler_state_struct>();
+    if (silk_resampler_init(state.get(), in_rate, out_rate, out_rate == 16000 ? 1 : 0) != 0) {
+        return false;
+    }
+    *fn = [state, in_rate, out_rate](const std::vector<int16_t>& in, std::vector<int16_t>& out) {
+        size_t offset = out.size();
+        out.resize(offset + in.size() * out_rate / in_rate);
+        silk_resampler(state.get(), out.data() + offset, in.data(), in.size());
+    };
+    return true;
+}
+#endif
+
+// 对已知频率做最小二乘正弦拟合，残差即 THD+N
+static double MeasureThdN(const std::vector<int16_t>& pcm, int rate, size_t skip) {
+    if (pcm.size() <= skip + rate / 10) {
+        return NAN;
+    }
+    double w = 2 * M_PI * kToneHz / rate;
+    double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0, y1 = 0, s1 = 0, c1 = 0;
+    size_t n = pcm.size() - skip;
+    for (size_t i = 0; i < n; i++) {
+        double s = std::sin(w * (i + skip)), c = std::cos(w * (i + skip)), y = pcm[i + skip];
+        ss += s * s; sc += s * c; cc += c * c; ys += y * s; yc += y * c;
+        y1 += y; s1 += s; c1 += c;
+    }
+    // 解 [ss sc s1; sc cc c1; s1 c1 n] * [a b d] = [ys yc y1]
+    double m[3][4] = {{ss, sc, s1, ys}, {sc, cc, c1, yc}, {s1, c1, (double)n, y1}};
+    for (int i = 0; i < 3; i++) {
+        for (int j = i + 1; j < 3; j++) {
+            double f = m[j][i] / m[i][i];
+            for (int k = i; k < 4; k++) m[j][k] -= f * m[i][k];
+        }
+    }
+    double x[3];
+    for (int i = 2; i >= 0; i--) {
+        x[i] = m[i][3];
+        for (int k = i + 1; k < 3; k++) x[i] -= m[i][k] * x[k];
+        x[i] /= m[i][i];
+    }
+    double signal = 0, residual = 0;
+    for (size_t i = 0; i < n; i++) {
+        double fit = x[0] * std::sin(w * (i + skip)) + x[1] * std::cos(w * (i + skip)) + x[2];
+        signal += fit * fit;
+        residual += (pcm[i + skip] - fit) * (pcm[i + skip] - fit);
+    }
+    return 10 * std::log10(residual / signal);
+}
+
+static void Run(const char* name, const FactoryFn& factory, int in_rate, int out_rate) {
+    ResampleFn fn;
+    if (!factory(in_rate, out_rate, &fn)) {
+        printf("  %-14s %10s %12s %10s\n", name, "-", "-", "unsupported");
+        return;
+    }
+
+    int frame = in_rate * kFrameMs / 1000;
+    int total = in_rate * kDurationMs / 1000;
+    std::vector<int16_t> input(total);
+    for (int i = 0; i < total; i++) {
+        input[i] = (int16_t)std::lround(kToneAmplitude * 32767 * std::sin(2 * M_PI * kToneHz * i / in_rate));
+    }
+
+    std::vector<int16_t> output;
+    output.reserve((size_t)total * out_rate / in_rate + 1024);
+    std::vector<int16_t> chunk;
+    auto start = std::chrono::steady_clock::now();
+#if HAVE_RDTSC
+    uint64_t cycles_start = __rdtsc();
+#endif
+    for (int offset = 0; offset < total; offset += frame) {
+        chunk.assign(input.begin() + offset, input.begin() + std::min(total, offset + frame));
+        fn(chunk, output);
+    }
+#if HAVE_RDTSC
+    uint64_t cycles = __rdtsc() - cycles_start;
+#endif
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    double ns_per_sample = output.empty() ? NAN : elapsed / output.size();
+#if HAVE_RDTSC
+    double cycles_per_sample = output.empty() ? NAN : (double)cycles / output.size();
+#else
+    double cycles_per_sample = NAN;
+#endif
+    double length_error = 100.0 * ((double)output.size() / ((double)total * out_rate / in_rate) - 1.0);
+    double thdn = MeasureThdN(output, out_rate, out_rate / 100);
+    printf("  %-14s %10.2f %12.2f %10.1f   (length %+.2f%%)\n", name, ns_per_sample, cycles_per_sample, thdn, length_error);
+}
+
+int main() {
+    const int pairs[][2] = {
+        {44100, 24000}, {48000, 24000}, {22050, 24000}, {16000, 24000}, {32000, 24000},
+        {44100, 16000}, {48000, 16000}, {22050, 16000}, {24000, 16000},
+    };
+
+    for (auto& pair : pairs) {
+        printf("%d -> %d Hz, %.0f Hz tone\n", pair[0], pair[1], kToneHz);
+        printf("  %-14s %10s %12s %10s\n", "resampler", "ns/sample", "cycles/sample", "THD+N dB");
+        Run("legacy-linear", MakeLegacyLinear, pair[0], pair[1]);
+        Run("stream-linear", MakeStreamingLinear, pair[0], pair[1]);
+#if HAVE_OPUS_SILK
+        Run("opus-silk", MakeOpusSilk, pair[0], pair[1]);
+#endif
+        Run("polyphase", MakePolyphase, pair[0], pair[1]);
+    }
+    return 0;
+}